@@ -4,5 +4,6 @@
 #include "audio_types.h"
 #include "audio_ring_buffer.h"
 #include "audio_pipeline.h"
+#include "static_audio_pipeline.h"
 
 #endif
@@ -1,12 +1,16 @@
 #include "audio_pipeline.h"
 
+#include <stdexcept>
 
-audio_engine::pipeline_stage::pipeline_stage(
+
+audio_engine::stage_control::stage_control(
 	uint8_t entry_block_state, 
 	uint8_t thread_count, 
 	uint8_t in_buffer_idx,
 	uint8_t out_buffer_idx,
-	uint8_t offset
+	uint8_t offset,
+	bool ordered,
+	uint8_t input_count
 ) 
 	: 
 	m_entry_block_state(entry_block_state),
@@ -14,14 +18,26 @@ audio_engine::pipeline_stage::pipeline_stage(
 	m_in_buffer_idx(in_buffer_idx),
 	m_out_buffer_idx(out_buffer_idx),
 	m_offset(offset),
-	m_flushing(false)
+	m_ordered(ordered),
+	m_input_count(input_count),
+	m_flushing(false),
+	m_active_workers(0),
+	m_scheduled(0),
+	m_cursor(0),
+	m_next_ticket(0),
+	m_channel_turns(),
+	m_channel_count(0),
+	m_task_limit(thread_count)
 {
+	//the inputs of a multi input stage are processed together, so there is no channel to order its workers by
+	if (ordered && thread_count != 1 && input_count != 1)
+		throw std::domain_error("stage_control::stage_control(...) : an ordered stage with more than one input must have a thread_count of 1");
+
+	if (input_count == 0 || input_count > audio_engine::max_stage_inputs)
+		throw std::domain_error("stage_control::stage_control(...) : input_count must be in [1, max_stage_inputs]");
 }
 
-uint8_t audio_engine::pipeline_stage::get_entry_state() const noexcept
+uint8_t audio_engine::stage_control::get_entry_state() const noexcept
 {
 	return m_entry_block_state;
 }
-
-
-
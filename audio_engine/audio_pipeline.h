@@ -3,9 +3,23 @@
 
 #include "audio_types.h"
 #include "audio_ring_buffer.h"
+#include "event_count.h"
+#include "work_stealing_deque.h"
+#include "pipeline_metrics.h"
 
 #include <vector>
+#include <memory>
 #include <functional>
+#include <span>
+#include <array>
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
 
 namespace audio_engine {
 	enum pipeline_execution_state : uint8_t {
@@ -14,6 +28,7 @@ namespace audio_engine {
 		EXECUTING = 2,
 	};
 
+	//the pass counters are those of a pipeline built from the three groups, the nodes of a graph count their passes themselves
 	struct pipeline_state {
 		std::atomic<uint64_t> generator_flush_count;
 		std::atomic<uint64_t> processing_flush_count;
@@ -32,33 +47,202 @@ namespace audio_engine {
 		{}
 	};
 
-	//TODO: replace inheritance RTTI with concept-enforced semantics RTTI
-	class pipeline_stage {
+	enum class execution_mode : uint8_t {
+		free_running, //every group runs as fast as the flush barrier lets it
+		real_time,    //the output group takes one pass per period of wall clock time, deadline misses are counted as xruns
+		offline       //renders a fixed number of blocks as fast as possible then stops, see audio_pipeline::render_offline
+	};
+
+	/// <summary>
+	/// how a run kept up with time, a period is one pass of the output buffer (block_count blocks of audio)
+	/// </summary>
+	struct render_stats {
+		uint64_t periods = 0; //output passes taken
+		uint64_t blocks = 0;
+		//real time: a period started before the nodes feeding the output had its pass ready, the output was starved
+		uint64_t underruns = 0;
+		//real time: a period started while the output stages were still on the previous pass, they missed their deadline
+		uint64_t overruns = 0;
+		std::chrono::nanoseconds worst_lateness{ 0 }; //the latest a period was started after its deadline
+		std::chrono::nanoseconds elapsed{ 0 }; //wall clock time of the run so far
+		double real_time_factor = 0.0; //seconds of audio per second of wall clock time, ~1 in real time, > 1 when rendering faster
+	};
+
+	template <size_t BlockSize, uint32_t SampleRate>
+	class basic_audio_pipeline;
+
+	/// <summary>
+	/// the scheduling state every stage carries, with no virtual functions
+	/// the pipeline's flush and wake logic only ever touches this part of a stage so it works on any stage type
+	/// </summary>
+	class stage_control {
 	private:
-		
+
 	protected:
-		friend class audio_pipeline;
+		template <size_t BlockSize, uint32_t SampleRate>
+		friend class basic_audio_pipeline;
 
 		const uint8_t m_entry_block_state;
+		//the most pool workers that may run the stage at once
 		const uint8_t m_thread_count;
 		const uint8_t m_in_buffer_idx;
 		const uint8_t m_out_buffer_idx;
-		//offset from inbuffer to outbuffer used in effects like delay 
+		//offset in blocks from inbuffer to outbuffer
 		const uint8_t m_offset; 
+		//the stage carries state from one block to the next, so it claims strictly in block order. With a thread_count above 1
+		//its workers process successive runs a channel at a time, each channel only once the run before is done with it
+		//(see process_channel), so the channels overlap across workers while every channel sees its blocks in order
+		const bool m_ordered;
+		//the buffers the stage reads, m_in_buffer_idx and the ones after it, it claims blocks from the first
+		const uint8_t m_input_count;
 		std::atomic<bool> m_flushing;
+		//workers currently touching the stage's buffers, a flush waits for this to drain before swapping buffers under them
+		std::atomic<uint32_t> m_active_workers;
+		//tasks for the stage queued or running, never more than m_thread_count
+		std::atomic<uint32_t> m_scheduled;
+		//where the next search for the entry state starts, shared by the workers running the stage so they take blocks in order
+		std::atomic<size_t> m_cursor;
+		//ordered stages: the ticket of the next run claimed, runs are numbered in block order as only the block at the cursor is claimed
+		std::atomic<uint64_t> m_next_ticket;
+		//ordered stages: per output channel, the ticket of the run whose turn it is to process the channel
+		std::unique_ptr<std::atomic<uint64_t>[]> m_channel_turns;
+		//the output channels, and the tasks that can make progress at once: an ordered stage gains nothing from more workers than channels
+		size_t m_channel_count;
+		uint32_t m_task_limit;
 
 	public:
-		pipeline_stage(uint8_t entry_block_state, uint8_t thread_count = 1, uint8_t in_buffer_idx = 0, uint8_t out_buffer_idx = 0, uint8_t offset = 0);
+		stage_control(uint8_t entry_block_state, uint8_t thread_count = 1, uint8_t in_buffer_idx = 0, uint8_t out_buffer_idx = 0, uint8_t offset = 0, bool ordered = false, uint8_t input_count = 1);
 
-		pipeline_stage(const pipeline_stage&) noexcept = default;
-		pipeline_stage& operator=(const pipeline_stage&) noexcept = default;
+		stage_control(const stage_control&) noexcept = default;
+		stage_control& operator=(const stage_control&) noexcept = default;
 
-		pipeline_stage(pipeline_stage&&) noexcept = default;
-		pipeline_stage& operator=(pipeline_stage&) noexcept = default;
+		stage_control(stage_control&&) noexcept = default;
+		stage_control& operator=(stage_control&) noexcept = default;
 
 		__forceinline uint8_t get_entry_state() const noexcept;
+	};
+
+	/// <summary>
+	/// the stage semantics the pipeline relies on, checked at compile time instead of through a vtable
+	///
+	/// a stage derives from stage_control and provides
+	///   sample_state process_block(const pipeline_state&, const sample_block& in, sample_block& out, int block_count) noexcept
+	///   void init(std::vector<audio_ring_buffer>&)
+	///   void cleanup() noexcept
+	/// and optionally process_blocks (see pipeline_stage) to handle a whole claimed run, every channel included, per call,
+	/// process_inputs to read the run from every one of its input buffers, and process_channel to handle one channel of a run
+	/// when the stage is ordered and run by several workers
+	///
+	/// the blocks and buffers are those of the format the stage runs at, the engine's default unless given
+	/// </summary>
+	template <typename S, size_t BlockSize = sample_block_size, uint32_t SampleRate = sample_rate>
+	concept static_stage = std::derived_from<S, stage_control> && requires(
+		S& stage,
+		const pipeline_state& state,
+		const basic_sample_block<BlockSize>& in_block,
+		basic_sample_block<BlockSize>& out_block,
+		std::vector<basic_audio_ring_buffer<BlockSize, SampleRate>>& buffers
+	) {
+		{ stage.process_block(state, in_block, out_block, int(0)) } noexcept -> std::same_as<sample_state>;
+		stage.init(buffers);
+		{ stage.cleanup() } noexcept;
+	};
+
+	template <typename S, size_t BlockSize = sample_block_size, uint32_t SampleRate = sample_rate>
+	concept static_run_stage = static_stage<S, BlockSize, SampleRate> && requires(
+		S& stage,
+		const pipeline_state& state,
+		std::span<const basic_sample_block<BlockSize>> in_blocks,
+		std::span<basic_sample_block<BlockSize>> out_blocks,
+		std::span<sample_state> out_states
+	) {
+		{ stage.process_blocks(state, in_blocks, out_blocks, out_states, int(0)) } noexcept;
+	};
 
-		//returns the output state, only gets called on blocks matching the entry state
+	template <typename S, size_t BlockSize = sample_block_size, uint32_t SampleRate = sample_rate>
+	concept static_multi_input_stage = static_stage<S, BlockSize, SampleRate> && requires(
+		S& stage,
+		const pipeline_state& state,
+		std::span<const std::span<const basic_sample_block<BlockSize>>> inputs,
+		std::span<basic_sample_block<BlockSize>> out_blocks,
+		std::span<sample_state> out_states
+	) {
+		{ stage.process_inputs(state, inputs, out_blocks, out_states, int(0)) } noexcept;
+	};
+
+	template <typename S, size_t BlockSize = sample_block_size, uint32_t SampleRate = sample_rate>
+	concept static_channel_stage = static_stage<S, BlockSize, SampleRate> && requires(
+		S& stage,
+		const pipeline_state& state,
+		std::span<const basic_sample_block<BlockSize>> in_blocks,
+		std::span<basic_sample_block<BlockSize>> out_blocks,
+		std::span<sample_state> out_states
+	) {
+		{ stage.process_channel(state, size_t(0), in_blocks, out_blocks, out_states, int(0)) } noexcept;
+	};
+
+	/// <summary>
+	/// runs a claimed run through a stage that only implements process_block, one call per channel of every block with the block's
+	/// block_count, so such a stage mustn't carry state between calls. Channel c reads input channel c, or the last input channel
+	/// when the input buffer has fewer channels than the output
+	/// </summary>
+	template <size_t BlockSize, typename F>
+	__forceinline void process_run_by_block(
+		std::span<const basic_sample_block<BlockSize>> in_blocks,
+		std::span<basic_sample_block<BlockSize>> out_blocks,
+		std::span<sample_state> out_states,
+		int block_count,
+		F&& process_block
+	) noexcept {
+		size_t in_channels = in_blocks.size() / out_states.size();
+		size_t out_channels = out_blocks.size() / out_states.size();
+		for (size_t i = 0; i < out_states.size(); i++)
+			for (size_t c = 0; c < out_channels; c++)
+				out_states[i] = process_block(in_blocks[i * in_channels + std::min(c, in_channels - 1)], out_blocks[i * out_channels + c], block_count + static_cast<int>(i));
+	}
+
+	//the same for one channel of the run, block by block in order
+	template <size_t BlockSize, typename F>
+	__forceinline void process_channel_by_block(
+		size_t channel,
+		std::span<const basic_sample_block<BlockSize>> in_blocks,
+		std::span<basic_sample_block<BlockSize>> out_blocks,
+		std::span<sample_state> out_states,
+		int block_count,
+		F&& process_block
+	) noexcept {
+		size_t in_channels = in_blocks.size() / out_states.size();
+		size_t out_channels = out_blocks.size() / out_states.size();
+		for (size_t i = 0; i < out_states.size(); i++)
+			out_states[i] = process_block(in_blocks[i * in_channels + std::min(channel, in_channels - 1)], out_blocks[i * out_channels + channel], block_count + static_cast<int>(i));
+	}
+
+	/// <summary>
+	/// the type-erased stage, kept as an adapter so stages can still be chosen at runtime and held as unique_ptr<pipeline_stage>
+	/// a pipeline built from pipeline_stage pointers dispatches every call through the vtable, one built from the concrete types
+	/// (static_audio_pipeline) binds the same virtual overrides statically
+	///
+	/// pipeline_stage is the stage at the engine's default format, a stage for another block size or sample rate derives from
+	/// basic_pipeline_stage of that format and only runs in a pipeline of the same format
+	/// </summary>
+	template <size_t BlockSize, uint32_t SampleRate>
+	class basic_pipeline_stage : public stage_control {
+	public:
+		//the stage's format, shadowing the engine defaults so a stage's code reads the same at any block size
+		static constexpr size_t sample_block_size = BlockSize;
+		static constexpr uint32_t sample_rate = SampleRate;
+		using sample_block = basic_sample_block<BlockSize>;
+		using sample_duration_t = basic_sample_duration<SampleRate>;
+		using audio_ring_buffer = basic_audio_ring_buffer<BlockSize, SampleRate>;
+		using pipeline_stage = basic_pipeline_stage; //so a derived stage can still name its base pipeline_stage
+
+		basic_pipeline_stage(uint8_t entry_block_state, uint8_t thread_count = 1, uint8_t in_buffer_idx = 0, uint8_t out_buffer_idx = 0, uint8_t offset = 0, bool ordered = false, uint8_t input_count = 1) :
+			stage_control(entry_block_state, thread_count, in_buffer_idx, out_buffer_idx, offset, ordered, input_count)
+		{};
+
+		virtual ~basic_pipeline_stage() = default;
+
+		//returns the output state, only gets called on blocks matching the entry state, in_block and out_block are a single channel
 		virtual sample_state process_block(
 			const pipeline_state& state, 
 			const sample_block& in_block, 
@@ -66,44 +250,1126 @@ namespace audio_engine {
 			int block_count
 		) noexcept = 0;
 
+		//processes a contiguous run of blocks claimed in one go, block i of the run has the unwrapped block num block_count + i
+		//the block spans hold every channel of the run, planar and block major: channel c of block i is in_blocks[i * in_channels + c]
+		//with in_channels = in_blocks.size() / out_states.size(), and likewise for the output
+		//writes the output state of every block into out_states (one per block, not per channel)
+		//the default forwards each channel of each block to process_block, override it to pay the per-call cost once per run
+		virtual void process_blocks(
+			const pipeline_state& state,
+			std::span<const sample_block> in_blocks,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) noexcept
+		{
+			process_run_by_block(in_blocks, out_blocks, out_states, block_count, [&](const sample_block& in_block, sample_block& out_block, int block) {
+				return process_block(state, in_block, out_block, block);
+			});
+		};
+
+		//processes a claimed run of a stage with an input_count above 1, inputs[k] is the run in its k'th input buffer laid out as
+		//in_blocks is for process_blocks, the same blocks of every input. The buffers after the first are passes handed to the node
+		//by its in edges (see pipeline_graph::connect) so they're whole by the time the first is claimed
+		//the default runs process_blocks on the first input
+		virtual void process_inputs(
+			const pipeline_state& state,
+			std::span<const std::span<const sample_block>> inputs,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) noexcept
+		{
+			process_blocks(state, inputs.front(), out_blocks, out_states, block_count);
+		};
+
+		//processes one channel of a claimed run, laid out as for process_blocks, touching only that channel of the blocks and of
+		//the stage's state. Only called on an ordered stage with a thread_count above 1 whose processes_channels is true: the
+		//channels of a run are processed one after another, and a channel only once the run before is done with it, so different
+		//channels run on different workers at once. Every channel writes the run's out_states, the last one's stand
+		//channel runs over the output buffer's channels, so per channel state has to be made for the output's channel count at init
+		//the default forwards each block of the channel to process_block, for a stage whose process_block already is its whole
+		//per channel path
+		virtual void process_channel(
+			const pipeline_state& state,
+			size_t channel,
+			std::span<const sample_block> in_blocks,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) noexcept
+		{
+			process_channel_by_block(channel, in_blocks, out_blocks, out_states, block_count, [&](const sample_block& in_block, sample_block& out_block, int block) {
+				return process_block(state, in_block, out_block, block);
+			});
+		};
+
+		//whether an ordered stage with a thread_count above 1 may run its channels on several workers through process_channel,
+		//a stage that overrides process_channel returns true. Otherwise its runs go through process_blocks one at a time, the
+		//default process_channel would quietly swap the stage's own process_blocks for its process_block
+		virtual bool processes_channels() const noexcept
+		{
+			return false;
+		};
 
 		virtual void init(std::vector<audio_ring_buffer>& buffers) = 0;
 
 		virtual void cleanup() noexcept = 0;
 	};
 
+	using pipeline_stage = basic_pipeline_stage<sample_block_size, sample_rate>;
+
+	static_assert(static_run_stage<pipeline_stage>);
+	static_assert(static_multi_input_stage<pipeline_stage>);
+	static_assert(static_channel_stage<pipeline_stage>);
+
+	/// <summary>
+	/// static dispatch for a stage of concrete type S
+	///
+	/// the calls are qualified (stage.S::f) so a virtual override of a concrete stage is bound at compile time and can be inlined
+	/// into the worker, only an abstract S (the pipeline_stage adapter) goes through the vtable
+	/// </summary>
+	template <typename S, size_t BlockSize = sample_block_size, uint32_t SampleRate = sample_rate>
+		requires static_stage<S, BlockSize, SampleRate>
+	struct stage_dispatch {
+		using sample_block = basic_sample_block<BlockSize>;
+		using audio_ring_buffer = basic_audio_ring_buffer<BlockSize, SampleRate>;
+
+		static constexpr bool s_virtual = std::is_abstract_v<S>;
+
+		//pipeline_stage's default process_blocks calls process_block through the vtable, so a stage that doesn't override it gets the loop inlined here instead
+		static constexpr bool has_own_process_blocks() {
+			if constexpr (static_run_stage<S, BlockSize, SampleRate>)
+				return !std::is_same_v<decltype(&S::process_blocks), decltype(&basic_pipeline_stage<BlockSize, SampleRate>::process_blocks)>;
+			else
+				return false;
+		};
+
+		static constexpr bool has_own_process_inputs() {
+			if constexpr (static_multi_input_stage<S, BlockSize, SampleRate>)
+				return !std::is_same_v<decltype(&S::process_inputs), decltype(&basic_pipeline_stage<BlockSize, SampleRate>::process_inputs)>;
+			else
+				return false;
+		};
+
+		static constexpr bool has_own_process_channel() {
+			if constexpr (static_channel_stage<S, BlockSize, SampleRate>)
+				return !std::is_same_v<decltype(&S::process_channel), decltype(&basic_pipeline_stage<BlockSize, SampleRate>::process_channel)>;
+			else
+				return false;
+		};
+
+		//whether the stage's channels can be run on several workers, a concrete stage's own process_channel is seen at compile time
+		//and a stage bound through the vtable is asked
+		static bool processes_channels(const S& stage) noexcept {
+			if constexpr (s_virtual)
+				return stage.processes_channels();
+			else
+				return has_own_process_channel();
+		};
+
+		static __forceinline sample_state process_block(S& stage, const pipeline_state& state, const sample_block& in_block, sample_block& out_block, int block_count) noexcept {
+			if constexpr (s_virtual)
+				return stage.process_block(state, in_block, out_block, block_count);
+			else
+				return stage.S::process_block(state, in_block, out_block, block_count);
+		};
+
+		static __forceinline void process_blocks(
+			S& stage,
+			const pipeline_state& state,
+			std::span<const sample_block> in_blocks,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) noexcept {
+			if constexpr (s_virtual)
+				stage.process_blocks(state, in_blocks, out_blocks, out_states, block_count);
+			else if constexpr (has_own_process_blocks())
+				stage.S::process_blocks(state, in_blocks, out_blocks, out_states, block_count);
+			else
+				process_run_by_block(in_blocks, out_blocks, out_states, block_count, [&](const sample_block& in_block, sample_block& out_block, int block) {
+					return stage.S::process_block(state, in_block, out_block, block);
+				});
+		};
+
+		static __forceinline void process_inputs(
+			S& stage,
+			const pipeline_state& state,
+			std::span<const std::span<const sample_block>> inputs,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) noexcept {
+			if constexpr (s_virtual)
+				stage.process_inputs(state, inputs, out_blocks, out_states, block_count);
+			else if constexpr (has_own_process_inputs())
+				stage.S::process_inputs(state, inputs, out_blocks, out_states, block_count);
+			else
+				process_blocks(stage, state, inputs.front(), out_blocks, out_states, block_count);
+		};
+
+		static __forceinline void process_channel(
+			S& stage,
+			const pipeline_state& state,
+			size_t channel,
+			std::span<const sample_block> in_blocks,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) noexcept {
+			if constexpr (s_virtual)
+				stage.process_channel(state, channel, in_blocks, out_blocks, out_states, block_count);
+			else if constexpr (has_own_process_channel())
+				stage.S::process_channel(state, channel, in_blocks, out_blocks, out_states, block_count);
+			else
+				process_channel_by_block(channel, in_blocks, out_blocks, out_states, block_count, [&](const sample_block& in_block, sample_block& out_block, int block) {
+					return stage.S::process_block(state, in_block, out_block, block);
+				});
+		};
+
+		static void init(stage_control& stage, std::vector<audio_ring_buffer>& buffers) {
+			if constexpr (s_virtual)
+				static_cast<S&>(stage).init(buffers);
+			else
+				static_cast<S&>(stage).S::init(buffers);
+		};
+
+		static void cleanup(stage_control& stage) noexcept {
+			if constexpr (s_virtual)
+				static_cast<S&>(stage).cleanup();
+			else
+				static_cast<S&>(stage).S::cleanup();
+		};
+	};
+
 
-	class audio_pipeline
+	/// <summary>
+	/// runs a graph of stages over a pool of workers shared by every stage
+	///
+	/// the nodes of the graph are stages (or a chain of stages) over their own ring buffers, the edges carry each pass a node
+	/// finishes on to the nodes it feeds. A node takes its next pass as soon as every edge into it has one waiting, so branches
+	/// run side by side on the pool and only a node and its neighbours wait on each other. The original topology, a group of
+	/// generator, processing and output stages, is the three node chain built by the group constructors
+	///
+	/// the block size and sample rate are template parameters so the claim loop and the stage calls it inlines are compiled for
+	/// the format, audio_pipeline is the pipeline at the engine's default format and pipelines of other formats run side by side
+	/// </summary>
+	template <size_t BlockSize, uint32_t SampleRate>
+	class basic_audio_pipeline
 	{
+	public:
+		//the pipeline's format, every stage and buffer it runs is of the same one
+		static constexpr size_t sample_block_size = BlockSize;
+		static constexpr uint32_t sample_rate = SampleRate;
+		using sample_block = basic_sample_block<BlockSize>;
+		using sample_duration_t = basic_sample_duration<SampleRate>;
+		using audio_ring_buffer = basic_audio_ring_buffer<BlockSize, SampleRate>;
+		using pipeline_stage = basic_pipeline_stage<BlockSize, SampleRate>;
+
+	protected:
+		struct stage_binding;
+		using stage_group = std::vector<stage_binding>;
+
+		struct worker_context;
+
+		/// <summary>
+		/// a stage together with the functions instantiated for its concrete type, a binding is also the task the worker pool schedules
+		/// the pipeline schedules and flushes through stage_control, running the task runs run_stage<S> for the stage's real type
+		/// </summary>
+		struct stage_binding {
+			stage_control* stage;
+			void (*init)(stage_control&, std::vector<audio_ring_buffer>&);
+			void (*cleanup)(stage_control&) noexcept;
+			void (basic_audio_pipeline::*run)(stage_binding&, worker_context&);
+
+			//set by run() once the stage's buffers are known
+			audio_ring_buffer* from_buffer;
+			audio_ring_buffer* to_buffer;
+			stage_group* group; //the stages of the node the stage belongs to
+			const std::atomic<uint64_t>* pass_count;
+			size_t index; //position over every group, indexes the stage's counters
+			bool in_turn; //an ordered stage whose channels run on several workers, see process_channels_in_turn
+		};
+
+		//a pool worker, owns the deque the tasks it makes ready go to and the counters of the work it does
+		struct worker_context {
+			size_t index;
+			work_stealing_deque<stage_binding> tasks;
+			worker_counters counters;
+			std::unique_ptr<stage_counters[]> stages; //one per stage, by stage_binding::index
+
+			worker_context(size_t idx, size_t capacity, size_t stage_count) :
+				index(idx),
+				tasks(capacity),
+				counters(),
+				stages(std::make_unique<stage_counters[]>(metrics_enabled ? stage_count : 0))
+			{}
+		};
+
+		template <static_stage<BlockSize, SampleRate> S>
+		static stage_binding bind_stage(S& stage) {
+			return stage_binding{
+				&stage,
+				&stage_dispatch<S, BlockSize, SampleRate>::init,
+				&stage_dispatch<S, BlockSize, SampleRate>::cleanup,
+				&basic_audio_pipeline::run_stage<S>,
+				nullptr,
+				nullptr,
+				nullptr,
+				nullptr,
+				0,
+				stage.m_ordered && stage.m_thread_count > 1 && stage_dispatch<S, BlockSize, SampleRate>::processes_channels(stage)
+			};
+		};
+
+	public:
+		/// <summary>
+		/// the topology of a pipeline, nodes of stages joined by edges that carry every pass a node finishes out of its last buffer
+		/// and into a buffer of the node it feeds
+		///
+		/// a node's stages claim and publish blocks through its buffers exactly as a group's do, its first buffer (or whichever
+		/// buffer an edge feeds) is where passes arrive and its last buffer is what it hands on once every block there is processed.
+		/// A node feeding several others (fan out) hands each of them the same pass, a node fed by several (fan in) only starts once
+		/// every one of them has handed it a pass, so its stages can read all of its inputs at any block of the pass
+		///
+		/// audio_engine::pipeline_graph graph;
+		/// auto source = graph.add_node(std::move(generator), make_vector(audio_ring_buffer(96)));
+		/// auto wet = graph.add_node(std::move(reverb_stages), make_vector(audio_ring_buffer(96), audio_ring_buffer(96)));
+		/// auto mix = graph.add_node(std::move(output), make_vector(audio_ring_buffer(96), audio_ring_buffer(96)));
+		/// graph.connect(source, wet);
+		/// graph.connect(wet, mix, 0);
+		/// graph.connect(source, mix, 1); //the dry signal, the second input of a two input stage (see process_inputs)
+		/// audio_engine::audio_pipeline pipeline(std::move(graph));
+		/// </summary>
+		class graph {
+		public:
+			using node_id = size_t;
+
+		private:
+			friend class basic_audio_pipeline;
+
+			struct node {
+				stage_group stages;
+				std::vector<audio_ring_buffer> buffers;
+			};
+
+			struct edge {
+				node_id from;
+				node_id to;
+				uint8_t buffer_idx;
+			};
+
+			std::vector<std::unique_ptr<pipeline_stage>> m_owned_stages;
+			std::vector<node> m_nodes;
+			std::vector<edge> m_edges;
+
+			node_id add_bound_node(stage_group stages, std::vector<audio_ring_buffer> buffers) {
+				if (stages.empty())
+					throw std::domain_error("audio_pipeline::graph::add_node(stages, buffers) : requires at least one stage");
+				if (buffers.empty())
+					throw std::domain_error("audio_pipeline::graph::add_node(stages, buffers) : requires at least one buffer");
+
+				m_nodes.push_back(node{ std::move(stages), std::move(buffers) });
+				return m_nodes.size() - 1;
+			};
+
+		public:
+			//a node of stages chosen at runtime, the graph owns them and every stage call goes through the pipeline_stage vtable
+			node_id add_node(std::vector<std::unique_ptr<pipeline_stage>> stages, std::vector<audio_ring_buffer> buffers) {
+				node_id id = add_bound_node(bind_stages(stages), std::move(buffers));
+				for (auto& stage : stages)
+					m_owned_stages.push_back(std::move(stage));
+				return id;
+			};
+
+			node_id add_node(std::unique_ptr<pipeline_stage> stage, std::vector<audio_ring_buffer> buffers) {
+				return add_node(make_vector(std::move(stage)), std::move(buffers));
+			};
+
+			//a node of stages of concrete types, bound statically, the caller keeps them alive for the lifetime of the pipeline
+			template <static_stage<BlockSize, SampleRate>... S>
+				requires (sizeof...(S) > 0)
+			node_id add_node(std::vector<audio_ring_buffer> buffers, S&... stages) {
+				return add_bound_node(stage_group{ bind_stage(stages)... }, std::move(buffers));
+			};
+
+			/// <summary>
+			/// hands every pass from finishes on to to, swapped into to's buffer buffer_idx
+			///
+			/// the pass arrives in the entry state of the first of to's stages that claims from that buffer, or in the default
+			/// state when none of them does and the buffer is only read alongside another (the second input of a mix). Passes move
+			/// by swapping storage so the two buffers must be the same shape
+			/// </summary>
+			void connect(node_id from, node_id to, uint8_t buffer_idx = 0) {
+				if (from >= m_nodes.size() || to >= m_nodes.size())
+					throw std::domain_error("audio_pipeline::graph::connect(from, to, buffer_idx) : no such node");
+				if (from == to)
+					throw std::domain_error("audio_pipeline::graph::connect(from, to, buffer_idx) : a node can't feed itself");
+				if (buffer_idx >= m_nodes[to].buffers.size())
+					throw std::domain_error("audio_pipeline::graph::connect(from, to, buffer_idx) : buffer_idx is out of range of to's buffers");
+
+				for (auto& existing : m_edges)
+					if (existing.to == to && existing.buffer_idx == buffer_idx)
+						throw std::domain_error("audio_pipeline::graph::connect(from, to, buffer_idx) : the buffer is already fed by another edge");
+
+				auto& out = m_nodes[from].buffers.back();
+				auto& in = m_nodes[to].buffers[buffer_idx];
+				if (out.m_block_count != in.m_block_count)
+					throw std::domain_error("audio_pipeline::graph::connect(from, to, buffer_idx) : requires matching block_count between the last buffer of from and the buffer of to");
+				if (out.m_channel_count != in.m_channel_count)
+					throw std::domain_error("audio_pipeline::graph::connect(from, to, buffer_idx) : requires matching channel_count between the last buffer of from and the buffer of to");
+				if (out.get_state_layout() != in.get_state_layout())
+					throw std::domain_error("audio_pipeline::graph::connect(from, to, buffer_idx) : requires matching state layouts between the last buffer of from and the buffer of to");
+
+				m_edges.push_back(edge{ from, to, buffer_idx });
+			};
+
+			size_t node_count() const noexcept {
+				return m_nodes.size();
+			};
+		};
+
+	protected:
+		//a node at run time
+		struct graph_node {
+			stage_group stages;
+			std::vector<audio_ring_buffer> buffers;
+			std::vector<size_t> inputs;  //edges into the node, by index into m_edges
+			std::vector<size_t> outputs; //edges out of the node, each is handed every pass of the last buffer
+			//the pass the node is working on, stages use it to number blocks so a pass keeps its block numbers through the graph
+			std::atomic<uint64_t>* pass_count;
+			bool has_pass; //a sink has taken a pass before, the next one it takes finishes it
+		};
+
+		//an edge at run time, only touched by the run loop
+		struct graph_edge {
+			size_t from;
+			size_t to;
+			uint8_t buffer_idx;
+			//handoff slot between the nodes, a finished pass is swapped in here until the node it feeds is idle and swaps it out again
+			//together with the buffers either side this triple buffers each edge so the producing node never waits on a copy
+			audio_ring_buffer handoff;
+			bool pending;
+		};
+
 	private:
 		pipeline_state m_state;
-		std::vector<std::unique_ptr<pipeline_stage>> m_generator_stages;
-		std::vector<std::unique_ptr<pipeline_stage>> m_processing_stages; //owns the stages, holds them by ptr to not slice the dynamic class data if we ever did a copy
-		std::vector<std::unique_ptr<pipeline_stage>> m_output_stages;
-		std::vector<audio_ring_buffer> m_generator_buffers;
-		std::vector<audio_ring_buffer> m_processing_buffers;
-		std::vector<audio_ring_buffer> m_output_buffers;
+		std::vector<std::unique_ptr<pipeline_stage>> m_owned_stages; //the stages of a pipeline built at runtime, held by ptr to not slice the dynamic class data
+		std::unique_ptr<std::atomic<uint64_t>[]> m_pass_counts; //one per node
+		std::vector<graph_node> m_nodes;
+		std::vector<graph_edge> m_edges;
+		//every node after the nodes feeding it, so a pass handed on in one sweep of the run loop can be taken in the same sweep
+		std::vector<size_t> m_order;
+		//the nodes without outputs, the output of the graph, they take their passes together one period at a time
+		std::vector<size_t> m_sinks;
 		std::vector<std::jthread> m_threads;
+		std::vector<std::unique_ptr<worker_context>> m_workers;
+		size_t m_worker_count;
+		//tasks scheduled from outside the pool (the run loop after a flush), workers take from here before stealing
+		std::mutex m_injection_lock;
+		std::deque<stage_binding*> m_injected;
+		std::atomic<size_t> m_injected_count;
+		//idle pool workers park here until a task is scheduled
+		event_count m_work_wake;
+		//the run loop parks here until a worker publishes blocks that might complete a flush
+		event_count m_flush_wake;
+		park_policy m_park_policy;
 
-	public:
-		//accept implicits e.g. initializer_list of unique_ptr<pipeline_stage>
-		~audio_pipeline() {
-			for (auto& stage : m_generator_stages)
-				stage->cleanup();
-			for (auto& stage : m_processing_stages)
-				stage->cleanup();
-			for (auto& stage : m_output_stages)
-				stage->cleanup();
-		}
+		using clock = std::chrono::steady_clock;
 
-		audio_pipeline(
-			std::vector<std::unique_ptr<pipeline_stage>> generator_stages,
-			std::vector<std::unique_ptr<pipeline_stage>> processing_stages,
-			std::vector<std::unique_ptr<pipeline_stage>> output_stages,
+		execution_mode m_mode;
+		//offline: the output passes to render, the output group stops taking passes once it has this many
+		uint64_t m_render_passes;
+		//the period accounting below is only touched by the run loop, the counters are atomic so stats can be read during a run
+		std::atomic<clock::time_point> m_run_start;
+		std::atomic<clock::time_point> m_run_end;
+		clock::time_point m_period_deadline; //real time: when the output group is due to take its next pass
+		bool m_period_checked; //the current period's deadline has been checked for an xrun
+		std::atomic<uint64_t> m_output_passes;
+		std::atomic<uint64_t> m_underruns;
+		std::atomic<uint64_t> m_overruns;
+		std::atomic<int64_t> m_worst_lateness_ns;
+		//real time: wakes the parked run loop at each period deadline, nothing else publishes the passage of time
+		std::jthread m_period_clock;
+		std::mutex m_clock_lock;
+		std::condition_variable_any m_clock_wake;
+		clock::time_point m_clock_deadline; //the clock thread's copy of the deadline, guarded by m_clock_lock
+
+		//flush stalls per node, written by the run loop
+		std::unique_ptr<latency_recorder[]> m_flush_latency;
+		//held while run() replaces the workers so a metrics snapshot never walks a vector being rebuilt
+		mutable std::mutex m_metrics_lock;
+
+		//upper bound on the blocks a worker claims per iteration, one 8 byte word of block states
+		static constexpr int s_max_claim_blocks = 8;
+
+		//the blocks of one pass, the same on every edge
+		size_t pass_blocks() const {
+			return m_edges.front().handoff.m_block_count;
+		};
+
+		//one pass of the output buffer in wall clock time
+		clock::duration period_duration() const {
+			return std::chrono::duration_cast<clock::duration>(sample_duration_t(pass_blocks() * sample_block_size));
+		};
+
+		//whether the output group may take its next pass yet, passes wait for their period in real time and stop at the end of an offline render
+		bool output_due() const {
+			if (m_mode == execution_mode::offline)
+				return m_output_passes.load(std::memory_order_relaxed) < m_render_passes;
+			if (m_mode == execution_mode::real_time && m_output_passes.load(std::memory_order_relaxed) != 0)
+				return clock::now() >= m_period_deadline;
+			return true;
+		};
+
+		//an offline render is done once the sinks have taken their last pass and consumed all of it
+		bool render_finished() const {
+			return m_mode == execution_mode::offline
+				&& m_output_passes.load(std::memory_order_relaxed) == m_render_passes
+				&& sinks_idle();
+		};
+
+		void set_period_deadline(clock::time_point deadline) {
+			m_period_deadline = deadline;
+			m_period_checked = false;
+			{
+				std::lock_guard lock(m_clock_lock);
+				m_clock_deadline = deadline;
+			}
+			m_clock_wake.notify_one();
+		};
+
+		/// <summary>
+		/// real time: once the current period's deadline has passed, counts an xrun if the output group couldn't take its pass on time
+		/// </summary>
+		void check_period_deadline() {
+			if (m_mode != execution_mode::real_time || m_period_checked || m_output_passes.load(std::memory_order_relaxed) == 0)
+				return;
+			if (clock::now() < m_period_deadline)
+				return;
+
+			m_period_checked = true;
+			if (!sinks_fed())
+				m_underruns.fetch_add(1, std::memory_order_relaxed);
+			else if (!sinks_idle())
+				m_overruns.fetch_add(1, std::memory_order_relaxed);
+		};
+
+		//the output group took a pass, move the real time schedule on to the next period
+		void output_pass_taken() {
+			m_output_passes.fetch_add(1, std::memory_order_relaxed);
+			if (m_mode != execution_mode::real_time)
+				return;
+
+			auto now = clock::now();
+			if (m_output_passes.load(std::memory_order_relaxed) == 1) {
+				//the stream starts once the first pass is ready, the time spent filling the pipeline isn't a deadline miss
+				set_period_deadline(now + period_duration());
+				return;
+			}
+
+			auto lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_period_deadline).count();
+			if (lateness > m_worst_lateness_ns.load(std::memory_order_relaxed))
+				m_worst_lateness_ns.store(lateness, std::memory_order_relaxed);
+
+			//stay on the absolute schedule so a late period is caught up, unless it's so late the next deadline has already gone
+			auto next = m_period_deadline + period_duration();
+			set_period_deadline(next > now ? next : now + period_duration());
+		};
+
+		/// <summary>
+		/// real time: sleeps until the current deadline and wakes the run loop, then waits for the run loop to set the next one
+		/// </summary>
+		void period_clock(std::stop_token token)
+		{
+			std::unique_lock lock(m_clock_lock);
+			while (!token.stop_requested()) {
+				auto deadline = m_clock_deadline;
+				auto moved = [&] { return m_clock_deadline != deadline; };
+
+				bool reached = deadline == clock::time_point::max()
+					? (m_clock_wake.wait(lock, token, moved), false)
+					: !m_clock_wake.wait_until(lock, token, deadline, moved);
+				if (!reached)
+					continue;
+
+				m_flush_wake.notify_all();
+				m_clock_wake.wait(lock, token, moved);
+			}
+		};
+
+		void set_execution_state(pipeline_execution_state state) {
+			m_state.execution_state.store(state);
+			m_state.execution_state.notify_all();
+
+			//parked workers and the run loop recheck the execution state when woken
+			m_work_wake.notify_all();
+			m_flush_wake.notify_all();
+		};
+
+		//a group has finished its pass when its last buffer is processed 100%
+		static bool pass_finished(const std::vector<audio_ring_buffer>& buffers) {
+			return buffers.back().all_in_state(sample_block_state_processed);
+		};
+
+		//a group can take the next pass when its buffers are already flushed
+		static bool group_idle(const std::vector<audio_ring_buffer>& buffers) {
+			return buffers.front().all_in_state(sample_block_state_default)
+				&& buffers.back().all_in_state(sample_block_state_default);
+		};
+
+		//every edge into the node has a pass waiting
+		bool inputs_pending(const graph_node& node) const {
+			return std::all_of(node.inputs.begin(), node.inputs.end(), [&](size_t e) { return m_edges[e].pending; });
+		};
+
+		//the node can hand on a finished pass, every edge out of it has taken the previous one
+		bool can_hand_off(const graph_node& node) const {
+			return !node.outputs.empty()
+				&& std::none_of(node.outputs.begin(), node.outputs.end(), [&](size_t e) { return m_edges[e].pending; })
+				&& pass_finished(node.buffers);
+		};
+
+		//a node inside the graph can take its next pass, the sinks take theirs together (see sinks_fed)
+		bool can_take(const graph_node& node) const {
+			return !node.inputs.empty() && !node.outputs.empty() && inputs_pending(node) && group_idle(node.buffers);
+		};
+
+		bool sinks_fed() const {
+			return std::all_of(m_sinks.begin(), m_sinks.end(), [&](size_t n) { return inputs_pending(m_nodes[n]); });
+		};
+
+		bool sinks_idle() const {
+			return std::all_of(m_sinks.begin(), m_sinks.end(), [&](size_t n) { return group_idle(m_nodes[n].buffers); });
+		};
+
+		bool flush_ready() const {
+			for (auto& node : m_nodes)
+				if (can_hand_off(node) || can_take(node))
+					return true;
+
+			return (sinks_fed() && sinks_idle() && output_due()) || render_finished();
+		};
+
+		//times a flush from stopping the node's workers to rescheduling them, the time the node can't make progress
+		struct flush_timer {
+			basic_audio_pipeline& pipeline;
+			size_t node_index;
+			std::chrono::steady_clock::time_point start;
+
+			flush_timer(basic_audio_pipeline& p, size_t n) : pipeline(p), node_index(n), start() {
+				if constexpr (metrics_enabled)
+					start = std::chrono::steady_clock::now();
+			}
+
+			~flush_timer() {
+				if constexpr (metrics_enabled) {
+					auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+					pipeline.m_flush_latency[node_index].record(static_cast<uint64_t>(ns));
+				}
+			}
+		};
+
+		//stops the group's workers and waits until none of them is still touching its buffers
+		void begin_flush(stage_group& group) {
+			for (auto& binding : group)
+				binding.stage->m_flushing.store(true);
+
+			for (auto& binding : group)
+				while (binding.stage->m_active_workers.load() != 0)
+					std::this_thread::yield();
+		};
+
+		/// <summary>
+		/// the node finished a pass: swap its last buffer into the slot of its first out edge and continue on the slot's old storage
+		/// the other out edges get a copy, made once the node is back at work
+		/// </summary>
+		void hand_off_pass(size_t node_index) {
+			auto& node = m_nodes[node_index];
+			auto& first = m_edges[node.outputs.front()];
+			{
+				flush_timer timer(*this, node_index);
+				begin_flush(node.stages);
+
+				node.pass_count->fetch_add(1);
+				node.buffers.back().swap_storage(first.handoff);
+				node.buffers.front().fill_states(sample_block_state_default);
+				node.buffers.back().fill_states(sample_block_state_default);
+
+				end_flush(node.stages);
+			}
+
+			for (size_t i = 1; i < node.outputs.size(); i++)
+				first.handoff.copy_to(m_edges[node.outputs[i]].handoff);
+			for (size_t e : node.outputs)
+				m_edges[e].pending = true;
+		};
+
+		//the state a pass arrives in, the entry state of the first stage claiming from the buffer, default for a buffer only read alongside another
+		static sample_state arrival_state(const stage_group& group, size_t buffer_idx) {
+			for (auto& binding : group)
+				if (binding.stage->m_in_buffer_idx == buffer_idx)
+					return binding.stage->m_entry_block_state;
+			return sample_block_state_default;
+		};
+
+		/// <summary>
+		/// the node is idle: swap the pending pass of every edge into it out of the edge's slot, the slots keep the consumed storage
+		/// </summary>
+		void take_pass(size_t node_index) {
+			auto& node = m_nodes[node_index];
+			flush_timer timer(*this, node_index);
+			begin_flush(node.stages);
+
+			for (size_t e : node.inputs) {
+				auto& edge = m_edges[e];
+				auto& buffer = node.buffers[edge.buffer_idx];
+				buffer.swap_storage(edge.handoff);
+				buffer.fill_states(arrival_state(node.stages, edge.buffer_idx));
+				edge.handoff.fill_states(sample_block_state_default);
+				edge.pending = false;
+			}
+
+			end_flush(node.stages);
+		};
+
+		//tasks that ran into the flush dropped out, so every stage of the group gets a task for the freshly flushed buffers
+		void end_flush(stage_group& group) {
+			for (auto& binding : group)
+				binding.stage->m_flushing.store(false);
+
+			for (auto& binding : group)
+				schedule(binding, nullptr);
+		};
+
+		/// <summary>
+		/// queues a task for the stage, unless it already has as many tasks queued or running as can make progress at once
+		/// (thread_count, or the channel count of an ordered stage if that's lower), those will find the new blocks
+		/// </summary>
+		/// <param name="worker">the calling pool worker, whose deque takes the task, or nullptr from outside the pool</param>
+		void schedule(stage_binding& binding, worker_context* worker) {
+			auto& stage = *binding.stage;
+			uint32_t scheduled = stage.m_scheduled.load();
+			do {
+				if (scheduled >= stage.m_task_limit)
+					return;
+			} while (!stage.m_scheduled.compare_exchange_weak(scheduled, scheduled + 1));
+
+			//the deques are sized for every task that can exist, a failed push can't happen but falls back to the injection queue
+			if (worker == nullptr || !worker->tasks.push(&binding)) {
+				std::lock_guard lock(m_injection_lock);
+				m_injected.push_back(&binding);
+				m_injected_count.fetch_add(1);
+			}
+
+			m_work_wake.notify_one();
+		};
+
+		//the worker's own newest task, else the oldest injected task, else one stolen from the other workers
+		stage_binding* take_task(worker_context& worker) {
+			if (auto* task = worker.tasks.pop())
+				return task;
+
+			if (m_injected_count.load() != 0) {
+				std::lock_guard lock(m_injection_lock);
+				if (!m_injected.empty()) {
+					auto* task = m_injected.front();
+					m_injected.pop_front();
+					m_injected_count.fetch_sub(1);
+					return task;
+				}
+			}
+
+			for (size_t i = 1; i < m_workers.size(); i++)
+				if (auto* task = m_workers[(worker.index + i) % m_workers.size()]->tasks.steal())
+					return task;
+
+			return nullptr;
+		};
+
+		bool has_tasks() const {
+			if (m_injected_count.load() != 0)
+				return true;
+
+			for (auto& worker : m_workers)
+				if (!worker->tasks.empty())
+					return true;
+
+			return false;
+		};
+
+		//whether the stage could claim a block right now, an ordered stage only ever claims the block at its cursor
+		static bool has_work(const stage_control& stage, const audio_ring_buffer& from_buffer) {
+			if (stage.m_ordered)
+				return from_buffer.in_state(stage.m_cursor.load(std::memory_order_relaxed), stage.m_entry_block_state);
+
+			return from_buffer.has_state(stage.m_entry_block_state);
+		};
+
+		void execute(stage_binding& task, worker_context& worker) {
+			auto& stage = *task.stage;
+			if constexpr (metrics_enabled)
+				bump_counter(worker.counters.tasks);
+			(this->*task.run)(task, worker);
+			stage.m_scheduled.fetch_sub(1);
+
+			//blocks published while the task was winding down saw the cap reached and scheduled nothing, so look again
+			//(as a worker touching the buffers, so a flush can't swap them under the check)
+			stage.m_active_workers.fetch_add(1);
+			bool more_work = !stage.m_flushing.load() && has_work(stage, *task.from_buffer);
+			stage.m_active_workers.fetch_sub(1);
+
+			if (more_work)
+				schedule(task, &worker);
+		};
+
+		/// <summary>
+		/// the task of a stage, instantiated per concrete stage type so the stage calls are bound statically
+		/// processes runs of blocks until the stage has none left in its entry state, its group flushes or the pipeline stops executing
+		/// </summary>
+		template <static_stage<BlockSize, SampleRate> S>
+		void run_stage(stage_binding& binding, worker_context& worker)
+		{
+			S& stage = static_cast<S&>(*binding.stage);
+
+			while (get_state() == pipeline_execution_state::EXECUTING)
+			{
+				//announce ourselves before checking the flag, a flush that started after the check waits for us to leave before swapping buffers
+				//(all stages in a group (generators), (processors), (outputters) are set to flushing together when the group is flushing)
+				stage.m_active_workers.fetch_add(1);
+				if (stage.m_flushing.load()) {
+					stage.m_active_workers.fetch_sub(1);
+					break;
+				}
+
+				bool found_work = process_next_run(stage, binding, worker);
+				stage.m_active_workers.fetch_sub(1);
+
+				if (!found_work)
+					break;
+			}
+		};
+
+		/// <summary>
+		/// claims, processes and publishes the next run of blocks in the stage's entry state
+		/// </summary>
+		/// <returns>false if there was no block in the entry state, true if the worker should immediately look again</returns>
+		template <static_stage<BlockSize, SampleRate> S>
+		bool process_next_run(S& stage, stage_binding& binding, worker_context& worker)
+		{
+			auto& from_buffer = *binding.from_buffer;
+			auto& to_buffer = *binding.to_buffer;
+
+			//search from where the stage left off so it takes blocks in order, an ordered stage waits for exactly the next block
+			//(acquiring the claim that moved the cursor here, and with it the ticket that claim took)
+			size_t cursor = stage.m_cursor.load(std::memory_order_acquire);
+			int idx;
+			if (stage.m_ordered) {
+				idx = static_cast<int>(cursor % from_buffer.m_block_count);
+				if (!from_buffer.in_state(idx, stage.m_entry_block_state))
+					return false;
+			}
+			else {
+				idx = from_buffer.find_state(stage.m_entry_block_state, cursor);
+				if (idx == -1)
+					return false;
+			}
+
+			auto flush_count = binding.pass_count->load();
+			auto dst_idx = idx + stage.m_offset;
+
+			//the run has to stay contiguous in the destination buffer too, so stop it at the destination wrap
+			int max_blocks = std::min<int>(s_max_claim_blocks, to_buffer.m_block_count - dst_idx % to_buffer.m_block_count);
+
+			/// <summary>
+			/// If we can do an atomic CAS onto the block states (they're in the expected state, put into processing state) 
+			/// then this thread for this stage is allowed to operate on the whole run of blocks
+			/// 
+			/// claim_run retries spurious failures itself, 0 means another thread claimed the block at idx first
+			/// </summary>
+			int claimed = from_buffer.claim_run(idx, stage.m_entry_block_state, sample_block_state_processing, max_blocks);
+			if (claimed == 0) {
+				if constexpr (metrics_enabled)
+					bump_counter(worker.stages[binding.index].claim_failures);
+				return true;
+			}
+
+			//only the worker holding the block at the cursor gets here for an ordered stage, so the tickets follow the block order
+			uint64_t ticket = 0;
+			if (stage.m_ordered) {
+				ticket = stage.m_next_ticket.load(std::memory_order_relaxed);
+				stage.m_next_ticket.store(ticket + 1, std::memory_order_relaxed);
+			}
+
+			stage.m_cursor.store((idx + claimed) % from_buffer.m_block_count, std::memory_order_release);
+
+			std::array<sample_state, s_max_claim_blocks> out_states;
+
+			std::chrono::steady_clock::time_point process_start;
+			if constexpr (metrics_enabled)
+				process_start = std::chrono::steady_clock::now();
+
+			//block_count is set to the unwrapped destination block num
+			//this is useful for temporal stages it has temporal continuity with buffer wrapping
+			int block_count = static_cast<int>(flush_count * to_buffer.m_block_count + dst_idx);
+			auto out_blocks = std::span<sample_block>(&to_buffer.get_block(dst_idx), claimed * to_buffer.m_channel_count);
+
+			if (binding.in_turn) {
+				process_channels_in_turn(
+					stage,
+					binding,
+					worker,
+					ticket,
+					std::span<const sample_block>(&from_buffer.get_block(idx), claimed * from_buffer.m_channel_count),
+					out_blocks,
+					std::span<sample_state>(out_states.data(), claimed),
+					block_count
+				);
+			}
+			else if (stage.m_input_count == 1) {
+				stage_dispatch<S, BlockSize, SampleRate>::process_blocks(
+					stage,
+					m_state,
+					std::span<const sample_block>(&from_buffer.get_block(idx), claimed * from_buffer.m_channel_count),
+					out_blocks,
+					std::span<sample_state>(out_states.data(), claimed),
+					block_count
+				);
+			}
+			else {
+				//the stage's inputs follow its first buffer in the node, the run sits at the same blocks in each
+				std::array<std::span<const sample_block>, max_stage_inputs> inputs;
+				for (size_t k = 0; k < stage.m_input_count; k++) {
+					auto& input = binding.from_buffer[k];
+					inputs[k] = std::span<const sample_block>(&input.get_block(idx), claimed * input.m_channel_count);
+				}
+
+				stage_dispatch<S, BlockSize, SampleRate>::process_inputs(
+					stage,
+					m_state,
+					std::span<const std::span<const sample_block>>(inputs.data(), stage.m_input_count),
+					out_blocks,
+					std::span<sample_state>(out_states.data(), claimed),
+					block_count
+				);
+			}
+
+			if constexpr (metrics_enabled) {
+				auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - process_start).count());
+				auto& counters = worker.stages[binding.index];
+				bump_counter(counters.blocks, claimed);
+				bump_counter(counters.runs);
+				bump_counter(counters.busy_ns, ns);
+				counters.block_latency.record(ns / claimed, claimed);
+			}
+
+			//atomically store the output states into the blocks from, to, a CAS per state group rather than a store per block
+			auto published = std::span<sample_state>(out_states.data(), claimed);
+			from_buffer.store_run(idx, published);
+			to_buffer.store_run(dst_idx, published);
+
+			//make tasks of the stages of the group whose entry state was just published, and wake the run loop which checks for flushes
+			//they go on this worker's deque, the blocks are still in its cache and idle workers steal them if it stays busy
+			for (auto& waiting : *binding.group)
+				if (std::find(published.begin(), published.end(), waiting.stage->m_entry_block_state) != published.end())
+					schedule(waiting, &worker);
+			m_flush_wake.notify_all();
+
+			return true;
+		};
+
+		/// <summary>
+		/// runs a claimed run of an ordered stage with several workers through it a channel at a time. Each channel waits for its
+		/// turn, the run with the previous ticket finishing the channel, so runs follow each other over the channels in a wavefront
+		/// and no channel is ever processed out of block order or by two workers at once
+		///
+		/// the wait is on a predecessor that has claimed its run and is processing it, never on work that has yet to be scheduled,
+		/// so it spins briefly and then yields rather than parking
+		/// </summary>
+		template <static_stage<BlockSize, SampleRate> S>
+		void process_channels_in_turn(
+			S& stage,
+			stage_binding& binding,
+			worker_context& worker,
+			uint64_t ticket,
+			std::span<const sample_block> in_blocks,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) {
+			for (size_t c = 0; c < stage.m_channel_count; c++) {
+				auto& turn = stage.m_channel_turns[c];
+				if (turn.load(std::memory_order_acquire) != ticket) {
+					if constexpr (metrics_enabled)
+						bump_counter(worker.stages[binding.index].turn_waits);
+
+					uint32_t spins = 0;
+					while (turn.load(std::memory_order_acquire) != ticket) {
+						if (!m_park_policy.spin(spins))
+							std::this_thread::yield();
+					}
+				}
+
+				stage_dispatch<S, BlockSize, SampleRate>::process_channel(stage, m_state, c, in_blocks, out_blocks, out_states, block_count);
+				turn.store(ticket + 1, std::memory_order_release);
+			}
+		};
+
+		static stage_group bind_stages(const std::vector<std::unique_ptr<pipeline_stage>>& stages) {
+			stage_group group;
+			group.reserve(stages.size());
+			for (auto& stage : stages)
+				group.push_back(bind_stage(*stage));
+			return group;
+		};
+
+		//inits the node's stages and points their tasks at the buffers, returns the most tasks the node can have in flight
+		size_t prepare_node(graph_node& node) {
+			size_t max_tasks = 0;
+			for (auto& binding : node.stages) {
+				binding.init(*binding.stage, node.buffers);
+
+				binding.from_buffer = &node.buffers[binding.stage->m_in_buffer_idx];
+				binding.to_buffer = &node.buffers[binding.stage->m_out_buffer_idx];
+				binding.group = &node.stages;
+				binding.pass_count = node.pass_count;
+				max_tasks += binding.stage->m_thread_count;
+
+				//the turns start over with the tickets, nothing is in flight between runs
+				auto& stage = *binding.stage;
+				stage.m_channel_count = binding.to_buffer->m_channel_count;
+				stage.m_next_ticket.store(0);
+				stage.m_channel_turns = std::make_unique<std::atomic<uint64_t>[]>(stage.m_channel_count);
+				//an ordered stage without a process_channel of its own keeps to one worker, its runs can only go through process_blocks
+				//in block order
+				if (binding.in_turn)
+					stage.m_task_limit = static_cast<uint32_t>(std::min<size_t>(stage.m_thread_count, stage.m_channel_count));
+				else
+					stage.m_task_limit = stage.m_ordered ? 1 : stage.m_thread_count;
+			}
+			return max_tasks;
+		};
+
+		size_t stage_count() const {
+			size_t count = 0;
+			for (auto& node : m_nodes)
+				count += node.stages.size();
+			return count;
+		};
+
+		/// <summary>
+		/// a pool thread, runs its own tasks newest first, then injected ones, then steals the oldest task of another worker
+		/// </summary>
+		void pool_worker(std::reference_wrapper<worker_context> rworker)
+		{
+			auto& worker = rworker.get();
+			uint8_t state;
+			uint32_t idle_iterations = 0;
+
+			//until the execution is halted
+			while ((state = get_state()) != pipeline_execution_state::STOPPED)
+			{
+				//only do work while the pipeline is executing (not paused or some other stalling state), park until the state changes
+				if (state != pipeline_execution_state::EXECUTING) {
+					m_state.execution_state.wait(state);
+					continue;
+				}
+
+				if (auto* task = take_task(worker)) {
+					execute(*task, worker);
+					idle_iterations = 0;
+					continue;
+				}
+
+				if (m_park_policy.spin(idle_iterations)) {
+					if constexpr (metrics_enabled)
+						bump_counter(worker.counters.idle_spins);
+					continue;
+				}
+
+				//park until a task is scheduled or the execution state changes
+				//the last check for tasks happens after registering as a waiter so a wakeup in between can't be lost
+				auto key = m_work_wake.prepare_wait();
+				if (get_state() != pipeline_execution_state::EXECUTING || has_tasks()) {
+					m_work_wake.cancel_wait();
+				}
+				else {
+					if constexpr (metrics_enabled)
+						bump_counter(worker.counters.parks);
+					m_work_wake.wait(key);
+				}
+
+				idle_iterations = 0;
+			}
+		};
+
+		void cleanup_stages() noexcept {
+			for (auto& node : m_nodes)
+				for (auto& binding : node.stages)
+					binding.cleanup(*binding.stage);
+		};
+
+		/// <summary>
+		/// the three group topology as a graph, generators feed the processing stages which feed the output stages
+		/// </summary>
+		static graph group_graph(
+			stage_group generator_stages,
+			stage_group processing_stages,
+			stage_group output_stages,
+			std::vector<audio_ring_buffer> generator_buffers,
+			std::vector<audio_ring_buffer> processing_buffers,
+			std::vector<audio_ring_buffer> output_buffers
+		) {
+			if (output_stages.size() == 0)
+				throw std::runtime_error("audio_pipeline::audio_pipeline(...) requires at least one output stage");
+
+			graph topology;
+			auto generators = topology.add_bound_node(std::move(generator_stages), std::move(generator_buffers));
+			auto processors = topology.add_bound_node(std::move(processing_stages), std::move(processing_buffers));
+			auto outputs = topology.add_bound_node(std::move(output_stages), std::move(output_buffers));
+			topology.connect(generators, processors);
+			topology.connect(processors, outputs);
+			return topology;
+		};
+
+	protected:
+		/// <summary>
+		/// builds the three group pipeline over stages bound by the caller, who keeps them alive for the lifetime of the pipeline
+		/// </summary>
+		basic_audio_pipeline(
+			stage_group generator_stages,
+			stage_group processing_stages,
+			stage_group output_stages,
 			std::vector<audio_ring_buffer> generator_buffers,
 			std::vector<audio_ring_buffer> processing_buffers,
 			std::vector<audio_ring_buffer> output_buffers
 		)
+			: basic_audio_pipeline(group_graph(
+				std::move(generator_stages),
+				std::move(processing_stages),
+				std::move(output_stages),
+				std::move(generator_buffers),
+				std::move(processing_buffers),
+				std::move(output_buffers)
+			))
+		{
+			//the groups number their passes with pipeline_state's counters as they always have
+			m_nodes[0].pass_count = &m_state.generator_flush_count;
+			m_nodes[1].pass_count = &m_state.processing_flush_count;
+			m_nodes[2].pass_count = &m_state.output_flush_count;
+		}
+
+	public:
+		//accept implicits e.g. initializer_list of unique_ptr<pipeline_stage>
+		~basic_audio_pipeline() {
+			cleanup_stages();
+		}
+
+		/// <summary>
+		/// a pipeline over the graph, which has to be acyclic and have every node joined to another by an edge
+		/// </summary>
+		explicit basic_audio_pipeline(graph topology)
 			:
 			m_state(
 				std::atomic<uint64_t>(0),
@@ -111,24 +1377,124 @@ namespace audio_engine {
 				std::atomic<uint64_t>(0),
 				std::atomic<uint8_t>(pipeline_execution_state::STOPPED)
 			),
-			m_generator_stages(std::move(generator_stages)),
-			m_processing_stages(std::move(processing_stages)),
-			m_output_stages(std::move(output_stages)),
+			m_owned_stages(std::move(topology.m_owned_stages)),
+			m_pass_counts(std::make_unique<std::atomic<uint64_t>[]>(topology.m_nodes.size())),
+			m_nodes(),
+			m_edges(),
+			m_order(),
+			m_sinks(),
 			m_threads(),
-			m_generator_buffers(std::move(generator_buffers)),
-			m_processing_buffers(std::move(processing_buffers)),
-			m_output_buffers(std::move(output_buffers))
+			m_workers(),
+			m_worker_count(std::max(1u, std::thread::hardware_concurrency())),
+			m_injected_count(0),
+			m_mode(execution_mode::free_running),
+			m_render_passes(0),
+			m_run_start(clock::time_point()),
+			m_run_end(clock::time_point()),
+			m_period_deadline(),
+			m_period_checked(false),
+			m_output_passes(0),
+			m_underruns(0),
+			m_overruns(0),
+			m_worst_lateness_ns(0),
+			m_period_clock(),
+			m_clock_lock(),
+			m_clock_wake(),
+			m_clock_deadline(clock::time_point::max()),
+			m_flush_latency(std::make_unique<latency_recorder[]>(topology.m_nodes.size()))
 		{
-			if (m_output_stages.size() == 0)
-				throw std::runtime_error("audio_pipeline::audio_pipeline(...) requires at least one output stage");
+			if (topology.m_nodes.empty())
+				throw std::domain_error("audio_pipeline::audio_pipeline(graph) : requires at least one node");
+
+			m_nodes.reserve(topology.m_nodes.size());
+			for (size_t n = 0; n < topology.m_nodes.size(); n++) {
+				auto& node = topology.m_nodes[n];
+				m_nodes.push_back(graph_node{ std::move(node.stages), std::move(node.buffers), {}, {}, &m_pass_counts[n], false });
+			}
+
+			m_edges.reserve(topology.m_edges.size());
+			for (auto& edge : topology.m_edges) {
+				auto& out = m_nodes[edge.from].buffers.back();
+				m_nodes[edge.from].outputs.push_back(m_edges.size());
+				m_nodes[edge.to].inputs.push_back(m_edges.size());
+				m_edges.push_back(graph_edge{
+					edge.from,
+					edge.to,
+					edge.buffer_idx,
+					audio_ring_buffer(out.m_block_count, out.m_channel_count, out.get_allocator(), out.get_state_layout()),
+					false
+				});
+			}
+
+			for (auto& node : m_nodes) {
+				if (node.inputs.empty() && node.outputs.empty())
+					throw std::domain_error("audio_pipeline::audio_pipeline(graph) : every node requires an edge to or from another node");
+
+				for (auto& binding : node.stages)
+					if (binding.stage->m_in_buffer_idx + binding.stage->m_input_count > node.buffers.size() || binding.stage->m_out_buffer_idx >= node.buffers.size())
+						throw std::domain_error("audio_pipeline::audio_pipeline(graph) : a stage reads or writes a buffer its node doesn't have");
+			}
+
+			//the sinks take their passes together and the pass counters number blocks, so a pass is the same length everywhere
+			for (auto& edge : m_edges)
+				if (edge.handoff.m_block_count != pass_blocks())
+					throw std::domain_error("audio_pipeline::audio_pipeline(graph) : requires the same block_count on every edge");
+
+			//orders the nodes after everything feeding them, a node left out sits on a cycle and would wait on itself forever
+			std::vector<size_t> waiting(m_nodes.size());
+			for (size_t n = 0; n < m_nodes.size(); n++) {
+				waiting[n] = m_nodes[n].inputs.size();
+				if (waiting[n] == 0)
+					m_order.push_back(n);
+			}
+			for (size_t i = 0; i < m_order.size(); i++)
+				for (size_t e : m_nodes[m_order[i]].outputs)
+					if (--waiting[m_edges[e].to] == 0)
+						m_order.push_back(m_edges[e].to);
+
+			if (m_order.size() != m_nodes.size())
+				throw std::domain_error("audio_pipeline::audio_pipeline(graph) : the graph must not have cycles");
+
+			for (size_t n : m_order)
+				if (m_nodes[n].outputs.empty())
+					m_sinks.push_back(n);
+
+			size_t index = 0;
+			for (auto& node : m_nodes)
+				for (auto& binding : node.stages)
+					binding.index = index++;
 		}
 
-		audio_pipeline(
+		//a pipeline of stages chosen at runtime, every stage call goes through the pipeline_stage vtable
+		basic_audio_pipeline(
+			std::vector<std::unique_ptr<pipeline_stage>> generator_stages,
+			std::vector<std::unique_ptr<pipeline_stage>> processing_stages,
+			std::vector<std::unique_ptr<pipeline_stage>> output_stages,
+			std::vector<audio_ring_buffer> generator_buffers,
+			std::vector<audio_ring_buffer> processing_buffers,
+			std::vector<audio_ring_buffer> output_buffers
+		)
+			: basic_audio_pipeline(
+				bind_stages(generator_stages),
+				bind_stages(processing_stages),
+				bind_stages(output_stages),
+				std::move(generator_buffers),
+				std::move(processing_buffers),
+				std::move(output_buffers)
+			)
+		{
+			//the bindings point at the stages themselves so moving the owning pointers doesn't invalidate them
+			for (auto* stages : { &generator_stages, &processing_stages, &output_stages })
+				for (auto& stage : *stages)
+					m_owned_stages.push_back(std::move(stage));
+		}
+
+		basic_audio_pipeline(
 			std::vector<std::unique_ptr<pipeline_stage>> generator_stages,
 			std::vector<std::unique_ptr<pipeline_stage>> processing_stages,
 			std::vector<std::unique_ptr<pipeline_stage>> output_stages
 		)
-			: audio_engine::audio_pipeline::audio_pipeline(
+			: basic_audio_pipeline(
 				std::move(generator_stages),
 				std::move(processing_stages),
 				std::move(output_stages),
@@ -145,206 +1511,258 @@ namespace audio_engine {
 		};
 
 		void stop() {
-			m_state.execution_state.store(pipeline_execution_state::STOPPED);
-
-
+			m_run_end.store(clock::now());
+			set_execution_state(pipeline_execution_state::STOPPED);
 		};
 		void pause() {
-			m_state.execution_state.store(pipeline_execution_state::PAUSED);
+			set_execution_state(pipeline_execution_state::PAUSED);
+		};
+		void resume() {
+			set_execution_state(pipeline_execution_state::EXECUTING);
+		};
+
+		//how long idle workers and the run loop spin before parking, set before run()
+		void set_park_policy(park_policy policy) {
+			m_park_policy = policy;
+		};
+
+		//the number of pool threads shared by every stage, set before run(), defaults to one per hardware thread
+		//a stage's thread_count caps how many of them run it at once
+		void set_worker_count(size_t worker_count) {
+			if (worker_count == 0)
+				throw std::domain_error("audio_pipeline::set_worker_count(worker_count) : requires at least one worker");
+			m_worker_count = worker_count;
 		};
 		
 		void add_processing_stage(pipeline_stage& stage);
 		void add_output_stage(pipeline_stage& stage);
 
-		void stage_worker(
-			std::reference_wrapper<std::unique_ptr<pipeline_stage>> rp_stage, 
-			std::reference_wrapper<audio_ring_buffer> rfrom_buffer, 
-			std::reference_wrapper<audio_ring_buffer> rto_buffer
-		)
-		{
-			
-			auto& p_stage = rp_stage.get();
-			auto& from_buffer = rfrom_buffer.get();
-			auto& to_buffer = rto_buffer.get();
-			uint8_t state;
+		//free running or real time, set before run(), an offline render sets its own mode through render_offline
+		void set_execution_mode(execution_mode mode) {
+			if (mode == execution_mode::offline)
+				throw std::domain_error("audio_pipeline::set_execution_mode(mode) : offline renders are started with render_offline(block_count)");
+			m_mode = mode;
+		};
 
+		execution_mode get_execution_mode() const {
+			return m_mode;
+		};
 
-			//until the execution is halted
-			while ( (state = get_state()) != pipeline_execution_state::STOPPED)
-			{
-				//only do work while the pipeline is executing (not paused or some other stalling state)
-				//only do work while the stage is not flushing 
-				//(all stages in a group (generators), (processors), (outputters) are set to flushing together when the group is flushing)
-				if (state == pipeline_execution_state::EXECUTING && !p_stage->m_flushing.load())
-				{
-					
-					auto idx = from_buffer.get_first_match_idx(p_stage->m_entry_block_state);
-					auto flush_count = m_state.generator_flush_count.load();
-					auto dst_idx = idx + p_stage->m_offset;
-
-					/// <summary>
-					/// If we can do an atomic CAS onto the block state (it's in the expected state, put into processing state) 
-					/// then this thread for this stage is allowed to operate on the block
-					/// 
-					/// if there was a spurious failure and another thread didn't sneak in and claim the block, we retry
-					/// </summary>
-					auto expected_state = p_stage->m_entry_block_state; //copy it because we don't want it overwritten
-					bool exchanged = false;
-					do {
-						exchanged = std::atomic_ref<uint8_t>(from_buffer.get_block_state(idx)).compare_exchange_weak(
-							expected_state,
-							sample_block_state_processing,
-							std::memory_order_release,
-							std::memory_order_relaxed
-						);
-					}
-					while (expected_state == p_stage->m_entry_block_state && !exchanged && !p_stage->m_flushing.load());
+		//safe to call from any thread during a run, exact once the run has returned
+		render_stats get_render_stats() const {
+			render_stats stats;
+			stats.periods = m_output_passes.load(std::memory_order_relaxed);
+			stats.blocks = stats.periods * pass_blocks();
+			stats.underruns = m_underruns.load(std::memory_order_relaxed);
+			stats.overruns = m_overruns.load(std::memory_order_relaxed);
+			stats.worst_lateness = std::chrono::nanoseconds(m_worst_lateness_ns.load(std::memory_order_relaxed));
+
+			bool running = get_state() != pipeline_execution_state::STOPPED;
+			stats.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>((running ? clock::now() : m_run_end.load()) - m_run_start.load());
+
+			auto audio = std::chrono::duration_cast<std::chrono::duration<double>>(sample_duration_t(stats.blocks * sample_block_size));
+			auto wall = std::chrono::duration_cast<std::chrono::duration<double>>(stats.elapsed);
+			stats.real_time_factor = wall.count() > 0.0 ? audio.count() / wall.count() : 0.0;
+			return stats;
+		};
 
-					if (exchanged) {
+		/// <summary>
+		/// a snapshot of the per stage and per worker counters, safe to poll from any thread while the pipeline runs
+		/// each worker only writes its own counters so the snapshot is a consistent copy of every counter but not across counters
+		/// </summary>
+		pipeline_metrics get_metrics() const {
+			pipeline_metrics metrics;
+			metrics.stages.resize(stage_count());
+			metrics.flush_latency.resize(m_nodes.size());
 
-						auto& from_block = from_buffer.get_block(idx);
-						auto& to_block = to_buffer.get_block(dst_idx);
+			std::lock_guard lock(m_metrics_lock);
+			metrics.workers.resize(m_workers.size());
+			if constexpr (metrics_enabled) {
+				for (size_t w = 0; w < m_workers.size(); w++) {
+					auto& worker = *m_workers[w];
+					auto& worker_totals = metrics.workers[w];
+					worker_totals.tasks = worker.counters.tasks.load(std::memory_order_relaxed);
+					worker_totals.idle_spins = worker.counters.idle_spins.load(std::memory_order_relaxed);
+					worker_totals.parks = worker.counters.parks.load(std::memory_order_relaxed);
 
-						uint8_t out_state = p_stage->process_block(
-							m_state,
-							from_block,
-							to_block,
-							flush_count * m_generator_buffers.back().m_block_count + (dst_idx) //block_count is set to the unwrapped destination block num
-							//this is useful for temporal stages it has temporal continuity with buffer wrapping
-						);
+					for (size_t i = 0; i < metrics.stages.size(); i++) {
+						auto& counters = worker.stages[i];
+						auto& stage = metrics.stages[i];
+						uint64_t blocks = counters.blocks.load(std::memory_order_relaxed);
+						uint64_t claim_failures = counters.claim_failures.load(std::memory_order_relaxed);
+						uint64_t busy_ns = counters.busy_ns.load(std::memory_order_relaxed);
 
-						//atomically store the output state into the blocks from, to 
-						std::atomic_ref<uint8_t>(from_buffer.get_block_state(dst_idx)).store(out_state);
-						std::atomic_ref<uint8_t>(to_buffer.get_block_state(dst_idx)).store(out_state);
+						stage.blocks += blocks;
+						stage.runs += counters.runs.load(std::memory_order_relaxed);
+						stage.claim_failures += claim_failures;
+						stage.turn_waits += counters.turn_waits.load(std::memory_order_relaxed);
+						stage.busy_ns += busy_ns;
+						counters.block_latency.read_into(stage.block_latency);
+
+						worker_totals.blocks += blocks;
+						worker_totals.claim_failures += claim_failures;
+						worker_totals.busy_ns += busy_ns;
 					}
 				}
+
+				for (size_t n = 0; n < m_nodes.size(); n++)
+					m_flush_latency[n].read_into(metrics.flush_latency[n]);
 			}
+
+			return metrics;
+		};
+
+		/// <summary>
+		/// renders block_count blocks through the pipeline as fast as it can go and returns once the output stages have consumed them
+		/// the output stages work in whole passes so the count is rounded up to a multiple of the pass length (a buffer's block_count)
+		/// </summary>
+		render_stats render_offline(uint64_t block_count)
+		{
+			if (block_count == 0)
+				throw std::domain_error("audio_pipeline::render_offline(block_count) : requires at least one block");
+
+			uint64_t blocks_per_pass = pass_blocks();
+			execution_mode previous = m_mode;
+			m_mode = execution_mode::offline;
+			m_render_passes = (block_count + blocks_per_pass - 1) / blocks_per_pass;
+
+			run();
+
+			m_mode = previous;
+			return get_render_stats();
 		};
 
 		void run()
 		{
-			m_state.execution_state = pipeline_execution_state::EXECUTING;
+			m_output_passes.store(0);
+			m_underruns.store(0);
+			m_overruns.store(0);
+			m_worst_lateness_ns.store(0);
+			set_period_deadline(clock::time_point::max());
+			m_run_start.store(clock::now());
+
+			set_execution_state(pipeline_execution_state::EXECUTING);
 			
-			for (auto& stage : m_generator_stages) {
-				stage->init(m_generator_buffers);
-
-				for (int i = 0; i < stage->m_thread_count; i++)
-				{
-					auto& from_buffer = m_generator_buffers[stage->m_in_buffer_idx];
-					auto& to_buffer = m_generator_buffers[stage->m_out_buffer_idx];
-					auto b = std::bind(&audio_pipeline::stage_worker, this, std::ref(stage), std::ref(from_buffer), std::ref(to_buffer));
-					m_threads.push_back(std::move(std::jthread(std::move(b))));
-				}
+			size_t max_tasks = 0;
+			for (auto& node : m_nodes)
+				max_tasks += prepare_node(node);
 
+			//a fixed pool shared by every stage, sized for the machine rather than the pipeline
+			//every worker's deque can hold every task that can exist so a push never fails
+			{
+				std::lock_guard lock(m_metrics_lock);
+				m_workers.clear();
+				for (size_t i = 0; i < m_worker_count; i++)
+					m_workers.push_back(std::make_unique<worker_context>(i, max_tasks, stage_count()));
 			}
+			for (auto& worker : m_workers)
+				m_threads.push_back(std::jthread(std::bind(&basic_audio_pipeline::pool_worker, this, std::ref(*worker))));
+
+			//every stage starts with a task, generators find their default blocks and the rest find nothing until blocks are published
+			for (auto& node : m_nodes)
+				for (auto& binding : node.stages)
+					schedule(binding, nullptr);
+
+			if (m_mode == execution_mode::real_time)
+				m_period_clock = std::jthread(std::bind_front(&basic_audio_pipeline::period_clock, this));
+
+			uint32_t idle_iterations = 0;
+
+			while (m_state.execution_state != pipeline_execution_state::STOPPED) {
 
-			for (auto& stage : m_processing_stages) {
-				stage->init(m_processing_buffers);
+				//nothing publishes blocks while paused, park until the state changes
+				uint8_t state = get_state();
+				if (state == pipeline_execution_state::PAUSED) {
+					m_state.execution_state.wait(state);
 
-				for (int i = 0; i < stage->m_thread_count; i++)
-				{
-					auto& from_buffer = m_processing_buffers[stage->m_in_buffer_idx];
-					auto& to_buffer = m_processing_buffers[stage->m_out_buffer_idx];
-					auto b = std::bind(&audio_pipeline::stage_worker, this, std::ref(stage), std::ref(from_buffer), std::ref(to_buffer));
-					m_threads.push_back(std::move(std::jthread(std::move(b))));
+					//time stood still for the stream, the next period is due a period from now rather than already late
+					if (m_mode == execution_mode::real_time && m_output_passes.load() != 0)
+						set_period_deadline(clock::now() + period_duration());
+					continue;
 				}
-			}
 
-			for (auto& stage : m_output_stages) {
-				stage->init(m_output_buffers);
+				check_period_deadline();
+
+				bool flushed = false;
+
+				//the pass counters double as the pass index each node is working on, stages use them to number blocks
+				//so a pass keeps the same block numbers as it moves through the graph
+				for (size_t n : m_order) {
+					//the node finished a pass: park it on its out edges and keep going on the first slot's old storage
+					if (can_hand_off(m_nodes[n])) {
+						hand_off_pass(n);
+						flushed = true;
+					}
 
-				for (int i = 0; i < stage->m_thread_count; i++)
-				{
-					auto& from_buffer = m_output_buffers[stage->m_in_buffer_idx];
-					auto& to_buffer = m_output_buffers[stage->m_out_buffer_idx];
-					auto b = std::bind(&audio_pipeline::stage_worker, this, std::ref(stage), std::ref(from_buffer), std::ref(to_buffer));
-					m_threads.push_back(std::move(std::jthread(std::move(b))));
+					//the node is idle (already flushed) and every node feeding it has handed it a pass: take them
+					if (can_take(m_nodes[n])) {
+						take_pass(n);
+						flushed = true;
+					}
 				}
-			}
 
-			while (m_state.execution_state != pipeline_execution_state::STOPPED) {
-				
-				//check flush on generator_buffers (all blocks are stalled out - already processed!)
-				if (
-					m_generator_buffers.back().get_first_nonmatch_idx(sample_block_state_processed) == -1 //if the generator buffer is processed 100%
-					&& m_processing_buffers.front().get_first_nonmatch_idx(sample_block_state_default) == -1 //and the processing stage collection is already flushed
-					&& m_processing_buffers.back().get_first_nonmatch_idx(sample_block_state_default) == -1
-				)
-				{
-
-					for (auto& stage : m_generator_stages) 
-						stage->m_flushing.store(true);
-					for (auto& stage : m_processing_stages)
-						stage->m_flushing.store(true);
-
-					std::atomic_thread_fence(std::memory_order_acquire);
-
-					m_state.generator_flush_count.fetch_add(1);
-					m_generator_buffers.back().copy_to(m_processing_buffers.front());
-					m_generator_buffers.front().clear();
-					memset(m_processing_buffers.front().get_block_states(), m_processing_stages.front()->m_entry_block_state, m_processing_buffers.front().m_block_count);
-					memset(m_generator_buffers.back().get_block_states(), sample_block_state_default, m_generator_buffers.back().m_block_count);
-
-					std::atomic_thread_fence(std::memory_order_release);
-
-					for (auto& stage : m_generator_stages) 
-						stage->m_flushing.store(false);
-					for (auto& stage : m_processing_stages)
-						stage->m_flushing.store(false);
+				//the sinks are idle: the passes they were on are done, take the pending ones
+				//in real time they also wait for their period, offline they stop at the end of the render
+				if (sinks_fed() && sinks_idle() && output_due()) {
+					for (size_t n : m_sinks) {
+						auto& sink = m_nodes[n];
+						if (sink.has_pass)
+							sink.pass_count->fetch_add(1);
+						sink.has_pass = true;
+						take_pass(n);
+					}
+					output_pass_taken();
+					flushed = true;
 				}
 
-				//check flush on processing_buffers (all blocks are stalled out - already processed!)
-				if (
-					m_processing_buffers.back().get_first_nonmatch_idx(sample_block_state_processed) == -1
-					&& m_output_buffers.front().get_first_nonmatch_idx(sample_block_state_default) == -1 //and the processing stage collection is already flushed
-					&& m_output_buffers.back().get_first_nonmatch_idx(sample_block_state_default) == -1
-				)
-				{
-
-					for (auto& stage : m_processing_stages)
-						stage->m_flushing.store(true);
-					for (auto& stage : m_output_stages)
-						stage->m_flushing.store(true);
-
-					std::atomic_thread_fence(std::memory_order_acquire);
-
-					m_state.processing_flush_count.fetch_add(1);
-					m_processing_buffers.back().copy_to(m_output_buffers.front());
-					m_processing_buffers.front().clear(); 
-					memset(m_output_buffers.front().get_block_states(), m_output_stages.front()->m_entry_block_state, m_output_buffers.front().m_block_count);
-					memset(m_processing_buffers.back().get_block_states(), sample_block_state_default, m_processing_buffers.back().m_block_count);
-
-					std::atomic_thread_fence(std::memory_order_release);
-
-					for (auto& stage : m_processing_stages)
-						stage->m_flushing.store(false);
-					for (auto& stage : m_output_stages)
-						stage->m_flushing.store(false);
+				if (render_finished()) {
+					m_run_end.store(clock::now());
+					set_execution_state(pipeline_execution_state::STOPPED);
+					break;
 				}
 
+				if (flushed) {
+					idle_iterations = 0;
+					continue;
+				}
+
+				if (m_park_policy.spin(idle_iterations))
+					continue;
+
+				//park until a worker publishes blocks or the execution state changes, rechecking after registering as a waiter
+				auto key = m_flush_wake.prepare_wait();
+				if (get_state() != pipeline_execution_state::EXECUTING || flush_ready())
+					m_flush_wake.cancel_wait();
+				else
+					m_flush_wake.wait(key);
+
+				idle_iterations = 0;
 				
 			}//end while-executing loop
 
+			m_period_clock = std::jthread(); //requests the clock thread stop and joins it
+
 			m_threads.clear(); //will invoke the destructor of all of the threads for the stages, they are std::jthread so this will block until they rejoin
 			
-			//TODO: make some span/reference only collection that tracks all of the stages
-			for (auto& stage : m_generator_stages)
-				stage->cleanup();
-			for (auto& stage : m_processing_stages)
-				stage->cleanup();
-			for (auto& stage : m_output_stages)
-				stage->cleanup();
+			cleanup_stages();
 		};
 
 		void run_async()
 		{
-			auto binding = std::bind(&audio_pipeline::run, this);
+			auto binding = std::bind(&basic_audio_pipeline::run, this);
 			std::thread t(binding);
 			t.detach();
 		};
 		//void set_processing_stages
 	};
 
+	using audio_pipeline = basic_audio_pipeline<sample_block_size, sample_rate>;
+
+	template <size_t BlockSize, uint32_t SampleRate>
+	using basic_pipeline_graph = typename basic_audio_pipeline<BlockSize, SampleRate>::graph;
+
+	using pipeline_graph = audio_pipeline::graph;
+
 };
 
 #endif
\ No newline at end of file
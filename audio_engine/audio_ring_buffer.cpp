@@ -2,8 +2,55 @@
 
 namespace audio_engine {
 
-	
+	void copy_samples(sample* dst, const sample* src, size_t count) noexcept
+	{
+		if (count * sizeof(sample) < s_stream_copy_threshold) {
+			memcpy(dst, src, count * sizeof(sample));
+			return;
+		}
 
+#if defined(__AVX__)
+		constexpr size_t vector_alignment = sizeof(__m256);
+#else
+		constexpr size_t vector_alignment = sizeof(__m128);
+#endif
+		constexpr size_t vector_width = vector_alignment / sizeof(sample);
 
+		//streaming stores need an aligned destination, samples are 4 byte aligned so a short head gets us there
+		size_t i = 0;
+		while (i < count && reinterpret_cast<uintptr_t>(dst + i) % vector_alignment != 0) {
+			dst[i] = src[i];
+			i++;
+		}
 
-};
\ No newline at end of file
+		//4 vectors per iteration to keep the write combining buffers full
+		for (; i + 4 * vector_width <= count; i += 4 * vector_width) {
+#if defined(__AVX__)
+			__m256 a = _mm256_loadu_ps(src + i);
+			__m256 b = _mm256_loadu_ps(src + i + vector_width);
+			__m256 c = _mm256_loadu_ps(src + i + 2 * vector_width);
+			__m256 d = _mm256_loadu_ps(src + i + 3 * vector_width);
+			_mm256_stream_ps(dst + i, a);
+			_mm256_stream_ps(dst + i + vector_width, b);
+			_mm256_stream_ps(dst + i + 2 * vector_width, c);
+			_mm256_stream_ps(dst + i + 3 * vector_width, d);
+#else
+			__m128 a = _mm_loadu_ps(src + i);
+			__m128 b = _mm_loadu_ps(src + i + vector_width);
+			__m128 c = _mm_loadu_ps(src + i + 2 * vector_width);
+			__m128 d = _mm_loadu_ps(src + i + 3 * vector_width);
+			_mm_stream_ps(dst + i, a);
+			_mm_stream_ps(dst + i + vector_width, b);
+			_mm_stream_ps(dst + i + 2 * vector_width, c);
+			_mm_stream_ps(dst + i + 3 * vector_width, d);
+#endif
+		}
+
+		for (; i < count; i++)
+			dst[i] = src[i];
+
+		//streaming stores are weakly ordered, fence them before the caller publishes the copy
+		_mm_sfence();
+	}
+
+};
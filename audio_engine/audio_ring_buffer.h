@@ -3,10 +3,16 @@
 
 #include "audio_types.h"
 #include <memory>
+#include <atomic>
 #include <emmintrin.h>
 #include <immintrin.h>
 #include <stdexcept>
 #include <concepts>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <bit>
+#include <span>
 
 namespace audio_engine {
 	static constexpr uint8_t sample_block_state_error = 0xFD;
@@ -14,52 +20,133 @@ namespace audio_engine {
 	static constexpr uint8_t sample_block_state_processed = 0xFF;
 	static constexpr uint8_t sample_block_state_default = 0x0;
 
+	//the blocks one claim covers, the states of a group share the 8 byte word claim_run CASes
+	static constexpr size_t state_group_blocks = sizeof(uint64_t);
+
+	/// <summary>
+	/// how a buffer lays out its block states and their occupancy bitmaps
+	/// </summary>
+	enum class state_layout : uint8_t {
+		//the state bytes back to back, 64 blocks to a cache line, and each 64 bit bitmap word covering 64 consecutive blocks.
+		//the smallest and quickest to scan, but workers claiming neighbouring runs CAS and publish into the same cache lines
+		packed,
+		//every group of state_group_blocks states on a cache line of its own, and the bitmaps interleaved so consecutive groups
+		//have their bits in different words, each word on a cache line of its own. Workers on neighbouring runs then touch
+		//disjoint lines, for stages run by many workers at once, at 8x the state memory and a looser search order
+		strided
+	};
+
+	//a cache line of occupancy bitmap words
+	struct alignas(64) state_index_line {
+		std::atomic<uint64_t> words[8];
+	};
+
 	/// <summary>
 	/// storage for buffer data
+	///
+	/// the samples are planar and block major, block b's channels are the channel_count consecutive sample_blocks from b * channel_count,
+	/// so one block of every channel (and a run of such blocks) is contiguous and each channel of a block is a whole number of AVX vectors
+	///
+	/// the state bytes come first (laid out as the state_layout says), padded to a whole cache line, then the blocks, so with
+	/// the allocator's buffer_alignment both start on a cache line and every channel of every block stays cache line aligned
 	/// </summary>
-	struct audio_ring_buffer_storage
+	template <size_t BlockSize>
+	struct basic_audio_ring_buffer_storage
 	{
+		static_assert(valid_block_size<BlockSize>, "the block size must be a multiple of 16 samples");
+
+		using sample_block = basic_sample_block<BlockSize>;
 		using byte_allocator_t = typename std::allocator_traits<ring_buffer_allocator_t>::template rebind_alloc<std::byte>;
 		
 
 		__m128i* m_sample_states; //16 bytes per m128 (1 byte per sample_block)
-		//there shouldn't be any padding here because __m128i is 16byte aligned
-		sample_block* m_sample_blocks;
-		//array of 32bit (4 byte), may have padding afterwards but I forced a modulo16 block_count
-		void* m_memory; //will use our default destructor which goes to the right allocator
+		sample_block* m_sample_blocks; //after the states, which are padded to a whole cache line
+		void* m_memory; //returned to m_allocator, which is swapped along with it
+		byte_allocator_t m_allocator;
 		const size_t m_block_count;
+		const size_t m_channel_count;
+		const state_layout m_layout;
+		//one occupancy bitmap per sample_state value, a block's bit in a state's bitmap is set while the block is in that state
+		//it moves with the memory on swap since it describes these state bytes, not the buffer that currently owns them, and comes
+		//from m_allocator as well so it gets the same pages, locking and placement as the states it indexes
+		state_index_line* m_state_index;
+		size_t m_index_words; //uint64 words per state bitmap
+		size_t m_index_stride; //uint64s from one bitmap word to the next, 8 when strided puts each on its own cache line
+		unsigned m_group_shift; //log2 of the bytes from one group's states to the next
 		
-		audio_ring_buffer_storage(size_t block_count) 
+		basic_audio_ring_buffer_storage(size_t block_count, size_t channel_count = 1, const ring_buffer_allocator_t& allocator = ring_buffer_allocator_t(), state_layout layout = state_layout::packed) 
 			: 
-			m_block_count(block_count)
+			m_allocator(allocator),
+			m_block_count(block_count),
+			m_channel_count(channel_count),
+			m_layout(layout),
+			m_index_words((block_count + 63) / 64),
+			m_index_stride(layout == state_layout::strided ? 8 : 1),
+			m_group_shift(layout == state_layout::strided ? std::countr_zero(buffer_alignment) : std::countr_zero(state_group_blocks))
 		{
 
 			if (block_count == 0)
-				throw std::domain_error("audio_ring_buffer_storage(block_count) : block_count must be greater than 0");
+				throw std::domain_error("audio_ring_buffer_storage(block_count, channel_count) : block_count must be greater than 0");
 			
 			if (block_count % 16 != 0) 
-				throw std::domain_error("audio_ring_buffer_storage(block_count) : block_count must be a multiple of 16");
+				throw std::domain_error("audio_ring_buffer_storage(block_count, channel_count) : block_count must be a multiple of 16");
+
+			if (channel_count == 0 || channel_count > max_channel_count)
+				throw std::domain_error("audio_ring_buffer_storage(block_count, channel_count) : channel_count must be in [1, max_channel_count]");
 
 			
-			uintptr_t data = reinterpret_cast<uintptr_t>(byte_allocator_t().allocate(15 + block_count + block_count * sizeof(sample_block)));
-			m_memory = reinterpret_cast<void*>(data);
-			
+			std::byte* data = m_allocator.allocate(size());
+			m_memory = data;
+
+			if (reinterpret_cast<uintptr_t>(data) % buffer_alignment != 0) {
+				m_allocator.deallocate(data, size());
+				throw std::domain_error("audio_ring_buffer_storage(block_count, channel_count, allocator) : the allocator must return buffer_alignment aligned memory");
+			}
 			
-			m_sample_states = reinterpret_cast<__m128i*>(data - data % 16);
-			m_sample_blocks = reinterpret_cast<sample_block*>(reinterpret_cast<uintptr_t>(m_memory) + block_count);
+			m_sample_states = reinterpret_cast<__m128i*>(data);
+			m_sample_blocks = reinterpret_cast<sample_block*>(data + states_size());
+
+			std::byte* index = nullptr;
+			try {
+				index = m_allocator.allocate(state_index_bytes());
+			}
+			catch (...) {
+				m_allocator.deallocate(data, size());
+				throw;
+			}
+			//the same buffer_alignment check as above covers the lines' alignas(64)
+			if (reinterpret_cast<uintptr_t>(index) % buffer_alignment != 0) {
+				m_allocator.deallocate(index, state_index_bytes());
+				m_allocator.deallocate(data, size());
+				throw std::domain_error("audio_ring_buffer_storage(block_count, channel_count, allocator) : the allocator must return buffer_alignment aligned memory");
+			}
+			//the words are cleared by rebuild_state_index before the buffer first reads them
+			m_state_index = reinterpret_cast<state_index_line*>(index);
+			std::uninitialized_default_construct_n(m_state_index, state_index_lines());
 		}
 
-		~audio_ring_buffer_storage() {
+		~basic_audio_ring_buffer_storage() {
 			if (m_memory != nullptr)
-				byte_allocator_t().deallocate((std::byte*)m_memory, size());
+				m_allocator.deallocate(static_cast<std::byte*>(m_memory), size());
+			if (m_state_index != nullptr) {
+				std::destroy_n(m_state_index, state_index_lines());
+				m_allocator.deallocate(reinterpret_cast<std::byte*>(m_state_index), state_index_bytes());
+			}
 		}
 
-		audio_ring_buffer_storage(const audio_ring_buffer_storage&) = delete;
-		audio_ring_buffer_storage& operator=(const audio_ring_buffer_storage&) = delete;
+		basic_audio_ring_buffer_storage(const basic_audio_ring_buffer_storage&) = delete;
+		basic_audio_ring_buffer_storage& operator=(const basic_audio_ring_buffer_storage&) = delete;
 
-		audio_ring_buffer_storage(audio_ring_buffer_storage&& other) :
+		basic_audio_ring_buffer_storage(basic_audio_ring_buffer_storage&& other) :
 			m_memory(std::move(other.m_memory)),
-			m_block_count(other.m_block_count)
+			m_allocator(other.m_allocator),
+			m_block_count(other.m_block_count),
+			m_channel_count(other.m_channel_count),
+			m_layout(other.m_layout),
+			m_state_index(other.m_state_index),
+			m_index_words(other.m_index_words),
+			m_index_stride(other.m_index_stride),
+			m_group_shift(other.m_group_shift)
 		{
 			if (m_block_count == 0)
 				throw std::domain_error("audio_ring_buffer_storage(block_count) : block_count must be greater than 0");
@@ -68,19 +155,63 @@ namespace audio_engine {
 				throw std::domain_error("audio_ring_buffer_storage(block_count) : block_count must be a multiple of 16");
 
 			other.m_memory = nullptr;
+			other.m_state_index = nullptr;
 			m_sample_states = other.m_sample_states;
 			m_sample_blocks = other.m_sample_blocks;
 		}
-		audio_ring_buffer_storage& operator=(audio_ring_buffer_storage&& other) {
-			std::swap(m_memory, other.m_memory);
+		basic_audio_ring_buffer_storage& operator=(basic_audio_ring_buffer_storage&& other) {
+			swap(other);
 			return *this;
 		}
 
+		//exchanges the memory of two storages of the same shape, no sample or state is copied
+		void swap(basic_audio_ring_buffer_storage& other) {
+			if (m_block_count != other.m_block_count || m_channel_count != other.m_channel_count || m_layout != other.m_layout)
+				throw std::domain_error("audio_ring_buffer_storage::swap(other) : block_count, channel_count and layout must match");
+
+			std::swap(m_memory, other.m_memory);
+			std::swap(m_allocator, other.m_allocator);
+			std::swap(m_sample_states, other.m_sample_states);
+			std::swap(m_sample_blocks, other.m_sample_blocks);
+			std::swap(m_state_index, other.m_state_index);
+		}
+
+		//the state bytes rounded up to a whole cache line, the offset of the first block
+		size_t states_size() const {
+			size_t bytes = (m_block_count / state_group_blocks) << m_group_shift;
+			return (bytes + buffer_alignment - 1) / buffer_alignment * buffer_alignment;
+		}
+
+		//the bytes of m_memory, states and blocks
 		size_t size() const {
-			return m_block_count * (1 + sizeof(sample_block));
+			return states_size() + m_block_count * m_channel_count * sizeof(sample_block);
+		}
+
+		//uint64s over every state's bitmap, padding included
+		size_t state_index_size() const {
+			return (size_t(std::numeric_limits<sample_state>::max()) + 1) * m_index_words * m_index_stride;
+		}
+
+		//the cache lines of m_state_index
+		size_t state_index_lines() const {
+			return (state_index_size() + 7) / 8;
+		}
+
+		//the bytes of m_state_index
+		size_t state_index_bytes() const {
+			return state_index_lines() * sizeof(state_index_line);
 		}
 	};
 
+	/// <summary>
+	/// copies sample data without any intermediate buffer or allocation, safe to call from a real-time thread.
+	/// Copies of at least s_stream_copy_threshold bytes use non-temporal (streaming) stores so a large slice doesn't evict
+	/// the working set of the stage threads from cache, smaller ones go through memcpy.
+	/// </summary>
+	void copy_samples(sample* dst, const sample* src, size_t count) noexcept;
+
+	static constexpr size_t s_stream_copy_threshold = 1024 * 1024;
+
 	inline int clamp(int x, int min, int max) {
 		return std::max(min, std::min(max, x));
 	}
@@ -100,55 +231,104 @@ namespace audio_engine {
 	}
 
 	/// <summary>
-	/// A ring buffer implementation for storing audio samples in contiguous array of sample_blocks (float32[480]) 
+	/// A ring buffer implementation for storing audio samples in contiguous array of sample_blocks (float32[BlockSize]) 
+	///
+	/// a block holds m_channel_count sample_blocks, one per channel (planar), and carries a single state byte for all of them
+	/// so a stage claims and processes every channel of a block together
+	///
+	/// audio_ring_buffer is the buffer at the engine's default format, buffers of other formats are distinct types so a block
+	/// can't be handed to code compiled for another block size
 	/// </summary>
-	/// <typeparam name="block_count"></typeparam>
-	class audio_ring_buffer {
+	/// <typeparam name="BlockSize">samples per channel of a block, a multiple of 16</typeparam>
+	/// <typeparam name="SampleRate">the rate of the stream in Hz, sets the default length</typeparam>
+	template <size_t BlockSize, uint32_t SampleRate>
+	class basic_audio_ring_buffer {
 	public:
+		//the buffer's format, shadowing the engine defaults so the code below reads the same at any block size
+		static constexpr size_t sample_block_size = BlockSize;
+		static constexpr uint32_t sample_rate = SampleRate;
+		using sample_block = basic_sample_block<BlockSize>;
+		using sample_duration_t = basic_sample_duration<SampleRate>;
+
+		//at least a second of audio, rounded up to the block_count multiple of 16 the storage requires
+		static constexpr size_t s_default_block_count = ((SampleRate + BlockSize - 1) / BlockSize + 15) / 16 * 16;
+
 		size_t const m_block_count;
+		size_t const m_channel_count;
 
 	private:
-		audio_ring_buffer_storage m_storage;
+		basic_audio_ring_buffer_storage<BlockSize> m_storage;
 
-		const audio_ring_buffer_storage& get_storage() const {
+		const basic_audio_ring_buffer_storage<BlockSize>& get_storage() const {
 			return m_storage;
 		};
 
 	public:
-		audio_ring_buffer(size_t block_count = std::chrono::duration_cast<sample_duration_t>(std::chrono::seconds(1)).count() / sample_block_size)
-			: m_storage(block_count),
-			m_block_count(block_count)
+		/// <param name="allocator">where the samples and states live, see buffer_memory_policy for huge pages, locking and NUMA placement</param>
+		/// <param name="layout">the block state layout, strided for stages run by many workers at once</param>
+		basic_audio_ring_buffer(size_t block_count = s_default_block_count, size_t channel_count = 1, const ring_buffer_allocator_t& allocator = ring_buffer_allocator_t(), state_layout layout = state_layout::packed)
+			: m_block_count(block_count),
+			m_channel_count(channel_count),
+			m_storage(block_count, channel_count, allocator, layout)
 		{
-			clear();
+			//fresh memory from the OS is already zero, clearing it would touch every page from this thread and defeat first touch placement
+			if constexpr (allocates_zeroed<typename basic_audio_ring_buffer_storage<BlockSize>::byte_allocator_t>)
+				rebuild_state_index();
+			else
+				clear();
 		}
 
 		//disable easy copying because I think you should have to be very explicit in wanting to expensively copy the buffer
-		audio_ring_buffer(const audio_ring_buffer& other) = delete;
-		audio_ring_buffer& operator=(const audio_ring_buffer& other) = delete;
+		basic_audio_ring_buffer(const basic_audio_ring_buffer& other) = delete;
+		basic_audio_ring_buffer& operator=(const basic_audio_ring_buffer& other) = delete;
 
-		audio_ring_buffer(audio_ring_buffer&& other) noexcept :
-			m_storage(std::move(other.m_storage)),
-			m_block_count(other.m_block_count)
+		basic_audio_ring_buffer(basic_audio_ring_buffer&& other) noexcept :
+			m_block_count(other.m_block_count),
+			m_channel_count(other.m_channel_count),
+			m_storage(std::move(other.m_storage))
 		{
 
 		};
-		audio_ring_buffer& operator=(audio_ring_buffer&& other) noexcept {
-			std::swap(m_storage, other.m_storage);
-			return *this;
-		};
+		//the shape is const, a buffer takes another's storage through swap_storage which checks the shapes match
+		basic_audio_ring_buffer& operator=(basic_audio_ring_buffer&& other) = delete;
 		
+		//the allocator of the storage the buffer currently holds, e.g to allocate a buffer the same way
+		const ring_buffer_allocator_t& get_allocator() const {
+			return m_storage.m_allocator;
+		};
+
+		state_layout get_state_layout() const {
+			return m_storage.m_layout;
+		};
+
+		//the state bytes, block i's at get_state_offset(i)
 		sample_state* get_block_states() const {
 			return reinterpret_cast<sample_state*>(m_storage.m_sample_states);
 		};
+
+		//where block idx's state byte sits in get_block_states(), idx itself when packed
+		size_t get_state_offset(size_t idx) const {
+			return ((idx / state_group_blocks) << m_storage.m_group_shift) | (idx % state_group_blocks);
+		};
 		sample_block* get_blocks() const {
 			return m_storage.m_sample_blocks;
 		};
 
 		sample_state& get_block_state(int idx) {
-			return get_block_states()[idx % m_block_count];
+			return get_block_states()[get_state_offset(idx % m_block_count)];
 		}
+		//the first channel of the block, the whole block for a mono buffer
 		sample_block& get_block(int idx) {
-			return m_storage.m_sample_blocks[idx % m_block_count];
+			return m_storage.m_sample_blocks[(idx % m_block_count) * m_channel_count];
+		}
+
+		sample_block& get_block(int idx, size_t channel) {
+			return m_storage.m_sample_blocks[(idx % m_block_count) * m_channel_count + channel];
+		}
+
+		//every channel of the block, channel c at [c]
+		std::span<sample_block> get_channels(int idx) {
+			return std::span<sample_block>(&get_block(idx), m_channel_count);
 		}
 
 		/// <summary>
@@ -157,11 +337,14 @@ namespace audio_engine {
 		/// <param name="state">the sample_state to search for</param>
 		/// <returns>a sample_block index if found, or -1</returns>
 		int get_first_match_idx(sample_state state) const {
+			if (get_state_layout() != state_layout::packed)
+				return scan_states([state](sample_state s) { return s == state; });
+
 			__m128i block = _mm_set1_epi8(state);
 			sample_state* states = get_block_states();
 			//loop m128i to find matches 
 			int idx = -1;
-			for (int i = 0; i < m_block_count; i+=16) {
+			for (int i = 0; i < static_cast<int>(m_block_count); i += 16) {
 				__m128i& test_arr = *reinterpret_cast<__m128i*>(&states[i]);
 				int local_idx = 0;
 				if ((local_idx = byte_index(test_arr, block)) < 16) {
@@ -179,11 +362,14 @@ namespace audio_engine {
 		/// <param name="state">the sample_state to search for mismatches against</param>
 		/// <returns>a sample_block index if found, or -1</returns>
 		int get_first_nonmatch_idx(sample_state state) const {
+			if (get_state_layout() != state_layout::packed)
+				return scan_states([state](sample_state s) { return s != state; });
+
 			__m128i block = _mm_set1_epi8(state);
 			sample_state* states = get_block_states();
 			//loop m128i to find matches 
 			int idx = -1;
-			for (int i = 0; i < m_block_count; i += 16) {
+			for (int i = 0; i < static_cast<int>(m_block_count); i += 16) {
 				__m128i& test_arr = *reinterpret_cast<__m128i*>(&states[i]);
 				int local_idx = 0;
 				if ((local_idx = byte_index_inverse(test_arr, block)) < 16) {
@@ -195,23 +381,236 @@ namespace audio_engine {
 			return idx;
 		}
 
+		/// <summary>
+		/// finds a sample_block in the state through the state's occupancy bitmap, starting the search at hint and wrapping around.
+		/// Costs one load per 64 blocks instead of a scan of the state bytes, and lets each worker start from its own position
+		/// instead of every thread piling onto the lowest matching index.
+		///
+		/// The bitmaps trail the state bytes by a moment, the state bytes stay authoritative (claim_run CASes them)
+		/// </summary>
+		/// <param name="state">the sample_state to search for</param>
+		/// <param name="hint">the block index to start searching from</param>
+		/// <returns>a sample_block index if found, or -1</returns>
+		int find_state(sample_state state, size_t hint = 0) const {
+#if defined(AUDIO_ENGINE_LINEAR_STATE_SCAN)
+			return get_first_match_idx(state);
+#else
+			size_t words = m_storage.m_index_words;
+
+			//strided: consecutive groups sit in consecutive words, so scanning the words from the hint's takes the groups after the
+			//hint first, though a word's lowest set bit isn't always the group nearest the hint
+			if (get_state_layout() == state_layout::strided) {
+				size_t first_word = (hint % m_block_count) / state_group_blocks % words;
+				for (size_t i = 0; i < words; i++) {
+					size_t word = (first_word + i) % words;
+					uint64_t bits = index_word(state, word).load(std::memory_order_acquire);
+					if (bits != 0) {
+						size_t bit = std::countr_zero(bits);
+						size_t group = (bit / state_group_blocks) * words + word;
+						return static_cast<int>(group * state_group_blocks + bit % state_group_blocks);
+					}
+				}
+				return -1;
+			}
+
+			size_t first_word = (hint % m_block_count) / 64;
+			uint64_t below_hint = (uint64_t(1) << (hint % 64)) - 1;
+
+			//the hint word from the hint onwards, every other word, then the bits of the hint word below the hint
+			for (size_t i = 0; i <= words; i++) {
+				size_t word = (first_word + i) % words;
+				uint64_t bits = index_word(state, word).load(std::memory_order_acquire);
+				if (i == 0)
+					bits &= ~below_hint;
+				else if (i == words)
+					bits &= below_hint;
+
+				if (bits != 0)
+					return static_cast<int>(word * 64 + std::countr_zero(bits));
+			}
+
+			return -1;
+#endif
+		};
+
+		//true if the block (wrapped) is in the state, read straight from the state byte
+		bool in_state(size_t idx, sample_state state) const {
+			return std::atomic_ref<sample_state>(get_block_states()[get_state_offset(idx % m_block_count)]).load(std::memory_order_acquire) == state;
+		};
+
+		//true if any sample_block is in the state
+		bool has_state(sample_state state) const {
+			return find_state(state) != -1;
+		};
+
+		//number of sample_blocks in the state, a popcount per 64 blocks
+		size_t count_state(sample_state state) const {
+			size_t count = 0;
+			for (size_t i = 0; i < m_storage.m_index_words; i++)
+				count += std::popcount(index_word(state, i).load(std::memory_order_acquire));
+
+			return count;
+		};
+
+		//true if every sample_block is in the state, used for the flush checks
+		bool all_in_state(sample_state state) const {
+#if defined(AUDIO_ENGINE_LINEAR_STATE_SCAN)
+			return get_first_nonmatch_idx(state) == -1;
+#else
+			return count_state(state) == m_block_count;
+#endif
+		};
+
+		/// <summary>
+		/// atomically stores a state into a block (release, so the block's samples are visible to whoever sees the state) and moves
+		/// the block between the occupancy bitmaps
+		/// </summary>
+		void store_state(int idx, sample_state state) {
+			size_t wrapped = idx % m_block_count;
+			sample_state previous = std::atomic_ref<sample_state>(get_block_states()[get_state_offset(wrapped)]).exchange(state, std::memory_order_acq_rel);
+			if (previous != state)
+				move_index_bits(wrapped, 1, previous, state);
+		};
+
+		/// <summary>
+		/// stores the states of a run of blocks from idx (wrapped), as store_state does for each, with one CAS per state group the
+		/// run touches and one move between the bitmaps per stretch of blocks going from and to the same states
+		/// </summary>
+		void store_run(int idx, std::span<const sample_state> states) {
+			size_t done = 0;
+			while (done < states.size()) {
+				//block_count is a multiple of the group size so a group never wraps
+				size_t block = (idx + done) % m_block_count;
+				size_t first = block % state_group_blocks;
+				size_t count = std::min(states.size() - done, state_group_blocks - first);
+
+				std::atomic_ref<uint64_t> word(*reinterpret_cast<uint64_t*>(&get_block_states()[get_state_offset(block - first)]));
+				uint64_t expected = word.load(std::memory_order_relaxed);
+				uint64_t desired;
+				do {
+					desired = expected;
+					for (size_t b = 0; b < count; b++) {
+						uint64_t shift = (first + b) * 8;
+						desired = (desired & ~(uint64_t(0xFF) << shift)) | (uint64_t(states[done + b]) << shift);
+					}
+				} while (!word.compare_exchange_weak(expected, desired, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+				for (size_t b = 0; b < count;) {
+					sample_state previous = static_cast<sample_state>(expected >> ((first + b) * 8));
+					sample_state state = states[done + b];
+					size_t stretch = 1;
+					while (b + stretch < count
+						&& states[done + b + stretch] == state
+						&& static_cast<sample_state>(expected >> ((first + b + stretch) * 8)) == previous)
+						stretch++;
+
+					if (previous != state)
+						move_index_bits(block + b, static_cast<int>(stretch), previous, state);
+					b += stretch;
+				}
+
+				done += count;
+			}
+		};
+
+		//rebuilds the occupancy bitmaps from the state bytes, for construction and the resets that write every state byte directly
+		//it clears the bitmaps before refilling them, so nothing else may be storing or claiming states on the buffer meanwhile
+		void rebuild_state_index() {
+			for (size_t i = 0; i < m_storage.state_index_lines(); i++)
+				for (auto& word : m_storage.m_state_index[i].words)
+					word.store(0, std::memory_order_relaxed);
+
+			sample_state* states = get_block_states();
+			for (size_t i = 0; i < m_block_count; i++) {
+				auto [word, bit] = index_position(i);
+				index_word(states[get_state_offset(i)], word).fetch_or(uint64_t(1) << bit, std::memory_order_relaxed);
+			}
+
+			std::atomic_thread_fence(std::memory_order_release);
+		};
+
+		/// <summary>
+		/// claims the contiguous run of sample_blocks starting at idx that are all in the from state, moving them into the to state
+		/// with a single CAS on the 8 byte state word holding idx. The run never crosses that state word so it is at most 8 blocks long.
+		///
+		/// retries internally if the CAS fails but the block at idx is still claimable (spurious failure or a neighbour changed state)
+		/// </summary>
+		/// <param name="idx">the first sample_block of the run</param>
+		/// <param name="from">the state every block of the run must be in</param>
+		/// <param name="to">the state the run is moved into</param>
+		/// <param name="max_blocks">upper bound on the run length</param>
+		/// <returns>the number of sample_blocks claimed, 0 if the block at idx was no longer in the from state</returns>
+		int claim_run(int idx, sample_state from, sample_state to, int max_blocks) {
+			constexpr int word_blocks = state_group_blocks;
+			int first = idx % word_blocks;
+
+			//block_count is a multiple of 16 and the states are 16 byte aligned so the word never leaves the state array
+			std::atomic_ref<uint64_t> word(*reinterpret_cast<uint64_t*>(&get_block_states()[get_state_offset(idx - first)]));
+			uint64_t expected = word.load(std::memory_order_relaxed);
+
+			//only extend the run over blocks already published to the from bitmap, a block whose bit isn't set yet would have it
+			//set after we cleared it and be left behind as a stale entry
+			auto [index_word_idx, group_bit] = index_position(idx - first);
+			uint64_t indexed = index_word(from, index_word_idx).load(std::memory_order_acquire) >> group_bit;
+
+			while (true) {
+				uint64_t desired = expected;
+				int run = 0;
+				//state bytes are little endian within the word, byte n is block (idx - first + n)
+				for (int b = first; b < word_blocks && run < max_blocks; b++, run++) {
+					uint64_t shift = b * 8;
+					if (((expected >> shift) & 0xFF) != from || ((indexed >> b) & 1) == 0)
+						break;
+					desired = (desired & ~(uint64_t(0xFF) << shift)) | (uint64_t(to) << shift);
+				}
+
+				if (run == 0)
+					return 0;
+
+				if (word.compare_exchange_weak(expected, desired, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					move_index_bits(idx, run, from, to);
+					return run;
+				}
+			}
+		}
+
 		void set_state(int block_idx, sample_state state) {
-			get_block_states()[block_idx] = state;
+			sample_state& stored = get_block_states()[get_state_offset(block_idx)];
+			sample_state previous = stored;
+			stored = state;
+			if (previous != state)
+				move_index_bits(block_idx, 1, previous, state);
 		};
 
 		void clear() {
 			memset(m_storage.m_memory, 0, m_storage.size());
+			rebuild_state_index();
+		};
+
+		//resets every block state without touching the samples
+		void fill_states(sample_state state) {
+			memset(get_block_states(), state, m_storage.states_size()); //a strided layout's padding too, nothing reads it
+			rebuild_state_index();
+		};
+
+		/// <summary>
+		/// hands this buffer's samples and states to other and takes other's in exchange by swapping the storage, nothing is copied.
+		/// Used to pass a whole buffer between pipeline groups, nobody may be accessing either buffer while the swap happens.
+		/// </summary>
+		void swap_storage(basic_audio_ring_buffer& other) {
+			m_storage.swap(other.m_storage);
 		};
 
 		
 		
-		void copy_to(audio_ring_buffer& dest, uint32_t samples_offset = 0) const {
+		void copy_to(basic_audio_ring_buffer& dest, uint32_t samples_offset = 0) const {
 			copy_slice_to(dest, 0, samples_offset, m_block_count * sample_block_size);
 		};
 
-		audio_ring_buffer copy() const {
-			auto temporary = audio_ring_buffer(m_block_count);
+		basic_audio_ring_buffer copy() const {
+			auto temporary = basic_audio_ring_buffer(m_block_count, m_channel_count, get_allocator(), get_state_layout());
 			copy_to(temporary, 0);
+			return temporary;
 		};
 
 
@@ -226,13 +625,15 @@ namespace audio_engine {
 		/// a partial sample_block
 		/// 
 		/// Generally keep samples_range and samples_offset as multiples of sample_block size unless this behavior is explicitly needed
+		///
+		/// sample indices count frames (one sample of every channel), both buffers must have the same channel_count
 		/// </summary>
 		/// <typeparam name="dest_block_count">count of sample_blocks in the destination buffer</typeparam>
 		/// <param name="dest:			">the buffer to copy the data to</param>
 		/// <param name="sample_idx_from:	">the sample index to start copying from</param>
 		/// <param name="sample_idx_to:		">the sample index to copy to</param>
 		/// <param name="samples_range:		">the range of samples to copy</param>
-		void copy_slice_to(audio_ring_buffer& dest, uint32_t sample_idx_from, uint32_t sample_idx_to, uint32_t samples_range) const {
+		void copy_slice_to(basic_audio_ring_buffer& dest, uint32_t sample_idx_from, uint32_t sample_idx_to, uint32_t samples_range) const {
 			std::atomic_thread_fence(std::memory_order_acquire);
 
 			auto block_count = m_block_count;
@@ -244,107 +645,139 @@ namespace audio_engine {
 			if (samples_range > min_buffer_size)
 				throw std::domain_error("samples_range must not exceed the size of the smallest buffer (to, from)");
 
-			audio_ring_buffer_storage intermediate_buffer(block_count); //this is a bit inefficient but makes this easier to maintain
-			memset(intermediate_buffer.m_memory, 0, intermediate_buffer.size());
-
-			sample* raw_from_samples = reinterpret_cast<sample*>(get_blocks());
-			sample_state* raw_from_states = reinterpret_cast<sample_state*>(get_block_states());
-			sample* raw_tmp_samples = reinterpret_cast<sample*>(intermediate_buffer.m_sample_blocks);
-			sample_state* raw_tmp_states = reinterpret_cast<sample_state*>(intermediate_buffer.m_sample_states);
-			sample* raw_dest_samples = reinterpret_cast<sample*>(dest.get_blocks());
-			sample_state* raw_dest_states = reinterpret_cast<sample_state*>(dest.get_block_states());
-
-			uint32_t wrapped_to = (sample_idx_to) % to_buffer_size;
+			if (m_channel_count != dest.m_channel_count)
+				throw std::domain_error("audio_ring_buffer::copy_slice_to(dest, ...) : channel_count must match");
 
-			//memory space
-			uintptr_t from_samples = reinterpret_cast<uintptr_t>(raw_from_samples) + sample_idx_from * sizeof(sample);
-			uintptr_t from_state = reinterpret_cast<uintptr_t>(raw_from_states) + sample_idx_from / sample_block_size;
-			uintptr_t tmp_samples = reinterpret_cast<uintptr_t>(raw_tmp_samples);
-			uintptr_t tmp_state = reinterpret_cast<uintptr_t>(raw_tmp_states);
-			uintptr_t to_samples = reinterpret_cast<uintptr_t>(raw_dest_samples) + wrapped_to * sizeof(sample);
-			uintptr_t to_state = reinterpret_cast<uintptr_t>(raw_dest_states) + wrapped_to / sample_block_size;
+			uint32_t wrapped_from = sample_idx_from % from_buffer_size;
+			uint32_t wrapped_to = sample_idx_to % to_buffer_size;
 
-
-			//bounds calculations (in sample size not byte size)
-			uint32_t tmp_unwrap_size = ((samples_range-1) % (from_buffer_size - sample_idx_from)) +1;
-			uint32_t tmp_wrap_size = samples_range - tmp_unwrap_size;
-			uint32_t to_unwrap_size = ((samples_range-1) % (to_buffer_size - sample_idx_to)) + 1;
-			uint32_t to_wrap_size = samples_range - to_unwrap_size;
-
-			//memory space
-			uintptr_t from_unwrap_state = from_state;
-			uintptr_t from_wrap_state = from_unwrap_state - sample_idx_from / sample_block_size;
-			
+			//samples go straight from source to destination, split wherever either buffer wraps (at most 3 segments)
+			if (m_channel_count == 1)
+				copy_wrapped_segments(
+					reinterpret_cast<const sample*>(get_blocks()), from_buffer_size, wrapped_from,
+					reinterpret_cast<sample*>(dest.get_blocks()), to_buffer_size, wrapped_to,
+					samples_range,
+					&copy_samples
+				);
+			else
+				copy_planar_frames(dest, wrapped_from, wrapped_to, samples_range);
 
 			//buffer(state) space
 			//intentionally truncate the last block, this is to be consistent with keeping the 0th partial block (from) 
 			uint32_t slice_block_count = samples_range / sample_block_size;
-			uint32_t tmp_wrap_size_state = tmp_wrap_size / sample_block_size;
-			uint32_t tmp_unwrap_size_state = slice_block_count - tmp_wrap_size_state;
-			uint32_t to_wrap_size_state = to_wrap_size / sample_block_size;
-			uint32_t to_unwrap_size_state = slice_block_count - to_wrap_size_state;
-
-
-
-
-			//uint32_t to_wrap_size_state = to_wrap_size / sample_block_size;
-			//uint32_t to_unwrap_size_state = dest_block_count / sample_block_size;
-
-			//copy into the temp buffer
-
-			memcpy(
-				reinterpret_cast<void*>(tmp_samples),
-				reinterpret_cast<void*>(from_samples + (from_buffer_size - tmp_unwrap_size - sample_idx_from) * sizeof(sample)),
-				static_cast<size_t>(tmp_unwrap_size * sizeof(sample))
-			);
-			memcpy(
-				reinterpret_cast<void*>(tmp_samples + tmp_unwrap_size * sizeof(sample)),
-				reinterpret_cast<void*>(from_samples - sample_idx_from * sizeof(sample)),
-				static_cast<size_t>(tmp_wrap_size * sizeof(sample))
-			);
-			memcpy(
-				reinterpret_cast<void*>(tmp_state),
-				reinterpret_cast<void*>(from_unwrap_state),
-				static_cast<size_t>(tmp_unwrap_size_state)
-			);
-			memcpy(
-				reinterpret_cast<void*>(tmp_state + tmp_unwrap_size_state),
-				reinterpret_cast<void*>(from_wrap_state),
-				static_cast<size_t>(tmp_wrap_size_state)
-			);
-
-
-			//copy from the temp buffer into the target buffer
-			memcpy(
-				reinterpret_cast<void*>(to_samples),
-				reinterpret_cast<void*>(tmp_samples),
-				static_cast<size_t>(to_unwrap_size) * sizeof(sample)
-			);
-			memcpy(
-				reinterpret_cast<void*>(raw_dest_samples),
-				reinterpret_cast<void*>(tmp_samples + to_unwrap_size * sizeof(sample)),
-				static_cast<size_t>(to_wrap_size) * sizeof(sample)
-			);
-			memcpy(
-				reinterpret_cast<void*>(to_state),
-				reinterpret_cast<void*>(tmp_state),
-				static_cast<size_t>(to_unwrap_size_state)
-			);
-			memcpy(
-				reinterpret_cast<void*>(raw_dest_states),
-				reinterpret_cast<void*>(tmp_state + to_unwrap_size_state),
-				static_cast<size_t>(to_wrap_size_state)
-			);
+
+			//the states go in through store_run, so only the copied blocks' bits move between dest's bitmaps and a stage storing or
+			//claiming elsewhere in dest at the same time keeps its own. The cost is the slice, not the size of dest
+			uint32_t first_from = wrapped_from / sample_block_size;
+			uint32_t first_to = wrapped_to / sample_block_size;
+			constexpr uint32_t batch_blocks = state_group_blocks * 8;
+			sample_state states[batch_blocks];
+			for (uint32_t done = 0; done < slice_block_count;) {
+				uint32_t count = std::min(slice_block_count - done, batch_blocks);
+				for (uint32_t i = 0; i < count; i++)
+					states[i] = get_block_states()[get_state_offset((first_from + done + i) % block_count)];
+				dest.store_run(static_cast<int>((first_to + done) % dest_block_count), std::span<const sample_state>(states, count));
+				done += count;
+			}
 
 			std::atomic_thread_fence(std::memory_order_release);
 		};
 
+	private:
+		//word of the state's bitmap
+		std::atomic<uint64_t>& index_word(sample_state state, size_t word) const {
+			size_t position = (state * m_storage.m_index_words + word) * m_storage.m_index_stride;
+			return m_storage.m_state_index[position / 8].words[position % 8];
+		};
 
+		/// <summary>
+		/// the bitmap word holding block idx's bit and the bit within it, a group's bits are always consecutive in one word
+		/// packed: word idx / 64, bit idx % 64. strided: group g is the (g / words)th byte of word g % words
+		/// </summary>
+		std::pair<size_t, unsigned> index_position(size_t idx) const {
+			if (get_state_layout() == state_layout::strided) {
+				size_t group = idx / state_group_blocks;
+				size_t words = m_storage.m_index_words;
+				return { group % words, static_cast<unsigned>((group / words) * state_group_blocks + idx % state_group_blocks) };
+			}
+			return { idx / 64, static_cast<unsigned>(idx % 64) };
+		};
 
-		
-		
+		//moves count blocks from idx between two state bitmaps, the blocks must not cross a state group boundary
+		void move_index_bits(size_t idx, int count, sample_state from, sample_state to) {
+			auto [word, bit] = index_position(idx);
+			uint64_t bits = ((uint64_t(1) << count) - 1) << bit;
+			index_word(to, word).fetch_or(bits, std::memory_order_release);
+			index_word(from, word).fetch_and(~bits, std::memory_order_release);
+		};
 
-		
+		//the first block whose state matches, in block order, for layouts the SSE scans can't walk
+		template <typename F>
+		int scan_states(F&& matches) const {
+			const sample_state* states = get_block_states();
+			for (size_t i = 0; i < m_block_count; i++)
+				if (matches(states[get_state_offset(i)]))
+					return static_cast<int>(i);
+			return -1;
+		};
+
+		/// <summary>
+		/// copy_slice_to for multichannel buffers, where a stretch of frames is only contiguous per channel within a block.
+		/// Stretches where both sides are block aligned are whole blocks of every channel and go in one copy up to the next wrap,
+		/// anything else is copied channel by channel up to the next block boundary of either side
+		/// </summary>
+		void copy_planar_frames(basic_audio_ring_buffer& dest, size_t from, size_t to, size_t count) const {
+			size_t from_size = m_block_count * sample_block_size;
+			size_t to_size = dest.m_block_count * sample_block_size;
+			const sample* src = reinterpret_cast<const sample*>(get_blocks());
+			sample* dst = reinterpret_cast<sample*>(dest.get_blocks());
+
+			while (count > 0) {
+				size_t from_offset = from % sample_block_size;
+				size_t to_offset = to % sample_block_size;
+				size_t segment;
+
+				if (from_offset == 0 && to_offset == 0 && count >= sample_block_size) {
+					segment = std::min({ count - count % sample_block_size, from_size - from, to_size - to });
+					copy_samples(dst + to * m_channel_count, src + from * m_channel_count, segment * m_channel_count);
+				}
+				else {
+					segment = std::min({ count, sample_block_size - from_offset, sample_block_size - to_offset });
+					const sample* src_block = src + (from - from_offset) * m_channel_count + from_offset;
+					sample* dst_block = dst + (to - to_offset) * m_channel_count + to_offset;
+					for (size_t c = 0; c < m_channel_count; c++)
+						copy_samples(dst_block + c * sample_block_size, src_block + c * sample_block_size, segment);
+				}
+
+				count -= segment;
+				from = (from + segment) % from_size;
+				to = (to + segment) % to_size;
+			}
+		};
+
+		/// <summary>
+		/// copies count elements between two rings, starting at src_pos/dst_pos and wrapping each ring independently,
+		/// every segment runs until whichever of the two rings wraps first
+		/// </summary>
+		template <typename T>
+		static void copy_wrapped_segments(
+			const T* src, size_t src_size, size_t src_pos,
+			T* dst, size_t dst_size, size_t dst_pos,
+			size_t count,
+			void (*copy_segment)(T*, const T*, size_t) noexcept
+		) {
+			while (count > 0) {
+				size_t segment = std::min({ count, src_size - src_pos, dst_size - dst_pos });
+				copy_segment(dst + dst_pos, src + src_pos, segment);
+
+				count -= segment;
+				src_pos = (src_pos + segment) % src_size;
+				dst_pos = (dst_pos + segment) % dst_size;
+			}
+		};
 	};
+
+	using audio_ring_buffer_storage = basic_audio_ring_buffer_storage<sample_block_size>;
+	using audio_ring_buffer = basic_audio_ring_buffer<sample_block_size, sample_rate>;
 };
 #endif
@@ -1,9 +1,22 @@
 #ifndef AUDIO_TYPES_H
 #define AUDIO_TYPES_H
 
+#include "buffer_memory.h"
+
 #include <cstdint>
 #include <chrono>
+#include <vector>
+#include <memory>
+
+//AVX2 kernels also use FMA, which GCC/Clang report separately and MSVC enables together with /arch:AVX2
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define AUDIO_ENGINE_AVX2 1
+#endif
 
+//MSVC's __forceinline spelled for GCC and Clang, the hot paths rely on it to inline the stage calls into the workers
+#if !defined(_MSC_VER) && !defined(__forceinline)
+#define __forceinline inline __attribute__((always_inline))
+#endif
 
 
 namespace audio_engine
@@ -27,14 +40,33 @@ namespace audio_engine
 		return typename allocator_rebind<T, U>::type(alloc);
 	}
 
+	//the engine's default format, the block size and sample rate of the non-template names (audio_ring_buffer, pipeline_stage,
+	//audio_pipeline...), the basic_ templates take any other as template parameters
 	constexpr size_t sample_block_size = 480;
-	constexpr auto sample_rate = 48000;
+	constexpr uint32_t sample_rate = 48000;
 
 	using sample = float;
-	using sample_block = sample[sample_block_size];
+
+	//the channels of a block sit back to back (planar), a block size of whole cache lines keeps every channel aligned for AVX
+	template <size_t BlockSize>
+	constexpr bool valid_block_size = BlockSize > 0 && (BlockSize * sizeof(sample)) % 64 == 0;
+
+	template <size_t BlockSize>
+	using basic_sample_block = sample[BlockSize];
+
+	template <uint32_t SampleRate>
+	using basic_sample_duration = std::chrono::duration<long long, std::ratio<1, SampleRate>>;
+
+	using sample_block = basic_sample_block<sample_block_size>;
+	static_assert(valid_block_size<sample_block_size>, "sample_block_size must be a multiple of 16 samples");
+
+	//the most channels a buffer can carry, so stages can keep per channel scratch on the stack
+	constexpr size_t max_channel_count = 16;
+	//the most buffers a single stage reads, so the pipeline can gather a run of every input on the stack
+	constexpr size_t max_stage_inputs = 64;
 	using sample_state = uint8_t; //at most 256 (0-255) sample states supported on a single audio buffer 
-	using sample_duration_t = std::chrono::duration<long long, std::ratio<1, sample_rate>>;
-	using ring_buffer_allocator_t = std::allocator<std::byte>;
+	using sample_duration_t = basic_sample_duration<sample_rate>;
+	using ring_buffer_allocator_t = buffer_allocator<std::byte>; //the allocator every ring buffer takes its storage from
 
 	constexpr std::chrono::microseconds sample_duration_us = std::chrono::duration_cast<std::chrono::microseconds>(sample_duration_t(1));
 }
@@ -0,0 +1,403 @@
+#include "biquad_bank.h"
+
+#include <immintrin.h>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <numbers>
+#include <string>
+
+namespace audio_engine {
+
+	namespace {
+		constexpr size_t lanes = 8;  //filters per lane group
+		constexpr size_t chunk = 64; //samples per pass through the cascade, a group's chunk is 2KB
+		constexpr size_t batch = 4;  //lane groups run together, enough independent recursions to cover the FMA latency
+
+		constexpr size_t coefficient_stride = 5 * lanes; //floats per section of a group: b0, b1, b2, a1, a2
+		constexpr size_t state_stride = 2 * lanes;       //floats per section of a group: s1, s2
+
+		//a decayed state is cut to zero at the end of a chunk, a filter left ringing into silence would otherwise end up running
+		//on denormals, many times slower than on normal floats
+		constexpr float flush_below = 1e-20f;
+
+		//the per section terms of the cookbook designs
+		struct design_terms {
+			double cos_w;
+			double alpha;
+		};
+
+		design_terms make_terms(const char* fn, double frequency, double q, uint32_t rate) {
+			if (!(frequency > 0.0 && frequency < rate / 2.0))
+				throw std::domain_error(std::string("biquad_coefficients::") + fn + "(frequency, q, rate) : frequency must be in (0, rate / 2)");
+			if (!(q > 0.0))
+				throw std::domain_error(std::string("biquad_coefficients::") + fn + "(frequency, q, rate) : q must be greater than 0");
+
+			double w = 2.0 * std::numbers::pi * frequency / rate;
+			return { std::cos(w), std::sin(w) / (2.0 * q) };
+		}
+
+		biquad_coefficients normalise(double b0, double b1, double b2, double a0, double a1, double a2) noexcept {
+			return {
+				static_cast<float>(b0 / a0), static_cast<float>(b1 / a0), static_cast<float>(b2 / a0),
+				static_cast<float>(a1 / a0), static_cast<float>(a2 / a0)
+			};
+		}
+
+		//moves n samples of 8 filters into lane order, sample t of lane l at work[t * 8 + l]
+		void to_lanes(const sample* const* src, float* work, size_t n) noexcept {
+			size_t t = 0;
+#if defined(AUDIO_ENGINE_AVX2)
+			for (; t + lanes <= n; t += lanes) {
+				__m256 r0 = _mm256_loadu_ps(src[0] + t), r1 = _mm256_loadu_ps(src[1] + t);
+				__m256 r2 = _mm256_loadu_ps(src[2] + t), r3 = _mm256_loadu_ps(src[3] + t);
+				__m256 r4 = _mm256_loadu_ps(src[4] + t), r5 = _mm256_loadu_ps(src[5] + t);
+				__m256 r6 = _mm256_loadu_ps(src[6] + t), r7 = _mm256_loadu_ps(src[7] + t);
+
+				__m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+				__m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+				__m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+				__m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+				__m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xee);
+				__m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xee);
+				__m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44), u5 = _mm256_shuffle_ps(t4, t6, 0xee);
+				__m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44), u7 = _mm256_shuffle_ps(t5, t7, 0xee);
+
+				float* w = work + t * lanes;
+				_mm256_storeu_ps(w, _mm256_permute2f128_ps(u0, u4, 0x20));
+				_mm256_storeu_ps(w + 8, _mm256_permute2f128_ps(u1, u5, 0x20));
+				_mm256_storeu_ps(w + 16, _mm256_permute2f128_ps(u2, u6, 0x20));
+				_mm256_storeu_ps(w + 24, _mm256_permute2f128_ps(u3, u7, 0x20));
+				_mm256_storeu_ps(w + 32, _mm256_permute2f128_ps(u0, u4, 0x31));
+				_mm256_storeu_ps(w + 40, _mm256_permute2f128_ps(u1, u5, 0x31));
+				_mm256_storeu_ps(w + 48, _mm256_permute2f128_ps(u2, u6, 0x31));
+				_mm256_storeu_ps(w + 56, _mm256_permute2f128_ps(u3, u7, 0x31));
+			}
+#endif
+			for (; t < n; t++)
+				for (size_t l = 0; l < lanes; l++)
+					work[t * lanes + l] = src[l][t];
+		}
+
+		//the transpose back, the same shuffles since an 8x8 transpose is its own inverse
+		void from_lanes(const float* work, sample* const* dst, size_t n) noexcept {
+			size_t t = 0;
+#if defined(AUDIO_ENGINE_AVX2)
+			for (; t + lanes <= n; t += lanes) {
+				const float* w = work + t * lanes;
+				__m256 r0 = _mm256_loadu_ps(w), r1 = _mm256_loadu_ps(w + 8);
+				__m256 r2 = _mm256_loadu_ps(w + 16), r3 = _mm256_loadu_ps(w + 24);
+				__m256 r4 = _mm256_loadu_ps(w + 32), r5 = _mm256_loadu_ps(w + 40);
+				__m256 r6 = _mm256_loadu_ps(w + 48), r7 = _mm256_loadu_ps(w + 56);
+
+				__m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+				__m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+				__m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+				__m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+				__m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xee);
+				__m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xee);
+				__m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44), u5 = _mm256_shuffle_ps(t4, t6, 0xee);
+				__m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44), u7 = _mm256_shuffle_ps(t5, t7, 0xee);
+
+				_mm256_storeu_ps(dst[0] + t, _mm256_permute2f128_ps(u0, u4, 0x20));
+				_mm256_storeu_ps(dst[1] + t, _mm256_permute2f128_ps(u1, u5, 0x20));
+				_mm256_storeu_ps(dst[2] + t, _mm256_permute2f128_ps(u2, u6, 0x20));
+				_mm256_storeu_ps(dst[3] + t, _mm256_permute2f128_ps(u3, u7, 0x20));
+				_mm256_storeu_ps(dst[4] + t, _mm256_permute2f128_ps(u0, u4, 0x31));
+				_mm256_storeu_ps(dst[5] + t, _mm256_permute2f128_ps(u1, u5, 0x31));
+				_mm256_storeu_ps(dst[6] + t, _mm256_permute2f128_ps(u2, u6, 0x31));
+				_mm256_storeu_ps(dst[7] + t, _mm256_permute2f128_ps(u3, u7, 0x31));
+			}
+#endif
+			for (; t < n; t++)
+				for (size_t l = 0; l < lanes; l++)
+					dst[l][t] = work[t * lanes + l];
+		}
+
+#if defined(AUDIO_ENGINE_AVX2)
+		//runs n samples of B lane groups through D consecutive sections from first, group b's samples at work + b * chunk * lanes
+		//and its sections section_count apart in the coefficients and state
+		//the sections are skewed by a sample each, at step t section first + d filters sample t - d, which its predecessor
+		//finished the step before. So the B * D recursions of a step don't depend on each other and are in flight together,
+		//rather than every section waiting on its own two dependent FMAs per sample in turn
+		template <size_t B, size_t D>
+		void run_tile(float* work, const float* coefficients, float* state, size_t section_count, size_t first, size_t n) noexcept {
+			__m256 b0[D][B], b1[D][B], b2[D][B], a1[D][B], a2[D][B], s1[D][B], s2[D][B];
+			for (size_t d = 0; d < D; d++) {
+				for (size_t b = 0; b < B; b++) {
+					const float* c = coefficients + (b * section_count + first + d) * coefficient_stride;
+					const float* s = state + (b * section_count + first + d) * state_stride;
+					b0[d][b] = _mm256_loadu_ps(c);
+					b1[d][b] = _mm256_loadu_ps(c + 8);
+					b2[d][b] = _mm256_loadu_ps(c + 16);
+					a1[d][b] = _mm256_loadu_ps(c + 24);
+					a2[d][b] = _mm256_loadu_ps(c + 32);
+					s1[d][b] = _mm256_loadu_ps(s);
+					s2[d][b] = _mm256_loadu_ps(s + 8);
+				}
+			}
+
+			//transposed direct form II, y is one FMA from s1 and the next s1 and s2 are one FMA from y
+			auto filter = [&](size_t d, size_t t) {
+				for (size_t b = 0; b < B; b++) {
+					float* w = work + (b * chunk + t) * lanes;
+					__m256 x = _mm256_loadu_ps(w);
+					__m256 y = _mm256_fmadd_ps(b0[d][b], x, s1[d][b]);
+					s1[d][b] = _mm256_fnmadd_ps(a1[d][b], y, _mm256_fmadd_ps(b1[d][b], x, s2[d][b]));
+					s2[d][b] = _mm256_fnmadd_ps(a2[d][b], y, _mm256_mul_ps(b2[d][b], x));
+					_mm256_storeu_ps(w, y);
+				}
+			};
+
+			//the skew fills up over the first D - 1 steps and drains over the last D - 1, in between every section has a sample
+			size_t t = 0;
+			for (; t < D - 1; t++)
+				for (size_t d = 0; d <= t; d++)
+					if (t - d < n)
+						filter(d, t - d);
+			for (; t < n; t++)
+				for (size_t d = 0; d < D; d++)
+					filter(d, t - d);
+			for (; t < n + D - 1; t++)
+				for (size_t d = 0; d < D; d++)
+					if (t >= d && t - d < n)
+						filter(d, t - d);
+
+			const __m256 sign = _mm256_set1_ps(-0.f);
+			const __m256 floor = _mm256_set1_ps(flush_below);
+			for (size_t d = 0; d < D; d++) {
+				for (size_t b = 0; b < B; b++) {
+					float* s = state + (b * section_count + first + d) * state_stride;
+					_mm256_storeu_ps(s, _mm256_and_ps(s1[d][b], _mm256_cmp_ps(_mm256_andnot_ps(sign, s1[d][b]), floor, _CMP_GE_OQ)));
+					_mm256_storeu_ps(s + 8, _mm256_and_ps(s2[d][b], _mm256_cmp_ps(_mm256_andnot_ps(sign, s2[d][b]), floor, _CMP_GE_OQ)));
+				}
+			}
+		}
+
+		//runs n samples of B lane groups through every section, about 4 recursions at a time: the groups side by side and
+		//where there are fewer than 4 groups, that many sections of each skewed against each other
+		template <size_t B>
+		void run_sections(float* work, const float* coefficients, float* state, size_t section_count, size_t n) noexcept {
+			constexpr size_t D = B >= 3 ? 1 : 4 / B;
+			size_t k = 0;
+			for (; k + D <= section_count; k += D)
+				run_tile<B, D>(work, coefficients, state, section_count, k, n);
+			for (; k < section_count; k++)
+				run_tile<B, 1>(work, coefficients, state, section_count, k, n);
+		}
+#else
+		//runs n samples of B lane groups through every section, a lane at a time
+		template <size_t B>
+		void run_sections(float* work, const float* coefficients, float* state, size_t section_count, size_t n) noexcept {
+			for (size_t k = 0; k < section_count; k++) {
+				for (size_t b = 0; b < B; b++) {
+					const float* c = coefficients + (b * section_count + k) * coefficient_stride;
+					float* s = state + (b * section_count + k) * state_stride;
+					for (size_t l = 0; l < lanes; l++) {
+						float s1 = s[l];
+						float s2 = s[lanes + l];
+						for (size_t t = 0; t < n; t++) {
+							float& w = work[(b * chunk + t) * lanes + l];
+							float x = w;
+							float y = c[l] * x + s1;
+							s1 = c[8 + l] * x + s2 - c[24 + l] * y;
+							s2 = c[16 + l] * x - c[32 + l] * y;
+							w = y;
+						}
+						s[l] = std::abs(s1) >= flush_below ? s1 : 0.f;
+						s[lanes + l] = std::abs(s2) >= flush_below ? s2 : 0.f;
+					}
+				}
+			}
+		}
+#endif
+	}
+
+	biquad_coefficients biquad_coefficients::lowpass(double frequency, double q, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("lowpass", frequency, q, rate);
+		return normalise((1.0 - cos_w) / 2.0, 1.0 - cos_w, (1.0 - cos_w) / 2.0, 1.0 + alpha, -2.0 * cos_w, 1.0 - alpha);
+	}
+
+	biquad_coefficients biquad_coefficients::highpass(double frequency, double q, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("highpass", frequency, q, rate);
+		return normalise((1.0 + cos_w) / 2.0, -(1.0 + cos_w), (1.0 + cos_w) / 2.0, 1.0 + alpha, -2.0 * cos_w, 1.0 - alpha);
+	}
+
+	biquad_coefficients biquad_coefficients::bandpass(double frequency, double q, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("bandpass", frequency, q, rate);
+		return normalise(alpha, 0.0, -alpha, 1.0 + alpha, -2.0 * cos_w, 1.0 - alpha);
+	}
+
+	biquad_coefficients biquad_coefficients::notch(double frequency, double q, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("notch", frequency, q, rate);
+		return normalise(1.0, -2.0 * cos_w, 1.0, 1.0 + alpha, -2.0 * cos_w, 1.0 - alpha);
+	}
+
+	biquad_coefficients biquad_coefficients::allpass(double frequency, double q, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("allpass", frequency, q, rate);
+		return normalise(1.0 - alpha, -2.0 * cos_w, 1.0 + alpha, 1.0 + alpha, -2.0 * cos_w, 1.0 - alpha);
+	}
+
+	biquad_coefficients biquad_coefficients::peaking(double frequency, double q, double gain_db, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("peaking", frequency, q, rate);
+		double a = std::pow(10.0, gain_db / 40.0);
+		return normalise(1.0 + alpha * a, -2.0 * cos_w, 1.0 - alpha * a, 1.0 + alpha / a, -2.0 * cos_w, 1.0 - alpha / a);
+	}
+
+	biquad_coefficients biquad_coefficients::low_shelf(double frequency, double q, double gain_db, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("low_shelf", frequency, q, rate);
+		double a = std::pow(10.0, gain_db / 40.0);
+		double root = 2.0 * std::sqrt(a) * alpha;
+		return normalise(
+			a * ((a + 1.0) - (a - 1.0) * cos_w + root),
+			2.0 * a * ((a - 1.0) - (a + 1.0) * cos_w),
+			a * ((a + 1.0) - (a - 1.0) * cos_w - root),
+			(a + 1.0) + (a - 1.0) * cos_w + root,
+			-2.0 * ((a - 1.0) + (a + 1.0) * cos_w),
+			(a + 1.0) + (a - 1.0) * cos_w - root
+		);
+	}
+
+	biquad_coefficients biquad_coefficients::high_shelf(double frequency, double q, double gain_db, uint32_t rate)
+	{
+		auto [cos_w, alpha] = make_terms("high_shelf", frequency, q, rate);
+		double a = std::pow(10.0, gain_db / 40.0);
+		double root = 2.0 * std::sqrt(a) * alpha;
+		return normalise(
+			a * ((a + 1.0) + (a - 1.0) * cos_w + root),
+			-2.0 * a * ((a - 1.0) + (a + 1.0) * cos_w),
+			a * ((a + 1.0) + (a - 1.0) * cos_w - root),
+			(a + 1.0) - (a - 1.0) * cos_w + root,
+			2.0 * ((a - 1.0) - (a + 1.0) * cos_w),
+			(a + 1.0) - (a - 1.0) * cos_w - root
+		);
+	}
+
+	biquad_bank::biquad_bank(size_t filter_count, size_t section_count)
+		: m_filter_count(filter_count),
+		m_section_count(section_count),
+		m_group_count((filter_count + lanes - 1) / lanes),
+		m_design(filter_count * section_count),
+		m_sets(),
+		m_front(0),
+		m_back(2),
+		m_middle(1),
+		m_state(),
+		m_work(),
+		m_silence(),
+		m_discard()
+	{
+		if (filter_count == 0)
+			throw std::domain_error("biquad_bank::biquad_bank(filter_count, section_count) : filter_count must be greater than 0");
+		if (section_count == 0)
+			throw std::domain_error("biquad_bank::biquad_bank(filter_count, section_count) : section_count must be greater than 0");
+
+		//every set starts as the pass through design, whichever one the audio thread ends up holding
+		size_t set_size = m_group_count * m_section_count * coefficient_stride;
+		for (auto& set : m_sets) {
+			set = std::make_unique<float[]>(set_size);
+			write_set(set.get());
+		}
+
+		m_state = std::make_unique<float[]>(m_group_count * m_section_count * state_stride);
+		m_work = std::make_unique<float[]>(batch * chunk * lanes);
+		m_silence = std::make_unique<float[]>(chunk);
+		m_discard = std::make_unique<float[]>(chunk);
+	}
+
+	void biquad_bank::write_set(float* set) const noexcept
+	{
+		for (size_t f = 0; f < m_filter_count; f++) {
+			size_t group = f / lanes;
+			size_t lane = f % lanes;
+			for (size_t k = 0; k < m_section_count; k++) {
+				const biquad_coefficients& c = m_design[f * m_section_count + k];
+				float* section = set + (group * m_section_count + k) * coefficient_stride;
+				section[lane] = c.b0;
+				section[8 + lane] = c.b1;
+				section[16 + lane] = c.b2;
+				section[24 + lane] = c.a1;
+				section[32 + lane] = c.a2;
+			}
+		}
+	}
+
+	void biquad_bank::set_section(size_t filter, size_t section, const biquad_coefficients& coefficients)
+	{
+		if (filter >= m_filter_count || section >= m_section_count)
+			throw std::domain_error("biquad_bank::set_section(filter, section, coefficients) : filter or section out of range");
+		m_design[filter * m_section_count + section] = coefficients;
+	}
+
+	void biquad_bank::publish() noexcept
+	{
+		//the back set is the control thread's alone, it is filled then swapped into the middle for the audio thread to take.
+		//the set that comes back is either one the audio thread has let go of or an untaken one that is now stale
+		write_set(m_sets[m_back].get());
+		m_back = m_middle.exchange(static_cast<uint8_t>(m_back | s_fresh), std::memory_order_acq_rel) & ~s_fresh;
+	}
+
+	void biquad_bank::take_published() noexcept
+	{
+		if (m_middle.load(std::memory_order_relaxed) & s_fresh)
+			m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & ~s_fresh;
+	}
+
+	void biquad_bank::reset() noexcept
+	{
+		memset(m_state.get(), 0, m_group_count * m_section_count * state_stride * sizeof(float));
+	}
+
+	void biquad_bank::process(std::span<const sample* const> inputs, std::span<sample* const> outputs, size_t count) noexcept
+	{
+		take_published();
+		const float* coefficients = m_sets[m_front].get();
+
+		for (size_t offset = 0; offset < count; offset += chunk) {
+			size_t n = std::min(chunk, count - offset);
+
+			for (size_t group = 0; group < m_group_count; group += batch) {
+				size_t groups = std::min(batch, m_group_count - group);
+
+				//the whole batch is read before any of it is written, so a filter can filter its input in place
+				for (size_t b = 0; b < groups; b++) {
+					const sample* src[lanes];
+					for (size_t l = 0; l < lanes; l++) {
+						size_t f = (group + b) * lanes + l;
+						src[l] = f < m_filter_count ? inputs[f] + offset : m_silence.get();
+					}
+					to_lanes(src, m_work.get() + b * chunk * lanes, n);
+				}
+
+				const float* c = coefficients + group * m_section_count * coefficient_stride;
+				float* s = m_state.get() + group * m_section_count * state_stride;
+				switch (groups) {
+				case 4: run_sections<4>(m_work.get(), c, s, m_section_count, n); break;
+				case 3: run_sections<3>(m_work.get(), c, s, m_section_count, n); break;
+				case 2: run_sections<2>(m_work.get(), c, s, m_section_count, n); break;
+				default: run_sections<1>(m_work.get(), c, s, m_section_count, n); break;
+				}
+
+				for (size_t b = 0; b < groups; b++) {
+					sample* dst[lanes];
+					for (size_t l = 0; l < lanes; l++) {
+						size_t f = (group + b) * lanes + l;
+						dst[l] = f < m_filter_count ? outputs[f] + offset : m_discard.get();
+					}
+					from_lanes(m_work.get() + b * chunk * lanes, dst, n);
+				}
+			}
+		}
+	}
+
+};
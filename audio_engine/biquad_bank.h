@@ -0,0 +1,107 @@
+#ifndef BIQUAD_BANK_H
+#define BIQUAD_BANK_H
+
+#include "audio_types.h"
+
+#include <span>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// the coefficients of one biquad section normalised to a0 = 1, the default is a pass through
+	///
+	///   y[n] = b0 x[n] + b1 x[n - 1] + b2 x[n - 2] - a1 y[n - 1] - a2 y[n - 2]
+	///
+	/// the designs are the RBJ audio EQ cookbook ones, worked out in double and rounded once. They call cos and sin, so they belong
+	/// on the control thread, the audio thread only ever sees the five floats
+	/// </summary>
+	struct biquad_coefficients {
+		float b0 = 1.f;
+		float b1 = 0.f;
+		float b2 = 0.f;
+		float a1 = 0.f;
+		float a2 = 0.f;
+
+		//frequency in Hz, must be in (0, rate / 2), q must be greater than 0, gain_db is the boost (or cut) of the peak and shelves
+		static biquad_coefficients lowpass(double frequency, double q, uint32_t rate = sample_rate);
+		static biquad_coefficients highpass(double frequency, double q, uint32_t rate = sample_rate);
+		static biquad_coefficients bandpass(double frequency, double q, uint32_t rate = sample_rate); //0 dB at the centre
+		static biquad_coefficients notch(double frequency, double q, uint32_t rate = sample_rate);
+		static biquad_coefficients allpass(double frequency, double q, uint32_t rate = sample_rate);
+		static biquad_coefficients peaking(double frequency, double q, double gain_db, uint32_t rate = sample_rate);
+		static biquad_coefficients low_shelf(double frequency, double q, double gain_db, uint32_t rate = sample_rate);
+		static biquad_coefficients high_shelf(double frequency, double q, double gain_db, uint32_t rate = sample_rate);
+	};
+
+	/// <summary>
+	/// filter_count independent filters, each a cascade of section_count biquads in transposed direct form II
+	///
+	/// one filter alone is bound by its recursion, every sample waits on the last one's state through two dependent FMAs. The bank
+	/// runs 8 filters in the lanes of an AVX register instead, and keeps about 4 recursions in flight: up to 4 lane groups side by
+	/// side, or with fewer groups the sections of each skewed a sample apart so consecutive sections overlap. Each chunk of input
+	/// is transposed into lane order once, goes through every section of the cascade while it sits in L1, and is transposed back.
+	/// A bank of fewer than 8 filters leaves lanes empty, it is built for many filters (channels, EQ bands, crossover outputs)
+	///
+	/// the coefficients are triple buffered: the control thread stages sections with set_section and publishes them all at once,
+	/// the audio thread picks the latest published set up at the start of its next process call. Neither side waits on or
+	/// allocates for the other, and the filter state is kept apart from the coefficients so a new set carries on from it.
+	/// set_section and publish are for one control thread, process for one audio thread at a time
+	/// </summary>
+	class biquad_bank {
+	private:
+		size_t m_filter_count;
+		size_t m_section_count;
+		size_t m_group_count; //lane groups of 8 filters, the last one padded with pass through filters
+
+		std::vector<biquad_coefficients> m_design; //the control thread's staged sections, filter by filter
+		//three sets of coefficients in lane order: b0, b1, b2, a1, a2 of 8 filters per section, the sections of a group together
+		std::unique_ptr<float[]> m_sets[3];
+		uint8_t m_front; //the set the audio thread runs
+		uint8_t m_back;  //the set the control thread fills
+		std::atomic<uint8_t> m_middle; //the set in between, with s_fresh while it holds a set the audio thread hasn't taken
+
+		std::unique_ptr<float[]> m_state;   //s1 and s2 of 8 filters per section, laid out like the coefficients
+		std::unique_ptr<float[]> m_work;    //a chunk of a few groups' samples in lane order
+		std::unique_ptr<float[]> m_silence; //a chunk of zeros read by the padding lanes
+		std::unique_ptr<float[]> m_discard; //a chunk the padding lanes write
+
+		static constexpr uint8_t s_fresh = 4;
+
+		void write_set(float* set) const noexcept;
+		void take_published() noexcept;
+
+	public:
+		biquad_bank(size_t filter_count, size_t section_count);
+
+		size_t filter_count() const noexcept {
+			return m_filter_count;
+		};
+
+		size_t section_count() const noexcept {
+			return m_section_count;
+		};
+
+		//stages one section of one filter, heard once published
+		void set_section(size_t filter, size_t section, const biquad_coefficients& coefficients);
+
+		//hands every staged section to the audio thread as one set, sections set together change together
+		void publish() noexcept;
+
+		//silences every filter, the coefficients are kept
+		void reset() noexcept;
+
+		/// <summary>
+		/// filters count samples of each filter's input into its output
+		/// </summary>
+		/// <param name="inputs">filter_count inputs, several filters can read the same one</param>
+		/// <param name="outputs">filter_count outputs, an output may be its own filter's input but no other filter's</param>
+		void process(std::span<const sample* const> inputs, std::span<sample* const> outputs, size_t count) noexcept;
+	};
+
+};
+
+#endif
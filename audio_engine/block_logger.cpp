@@ -0,0 +1,219 @@
+#include "block_logger.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <charconv>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace audio_engine {
+
+	namespace {
+		//the same text as ostream << float with the default precision (printf %g), without the locale or the stream
+		void append_sample(std::string& text, float value) {
+			char buf[32];
+			auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::general, 6);
+			text.append(buf, result.ptr);
+		}
+
+		void append_integer(std::string& text, uint64_t value) {
+			char buf[24];
+			auto result = std::to_chars(buf, buf + sizeof(buf), value);
+			text.append(buf, result.ptr);
+		}
+	}
+
+	block_summary summarize_block(uint64_t block_index, const sample_block& block, uint16_t channel) noexcept
+	{
+		sample min = std::numeric_limits<sample>::infinity();
+		sample max = -std::numeric_limits<sample>::infinity();
+		float sum_squares = 0.f;
+		uint32_t nan_count = 0;
+
+		for (size_t i = 0; i < sample_block_size; i++) {
+			sample x = block[i];
+			bool nan = std::isnan(x);
+			nan_count += nan;
+			sample v = nan ? 0.f : x;
+			min = nan ? min : std::min(min, x);
+			max = nan ? max : std::max(max, x);
+			sum_squares += v * v;
+		}
+
+		uint32_t counted = static_cast<uint32_t>(sample_block_size) - nan_count;
+		float rms = counted ? std::sqrt(sum_squares / counted) : std::numeric_limits<float>::quiet_NaN();
+		if (counted == 0)
+			min = max = std::numeric_limits<sample>::quiet_NaN();
+
+		return block_summary{ block_index, channel, min, max, rms, nan_count };
+	}
+
+	block_logger::block_logger(block_log_mode mode, uint32_t decimation, size_t staging_records, block_log_overflow overflow) :
+		m_mode(mode),
+		m_decimation(decimation),
+		m_overflow(overflow),
+		m_blocks(),
+		m_summaries(),
+		m_wake(),
+		m_closing(false),
+		m_dropped_records(0),
+		m_thread(),
+		m_out(nullptr),
+		m_channels(1),
+		m_text()
+	{
+		if (decimation == 0)
+			throw std::domain_error("block_logger::block_logger(mode, decimation, staging_records, overflow) : decimation must be at least 1");
+
+		if (mode == block_log_mode::samples)
+			m_blocks = std::make_unique<bounded_mpmc_queue<staged_block>>(staging_records);
+		else
+			m_summaries = std::make_unique<bounded_mpmc_queue<block_summary>>(staging_records);
+	}
+
+	block_logger::~block_logger()
+	{
+		close();
+	}
+
+	void block_logger::open(std::ostream& out, uint16_t channels)
+	{
+		close();
+
+		m_out = &out;
+		m_channels = channels;
+		m_closing.store(false);
+		m_dropped_records.store(0);
+		m_thread = std::jthread([this] { logger_loop(); });
+	}
+
+	bool block_logger::submit(uint64_t block_index, const sample_block& block, uint16_t channel) noexcept
+	{
+		if (block_index % m_decimation != 0)
+			return true;
+
+		//a summary is worked out once, however many times a waiting submit tries to stage it
+		block_summary summary{};
+		if (m_mode == block_log_mode::summary)
+			summary = summarize_block(block_index, block, channel);
+
+		while (!try_stage(block_index, block, summary)) {
+			//with no logger thread running nothing would ever make room
+			if (m_overflow == block_log_overflow::drop || m_out == nullptr) {
+				m_dropped_records.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			//the logger thread may be asleep with a full queue it hasn't been told about yet
+			m_wake.notify_one();
+			std::this_thread::yield();
+		}
+
+		m_wake.notify_one();
+		return true;
+	}
+
+	bool block_logger::try_stage(uint64_t block_index, const sample_block& block, const block_summary& summary) noexcept
+	{
+		if (m_mode == block_log_mode::samples) {
+			return m_blocks->try_push_with([&](staged_block& slot) {
+				slot.index = block_index;
+				memcpy(slot.samples, block, sizeof(sample_block));
+			});
+		}
+		return m_summaries->try_push(summary);
+	}
+
+	void block_logger::close() noexcept
+	{
+		if (!m_out)
+			return;
+
+		m_closing.store(true);
+		m_wake.notify_all();
+		if (m_thread.joinable())
+			m_thread.join();
+
+		m_out = nullptr;
+	}
+
+	bool block_logger::staging_empty() const noexcept
+	{
+		return m_mode == block_log_mode::samples ? m_blocks->empty() : m_summaries->empty();
+	}
+
+	size_t block_logger::drain_batch()
+	{
+		size_t count = 0;
+		if (m_mode == block_log_mode::samples) {
+			while (count < s_batch_records && m_blocks->try_pop_with([&](staged_block& slot) { format_block(slot.samples); }))
+				count++;
+		}
+		else {
+			while (count < s_batch_records && m_summaries->try_pop_with([&](block_summary& slot) { format_summary(slot); }))
+				count++;
+		}
+		return count;
+	}
+
+	void block_logger::logger_loop()
+	{
+		for (;;) {
+			m_text.clear();
+			if (drain_batch() != 0) {
+				m_out->write(m_text.data(), m_text.size());
+				continue;
+			}
+
+			if (m_closing.load()) {
+				//a push that claimed its slot but hasn't published it yet shows up as not empty, wait for it
+				if (staging_empty())
+					break;
+				std::this_thread::yield();
+				continue;
+			}
+
+			//caught up, push what has been written out before sleeping
+			m_out->flush();
+
+			auto key = m_wake.prepare_wait();
+			if (!staging_empty() || m_closing.load())
+				m_wake.cancel_wait();
+			else
+				m_wake.wait(key);
+		}
+
+		m_out->flush();
+	}
+
+	void block_logger::format_block(const sample_block& block)
+	{
+		//NaN marks samples that were never written, the old logger skipped them too
+		for (size_t i = 0; i < sample_block_size; i++) {
+			if (std::isnan(block[i]))
+				continue;
+			append_sample(m_text, block[i]);
+			m_text.push_back('\n');
+		}
+	}
+
+	void block_logger::format_summary(const block_summary& summary)
+	{
+		m_text.append("block ");
+		append_integer(m_text, summary.index);
+		if (m_channels > 1) {
+			m_text.append(" channel ");
+			append_integer(m_text, summary.channel);
+		}
+		m_text.append(" min ");
+		append_sample(m_text, summary.min);
+		m_text.append(" max ");
+		append_sample(m_text, summary.max);
+		m_text.append(" rms ");
+		append_sample(m_text, summary.rms);
+		m_text.append(" nan ");
+		append_integer(m_text, summary.nan_count);
+		m_text.push_back('\n');
+	}
+
+};
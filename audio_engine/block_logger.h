@@ -0,0 +1,119 @@
+#ifndef BLOCK_LOGGER_H
+#define BLOCK_LOGGER_H
+
+#include "audio_types.h"
+#include "bounded_queue.h"
+#include "event_count.h"
+
+#include <ostream>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+namespace audio_engine {
+
+	enum class block_log_mode : uint8_t {
+		samples, //every sample of a logged block, one per line
+		summary  //one line of min/max/RMS/NaN count per logged block
+	};
+
+	//what submit does when the staging queue is full
+	enum class block_log_overflow : uint8_t {
+		drop, //drops the record and counts it, the caller is never held up
+		wait  //waits for the logger thread to make room, nothing is lost and a slow stream holds up the caller
+	};
+
+	struct block_summary {
+		uint64_t index;
+		uint16_t channel;
+		sample min; //NaN samples are left out of min, max and rms
+		sample max;
+		float rms;
+		uint32_t nan_count;
+	};
+
+	//a single pass over the block, cheap enough for an output worker
+	block_summary summarize_block(uint64_t block_index, const sample_block& block, uint16_t channel = 0) noexcept;
+
+	/// <summary>
+	/// records blocks (or per block summaries) on the pipeline threads and formats them to a stream on a background thread
+	///
+	/// submit only copies the record into a lock-free staging queue, number formatting and the stream write happen on the
+	/// logger's own thread at whatever pace the stream allows. By default a full queue drops the record and counts it rather than
+	/// stalling the caller, block_log_overflow::wait keeps every record instead for when the log matters more than the caller's
+	/// pace. Only one block in every decimation is recorded, chosen by block index so it doesn't depend on which worker
+	/// ran the block.
+	///
+	/// records are formatted in the order they were submitted, a stage that wants its log in stream order should run single threaded
+	/// </summary>
+	class block_logger {
+	private:
+		struct staged_block {
+			uint64_t index;
+			sample_block samples;
+		};
+
+		static constexpr size_t s_batch_records = 64;
+
+		block_log_mode m_mode;
+		uint32_t m_decimation;
+		block_log_overflow m_overflow;
+		//only the queue for the mode is allocated, a summary is ~100x smaller than a block
+		std::unique_ptr<bounded_mpmc_queue<staged_block>> m_blocks;
+		std::unique_ptr<bounded_mpmc_queue<block_summary>> m_summaries;
+		event_count m_wake;
+		std::atomic<bool> m_closing;
+		std::atomic<uint64_t> m_dropped_records;
+		std::jthread m_thread;
+		std::ostream* m_out;
+		uint16_t m_channels;
+		std::string m_text; //formatting buffer, logger thread only
+
+		bool try_stage(uint64_t block_index, const sample_block& block, const block_summary& summary) noexcept;
+		bool staging_empty() const noexcept;
+		size_t drain_batch();
+		void logger_loop();
+		void format_block(const sample_block& block);
+		void format_summary(const block_summary& summary);
+
+	public:
+		static constexpr size_t s_default_staging_records = 1024;
+
+		/// <param name="decimation">records one block in every decimation blocks, 1 records every block</param>
+		block_logger(block_log_mode mode = block_log_mode::samples, uint32_t decimation = 1, size_t staging_records = s_default_staging_records, block_log_overflow overflow = block_log_overflow::drop);
+		~block_logger();
+
+		block_logger(const block_logger&) = delete;
+		block_logger& operator=(const block_logger&) = delete;
+
+		//starts the logger thread writing to out, the stream must outlive close()
+		//with more than one channel summary lines name the channel, sample lines of a block come out one channel after another
+		void open(std::ostream& out, uint16_t channels = 1);
+
+		/// <summary>
+		/// records one channel of the block if its index is picked by the decimation, only waits with block_log_overflow::wait
+		/// </summary>
+		/// <returns>false if the record was dropped because the staging queue was full</returns>
+		bool submit(uint64_t block_index, const sample_block& block, uint16_t channel = 0) noexcept;
+
+		//formats everything still staged, flushes the stream and stops the thread, safe to call more than once
+		void close() noexcept;
+
+		bool is_open() const noexcept {
+			return m_out != nullptr;
+		};
+
+		block_log_mode get_mode() const noexcept {
+			return m_mode;
+		};
+
+		uint64_t dropped_records() const noexcept {
+			return m_dropped_records.load(std::memory_order_relaxed);
+		};
+	};
+
+};
+
+#endif
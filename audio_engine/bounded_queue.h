@@ -0,0 +1,125 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <bit>
+#include <stdexcept>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// bounded lock-free multi producer multi consumer queue (Vyukov), used to stage work for background threads
+	///
+	/// every slot carries a sequence number that says whose turn it is, a producer claims a slot with one CAS on the enqueue
+	/// position, fills it in place and publishes it by bumping the sequence, consumers mirror that. Nothing allocates or blocks,
+	/// a full queue fails the push and the caller decides what dropping means. The payload is written in place through a callback
+	/// so a large T (e.g a whole sample_block) is copied exactly once on each side
+	/// </summary>
+	template <typename T>
+	class bounded_mpmc_queue {
+	private:
+		struct cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<cell[]> m_cells;
+		size_t m_mask;
+		alignas(64) std::atomic<size_t> m_enqueue_pos;
+		alignas(64) std::atomic<size_t> m_dequeue_pos;
+
+	public:
+		explicit bounded_mpmc_queue(size_t capacity) :
+			m_cells(),
+			m_mask(0),
+			m_enqueue_pos(0),
+			m_dequeue_pos(0)
+		{
+			if (capacity < 2)
+				throw std::domain_error("bounded_mpmc_queue::bounded_mpmc_queue(capacity) : capacity must be at least 2");
+
+			capacity = std::bit_ceil(capacity);
+			m_cells = std::make_unique<cell[]>(capacity);
+			m_mask = capacity - 1;
+			for (size_t i = 0; i < capacity; i++)
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		bounded_mpmc_queue(const bounded_mpmc_queue&) = delete;
+		bounded_mpmc_queue& operator=(const bounded_mpmc_queue&) = delete;
+
+		size_t capacity() const noexcept {
+			return m_mask + 1;
+		};
+
+		//claims a slot and calls fill(T&) on it, returns false without calling fill if the queue is full
+		template <typename F>
+		bool try_push_with(F&& fill) noexcept {
+			size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+			cell* c;
+			for (;;) {
+				c = &m_cells[pos & m_mask];
+				size_t sequence = c->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+				if (diff == 0) {
+					if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0) {
+					return false;
+				}
+				else {
+					pos = m_enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			fill(c->value);
+			c->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		};
+
+		bool try_push(const T& value) noexcept {
+			return try_push_with([&](T& slot) { slot = value; });
+		};
+
+		//takes the oldest slot and calls consume(T&) on it, returns false if the queue is empty
+		template <typename F>
+		bool try_pop_with(F&& consume) noexcept {
+			size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+			cell* c;
+			for (;;) {
+				c = &m_cells[pos & m_mask];
+				size_t sequence = c->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+				if (diff == 0) {
+					if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0) {
+					return false;
+				}
+				else {
+					pos = m_dequeue_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			consume(c->value);
+			c->sequence.store(pos + m_mask + 1, std::memory_order_release);
+			return true;
+		};
+
+		bool try_pop(T& out) noexcept {
+			return try_pop_with([&](T& slot) { out = slot; });
+		};
+
+		//a racy hint, exact only when no other thread is pushing or popping
+		bool empty() const noexcept {
+			return m_enqueue_pos.load(std::memory_order_acquire) == m_dequeue_pos.load(std::memory_order_acquire);
+		};
+	};
+
+};
+
+#endif
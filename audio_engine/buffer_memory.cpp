@@ -0,0 +1,181 @@
+#include "buffer_memory.h"
+
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cerrno>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace audio_engine {
+
+	namespace {
+
+		constexpr size_t s_huge_page_size = 2 * 1024 * 1024;
+
+		size_t round_up(size_t bytes, size_t multiple) noexcept {
+			return (bytes + multiple - 1) / multiple * multiple;
+		}
+
+#if !defined(_WIN32)
+		//MPOL_PREFERRED from numaif.h, spelled out so the engine doesn't need libnuma's headers for one syscall
+		constexpr int s_mpol_preferred = 1;
+
+		//a huge page mapping has to be unmapped in whole huge pages, and the fallback mapping is the same length so free_buffer_memory
+		//doesn't need to know which one it got
+		size_t mapping_size(size_t bytes, const buffer_memory_policy& policy) noexcept {
+			return round_up(bytes, policy.huge_pages == huge_page_mode::none ? size_t(sysconf(_SC_PAGESIZE)) : s_huge_page_size);
+		}
+#endif
+
+		//writes a byte of every page so it is mapped now, by this thread, rather than on the first write from a pool worker
+		void touch_pages(void* memory, size_t bytes, size_t page_size) noexcept {
+			volatile std::byte* pages = static_cast<std::byte*>(memory);
+			for (size_t offset = 0; offset < bytes; offset += page_size)
+				pages[offset] = std::byte(0);
+		}
+
+	}
+
+#if defined(_WIN32)
+
+	void* allocate_buffer_memory(size_t bytes, const buffer_memory_policy& policy)
+	{
+		if (bytes == 0)
+			throw std::domain_error("allocate_buffer_memory(bytes, policy) : bytes must be greater than 0");
+
+		void* memory = nullptr;
+
+		//large pages need SeLockMemoryPrivilege and are always locked, without the privilege we quietly get regular pages
+		size_t large_page = GetLargePageMinimum();
+		if (policy.huge_pages == huge_page_mode::reserved && large_page != 0) {
+			DWORD flags = MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES;
+			size_t size = round_up(bytes, large_page);
+			memory = policy.numa_node >= 0
+				? VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, flags, PAGE_READWRITE, static_cast<DWORD>(policy.numa_node))
+				: VirtualAlloc(nullptr, size, flags, PAGE_READWRITE);
+		}
+
+		if (memory == nullptr) {
+			memory = policy.numa_node >= 0
+				? VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, static_cast<DWORD>(policy.numa_node))
+				: VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+
+		if (memory == nullptr)
+			throw std::runtime_error("allocate_buffer_memory(bytes, policy) : failed to allocate " + std::to_string(bytes) + " bytes (error " + std::to_string(GetLastError()) + ")");
+
+		if (policy.lock && !VirtualLock(memory, bytes)) {
+			DWORD error = GetLastError();
+			VirtualFree(memory, 0, MEM_RELEASE);
+			throw std::runtime_error("allocate_buffer_memory(bytes, policy) : failed to lock " + std::to_string(bytes) + " bytes, the working set may need raising (error " + std::to_string(error) + ")");
+		}
+
+		if (policy.prefault || policy.lock) {
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			touch_pages(memory, bytes, info.dwPageSize);
+		}
+
+		return memory;
+	}
+
+	void free_buffer_memory(void* memory, size_t bytes, const buffer_memory_policy& policy) noexcept
+	{
+		if (memory != nullptr)
+			VirtualFree(memory, 0, MEM_RELEASE);
+	}
+
+	int current_numa_node() noexcept
+	{
+		PROCESSOR_NUMBER processor;
+		GetCurrentProcessorNumberEx(&processor);
+		USHORT node = 0;
+		if (!GetNumaProcessorNodeEx(&processor, &node))
+			return 0;
+		return node;
+	}
+
+#else
+
+	void* allocate_buffer_memory(size_t bytes, const buffer_memory_policy& policy)
+	{
+		if (bytes == 0)
+			throw std::domain_error("allocate_buffer_memory(bytes, policy) : bytes must be greater than 0");
+
+		size_t size = mapping_size(bytes, policy);
+		void* memory = MAP_FAILED;
+
+		if (policy.huge_pages == huge_page_mode::reserved)
+			memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if (memory == MAP_FAILED)
+			memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (memory == MAP_FAILED)
+			throw std::runtime_error("allocate_buffer_memory(bytes, policy) : failed to map " + std::to_string(size) + " bytes (" + std::strerror(errno) + ")");
+
+		//a reserved huge page mapping ignores the advice, a regular one (or the fallback) gets transparent huge pages where it can
+		if (policy.huge_pages != huge_page_mode::none)
+			::madvise(memory, size, MADV_HUGEPAGE);
+
+		//placement has to be set before anything touches the pages
+		if (policy.numa_node >= 0) {
+			constexpr size_t word_bits = 8 * sizeof(unsigned long);
+			constexpr size_t mask_bits = 1024;
+			unsigned long mask[mask_bits / word_bits] = {};
+			size_t node = static_cast<size_t>(policy.numa_node);
+
+			bool placed = false;
+			errno = EINVAL;
+			if (node < mask_bits) {
+				mask[node / word_bits] = 1ul << (node % word_bits);
+				placed = ::syscall(SYS_mbind, memory, size, s_mpol_preferred, mask, mask_bits, 0) == 0;
+			}
+
+			if (!placed) {
+				int error = errno;
+				::munmap(memory, size);
+				throw std::runtime_error("allocate_buffer_memory(bytes, policy) : failed to place the memory on NUMA node " + std::to_string(policy.numa_node) + " (" + std::strerror(error) + ")");
+			}
+		}
+
+		if (policy.lock && ::mlock(memory, size) != 0) {
+			int error = errno;
+			::munmap(memory, size);
+			throw std::runtime_error("allocate_buffer_memory(bytes, policy) : failed to lock " + std::to_string(size) + " bytes, RLIMIT_MEMLOCK may need raising (" + std::strerror(error) + ")");
+		}
+
+		//mlock has already faulted everything in
+		if (policy.prefault && !policy.lock)
+			touch_pages(memory, size, size_t(sysconf(_SC_PAGESIZE)));
+
+		return memory;
+	}
+
+	void free_buffer_memory(void* memory, size_t bytes, const buffer_memory_policy& policy) noexcept
+	{
+		if (memory != nullptr)
+			::munmap(memory, mapping_size(bytes, policy));
+	}
+
+	int current_numa_node() noexcept
+	{
+		unsigned cpu = 0;
+		unsigned node = 0;
+		if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+			return 0;
+		return static_cast<int>(node);
+	}
+
+#endif
+
+};
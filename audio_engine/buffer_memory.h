@@ -0,0 +1,99 @@
+#ifndef BUFFER_MEMORY_H
+#define BUFFER_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace audio_engine {
+
+	//every allocation for buffer data starts on a cache line, so states and blocks laid out in whole cache lines stay aligned for AVX
+	constexpr size_t buffer_alignment = 64;
+
+	enum class huge_page_mode : uint8_t {
+		none,        //regular pages
+		transparent, //ask for transparent huge pages (madvise), the kernel promotes the range when it can, no-op on Windows
+		reserved     //reserved huge pages (MAP_HUGETLB, MEM_LARGE_PAGES on Windows), falls back to transparent when none are available
+	};
+
+	/// <summary>
+	/// where and how buffer memory is backed, fixed when the buffer is constructed
+	///
+	/// the defaults touch every page on the constructing thread so nothing faults once the pipeline runs. A pipeline whose workers
+	/// are spread over NUMA nodes either binds each buffer to a node, or turns prefault off so every page is first touched (and
+	/// placed) by the worker that first writes it
+	/// </summary>
+	struct buffer_memory_policy {
+		huge_page_mode huge_pages = huge_page_mode::none;
+		//lock the pages into RAM (mlock / VirtualLock) so a real time thread never takes a page fault or waits on swap, implies prefault
+		bool lock = false;
+		//touch every page when allocating, otherwise pages are mapped on the first write to them
+		bool prefault = true;
+		//the NUMA node the pages are placed on, -1 leaves placement to the first thread to touch them
+		int numa_node = -1;
+
+		bool operator==(const buffer_memory_policy&) const = default;
+	};
+
+	/// <summary>
+	/// maps zeroed, buffer_alignment aligned memory straight from the OS following the policy, for large long lived allocations only
+	/// throws std::runtime_error if the memory can't be mapped, locked or bound to the node
+	/// </summary>
+	void* allocate_buffer_memory(size_t bytes, const buffer_memory_policy& policy);
+
+	//returns memory from allocate_buffer_memory, bytes and policy must be the ones it was allocated with
+	void free_buffer_memory(void* memory, size_t bytes, const buffer_memory_policy& policy) noexcept;
+
+	//the NUMA node the calling thread is running on, 0 where it can't be told
+	int current_numa_node() noexcept;
+
+	/// <summary>
+	/// the ring buffers' allocator, a standard allocator over allocate_buffer_memory that carries its policy
+	///
+	/// ring buffers take it at construction and keep it for the lifetime of their storage, any allocator can be plugged in through
+	/// ring_buffer_allocator_t as long as it returns buffer_alignment aligned memory
+	/// </summary>
+	template <typename T>
+	class buffer_allocator {
+	private:
+		buffer_memory_policy m_policy;
+
+	public:
+		using value_type = T;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		//memory comes straight from the OS, zero filled, so a new buffer doesn't need clearing
+		static constexpr bool s_zeroed = true;
+
+		buffer_allocator() noexcept = default;
+		buffer_allocator(const buffer_memory_policy& policy) noexcept : m_policy(policy) {};
+
+		template <typename U>
+		buffer_allocator(const buffer_allocator<U>& other) noexcept : m_policy(other.policy()) {};
+
+		T* allocate(size_t count) {
+			return static_cast<T*>(allocate_buffer_memory(count * sizeof(T), m_policy));
+		};
+
+		void deallocate(T* memory, size_t count) noexcept {
+			free_buffer_memory(memory, count * sizeof(T), m_policy);
+		};
+
+		const buffer_memory_policy& policy() const noexcept {
+			return m_policy;
+		};
+
+		template <typename U>
+		bool operator==(const buffer_allocator<U>& other) const noexcept {
+			return m_policy == other.policy();
+		};
+	};
+
+	//true for allocators that hand out zero filled memory
+	template <typename A>
+	constexpr bool allocates_zeroed = requires { requires A::s_zeroed; };
+
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "delay_line.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <bit>
+
+namespace audio_engine {
+
+	delay_line::delay_line(float max_delay_samples) :
+		m_line(),
+		m_capacity(0),
+		m_mask(0),
+		m_write_pos(0),
+		m_max_delay_samples(max_delay_samples),
+		m_dry(0.f),
+		m_taps(),
+		m_chunk(s_max_chunk)
+	{
+		if (!(max_delay_samples >= 1.f))
+			throw std::domain_error("delay_line::delay_line(max_delay_samples) : max_delay_samples must be at least 1");
+
+		//the deepest read is the sample before the longest delay, plus room for the chunk being written
+		m_capacity = std::bit_ceil(static_cast<size_t>(std::ceil(max_delay_samples)) + 2 + s_max_chunk);
+		m_mask = m_capacity - 1;
+		m_line = std::make_unique<sample[]>(m_capacity + s_max_chunk + 1);
+	}
+
+	delay_line::delay_line(const delay_line& other) :
+		m_line(std::make_unique<sample[]>(other.m_capacity + s_max_chunk + 1)),
+		m_capacity(other.m_capacity),
+		m_mask(other.m_mask),
+		m_write_pos(other.m_write_pos),
+		m_max_delay_samples(other.m_max_delay_samples),
+		m_dry(other.m_dry),
+		m_taps(other.m_taps),
+		m_chunk(other.m_chunk)
+	{
+		memcpy(m_line.get(), other.m_line.get(), (m_capacity + s_max_chunk + 1) * sizeof(sample));
+	}
+
+	delay_line& delay_line::operator=(const delay_line& other)
+	{
+		if (this != &other)
+			*this = delay_line(other);
+		return *this;
+	}
+
+	void delay_line::add_tap(float delay_samples, float gain, float feedback)
+	{
+		if (!(delay_samples >= 1.f && delay_samples <= m_max_delay_samples))
+			throw std::domain_error("delay_line::add_tap(delay_samples, gain, feedback) : delay_samples must be in [1, max_delay_samples]");
+
+		m_taps.push_back(tap{ delay_samples, gain, feedback });
+		update_chunk();
+	}
+
+	void delay_line::update_chunk() noexcept
+	{
+		m_chunk = s_max_chunk;
+		for (auto& t : m_taps)
+			m_chunk = std::min(m_chunk, static_cast<size_t>(t.delay_samples));
+	}
+
+	void delay_line::reset() noexcept
+	{
+		memset(m_line.get(), 0, (m_capacity + s_max_chunk + 1) * sizeof(sample));
+		m_write_pos = 0;
+	}
+
+	void delay_line::write(const sample* samples, size_t count) noexcept
+	{
+		size_t pos = m_write_pos & m_mask;
+		size_t first = std::min(count, m_capacity - pos);
+		memcpy(m_line.get() + pos, samples, first * sizeof(sample));
+		memcpy(m_line.get(), samples + first, (count - first) * sizeof(sample));
+
+		//keep the mirror of the start of the line past its end up to date, reads run straight off the end into it
+		constexpr size_t mirrored = s_max_chunk + 1;
+		if (pos < mirrored)
+			memcpy(m_line.get() + m_capacity + pos, m_line.get() + pos, std::min(first, mirrored - pos) * sizeof(sample));
+		if (count > first)
+			memcpy(m_line.get() + m_capacity, m_line.get(), std::min(count - first, mirrored) * sizeof(sample));
+
+		m_write_pos += count;
+	}
+
+	void delay_line::process(const sample* in, sample* out, size_t count) noexcept
+	{
+		alignas(32) sample line_in[s_max_chunk];
+		alignas(32) sample wet[s_max_chunk];
+
+		for (size_t done = 0; done < count;) {
+			size_t n = std::min(m_chunk, count - done);
+			const sample* x = in + done;
+
+			for (size_t i = 0; i < n; i++) {
+				line_in[i] = x[i];
+				wet[i] = m_dry * x[i];
+			}
+
+			for (auto& t : m_taps) {
+				size_t whole = static_cast<size_t>(t.delay_samples);
+				float frac = t.delay_samples - static_cast<float>(whole);
+				float gain = t.gain;
+				float feedback = t.feedback;
+
+				//older[i] is line[t - whole - 1] and older[i + 1] is line[t - whole] for the i'th sample of the chunk,
+				//all written before this chunk since whole >= n
+				const sample* older = m_line.get() + ((m_write_pos - whole - 1) & m_mask);
+				for (size_t i = 0; i < n; i++) {
+					sample delayed = older[i + 1] + frac * (older[i] - older[i + 1]);
+					wet[i] += gain * delayed;
+					line_in[i] += feedback * delayed;
+				}
+			}
+
+			write(line_in, n);
+			memcpy(out + done, wet, n * sizeof(sample));
+			done += n;
+		}
+	}
+
+};
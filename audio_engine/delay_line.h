@@ -0,0 +1,89 @@
+#ifndef DELAY_LINE_H
+#define DELAY_LINE_H
+
+#include "audio_types.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// a circular delay line with any number of fractional delay taps, each with its own output gain and feedback into the line
+	///
+	///   y[t] = dry * x[t] + sum(tap.gain * d_tap[t])
+	///   line[t] = x[t] + sum(tap.feedback * d_tap[t])
+	///   d_tap[t] = line[t - tap.delay], linearly interpolated between the two neighbouring samples for a fractional delay
+	///
+	/// the line is processed in chunks no longer than the shortest tap delay, so nothing a chunk reads is written by the same chunk
+	/// and every loop is a straight pass over contiguous samples. The first chunk-length samples of the line are mirrored past its
+	/// end so a read never has to wrap mid-chunk, the per-block cost is the same for any delay and the memory is only touched at
+	/// the read and write positions
+	/// </summary>
+	class delay_line {
+	public:
+		struct tap {
+			float delay_samples; //>= 1 and at most the line's max delay
+			float gain;
+			float feedback;
+		};
+
+	private:
+		//the longest run processed without re-reading what it wrote, also bounds the stack scratch
+		static constexpr size_t s_max_chunk = 256;
+
+		std::unique_ptr<sample[]> m_line; //m_capacity samples plus s_max_chunk + 1 mirrored
+		size_t m_capacity;
+		size_t m_mask;
+		size_t m_write_pos;
+		float m_max_delay_samples;
+		float m_dry;
+		std::vector<tap> m_taps;
+		size_t m_chunk; //min(s_max_chunk, floor of the shortest tap delay)
+
+		void update_chunk() noexcept;
+		void write(const sample* samples, size_t count) noexcept;
+
+	public:
+		/// <param name="max_delay_samples">the longest tap delay the line will hold, e.g several seconds worth of samples</param>
+		explicit delay_line(float max_delay_samples);
+
+		delay_line(const delay_line& other);
+		delay_line& operator=(const delay_line& other);
+		delay_line(delay_line&&) noexcept = default;
+		delay_line& operator=(delay_line&&) noexcept = default;
+
+		void add_tap(float delay_samples, float gain = 1.f, float feedback = 0.f);
+		void set_dry(float gain) noexcept {
+			m_dry = gain;
+		};
+
+		const std::vector<tap>& get_taps() const noexcept {
+			return m_taps;
+		};
+
+		float get_max_delay_samples() const noexcept {
+			return m_max_delay_samples;
+		};
+
+		//silences the line, the only full pass over its memory
+		void reset() noexcept;
+
+		/// <summary>
+		/// runs count consecutive samples through the line, blocks must be passed in stream order
+		/// </summary>
+		/// <param name="in">the input samples, may be the same as out</param>
+		/// <param name="out">the output samples</param>
+		void process(const sample* in, sample* out, size_t count) noexcept;
+	};
+
+	//a duration as a (fractional) number of samples at the sample rate, the engine's by default
+	template <uint32_t SampleRate = sample_rate, typename Rep, typename Period>
+	constexpr float to_delay_samples(std::chrono::duration<Rep, Period> delay) {
+		return std::chrono::duration_cast<std::chrono::duration<float>>(delay).count() * SampleRate;
+	}
+
+};
+
+#endif
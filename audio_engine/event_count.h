@@ -0,0 +1,81 @@
+#ifndef EVENT_COUNT_H
+#define EVENT_COUNT_H
+
+#include <atomic>
+#include <cstdint>
+#include <immintrin.h>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// eventcount for parking threads until some other thread publishes work, built on std::atomic::wait (futex / WaitOnAddress)
+	///
+	/// waiter:   key = prepare_wait(); if (work is available) cancel_wait(); else wait(key);
+	/// notifier: make the work visible; notify_all();
+	///
+	/// registering as a waiter before the final check for work means a notify that lands between the check and the wait
+	/// bumps the epoch and the wait returns immediately instead of sleeping through it.
+	/// notify_all only pays for the syscall when somebody is actually parked.
+	/// </summary>
+	class event_count {
+	private:
+		std::atomic<uint32_t> m_epoch;
+		std::atomic<uint32_t> m_waiters;
+
+	public:
+		event_count() : m_epoch(0), m_waiters(0) {}
+
+		event_count(const event_count&) = delete;
+		event_count& operator=(const event_count&) = delete;
+
+		uint32_t prepare_wait() noexcept {
+			m_waiters.fetch_add(1, std::memory_order_seq_cst);
+			return m_epoch.load(std::memory_order_seq_cst);
+		}
+
+		void cancel_wait() noexcept {
+			m_waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		void wait(uint32_t key) noexcept {
+			m_epoch.wait(key, std::memory_order_seq_cst);
+			m_waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		//wakes one parked waiter, for work any single waiter can take
+		void notify_one() noexcept {
+			m_epoch.fetch_add(1, std::memory_order_seq_cst);
+			if (m_waiters.load(std::memory_order_seq_cst) != 0)
+				m_epoch.notify_one();
+		}
+
+		void notify_all() noexcept {
+			m_epoch.fetch_add(1, std::memory_order_seq_cst);
+			if (m_waiters.load(std::memory_order_seq_cst) != 0)
+				m_epoch.notify_all();
+		}
+	};
+
+	/// <summary>
+	/// bounded spin-then-park policy, a thread that found no work spins (with a pause hint) for spin_count attempts before it parks
+	/// spinning keeps the wakeup latency to a few hundred cycles while work is arriving steadily, parking stops idle stages burning a core
+	/// </summary>
+	struct park_policy {
+		static constexpr uint32_t s_default_spin_count = 1024;
+
+		uint32_t spin_count = s_default_spin_count;
+
+		//returns true while the caller should keep spinning, false once it should park
+		bool spin(uint32_t& idle_iterations) const noexcept {
+			if (idle_iterations >= spin_count)
+				return false;
+
+			idle_iterations++;
+			_mm_pause();
+			return true;
+		}
+	};
+
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef FUSED_STAGE_H
+#define FUSED_STAGE_H
+
+#include "audio_types.h"
+#include "audio_pipeline.h"
+
+#include <tuple>
+#include <span>
+#include <concepts>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace audio_engine {
+
+	//a stateless kernel applied to one sample at a time, e.g [](sample s) { return s * 0.5f; }
+	template <typename K>
+	concept sample_kernel = std::is_nothrow_copy_constructible_v<K> && requires(const K k, sample s) {
+		{ k(s) } -> std::convertible_to<sample>;
+	};
+
+	//a stateless kernel applied in place to a span of samples, for work that doesn't decompose per sample (or is hand vectorised)
+	template <typename K>
+	concept span_kernel = std::is_nothrow_copy_constructible_v<K> && !sample_kernel<K> && requires(const K k, std::span<sample> samples) {
+		k(samples);
+	};
+
+	template <typename K>
+	concept fused_kernel = sample_kernel<K> || span_kernel<K>;
+
+	struct gain_kernel {
+		float multiplier;
+
+		sample operator()(sample s) const noexcept {
+			return s * multiplier;
+		};
+	};
+
+	struct clip_kernel {
+		sample low;
+		sample high;
+
+		sample operator()(sample s) const noexcept {
+			//written as min/max rather than std::clamp so it lowers to minps/maxps
+			return std::min(std::max(s, low), high);
+		};
+	};
+
+	/// <summary>
+	/// a chain of stateless kernels fused into a single pipeline_stage, built at compile time
+	///
+	/// chaining the same work as separate stages costs a full read and write of every block per stage plus a claim and state publish
+	/// in between. The fused stage walks the claimed run once in chunks small enough that the input and output chunk stay in L1:
+	/// consecutive sample kernels are composed into one expression and evaluated in a single loop (which the compiler vectorises),
+	/// span kernels then run in place on the chunk while it is still hot.
+	///
+	/// the kernels must be stateless, blocks are processed in whatever order they are claimed by however many workers
+	///
+	/// fused_stage is the stage at the engine's default format, the loops are compiled for the block size so a sample kernel
+	/// chain over a single block has a constant trip count at any format
+	/// </summary>
+	template <size_t BlockSize, uint32_t SampleRate, fused_kernel... Kernels>
+	class basic_fused_stage : public basic_pipeline_stage<BlockSize, SampleRate> {
+		static_assert(sizeof...(Kernels) > 0, "fused_stage requires at least one kernel");
+
+	public:
+		using base = basic_pipeline_stage<BlockSize, SampleRate>;
+		using typename base::sample_block;
+		using typename base::audio_ring_buffer;
+		using base::sample_block_size;
+
+	private:
+		std::tuple<Kernels...> m_kernels;
+		sample_state m_exit_block_state;
+
+		//2 * 8KiB chunks (in and out) leave room in a 32KiB L1 for everything else the worker touches
+		static constexpr size_t s_chunk_samples = 2048;
+
+		template <size_t I>
+		using kernel_t = std::tuple_element_t<I, std::tuple<Kernels...>>;
+
+		//one past the last kernel of the run of sample kernels starting at I
+		template <size_t I>
+		static constexpr size_t sample_run_end() {
+			//nested so kernel_t<I> is never formed past the end of the chain
+			if constexpr (I < sizeof...(Kernels)) {
+				if constexpr (sample_kernel<kernel_t<I>>)
+					return sample_run_end<I + 1>();
+				else
+					return I;
+			}
+			else {
+				return I;
+			}
+		};
+
+		template <size_t I, size_t End>
+		__forceinline sample apply_sample_run(sample s) const noexcept {
+			if constexpr (I == End)
+				return s;
+			else
+				return apply_sample_run<I + 1, End>(static_cast<sample>(std::get<I>(m_kernels)(s)));
+		};
+
+		//applies kernels I.. to src, leaving the result in dst (src == dst once the first kernel has run)
+		template <size_t I>
+		__forceinline void apply_kernels(const sample* src, sample* dst, size_t count) const noexcept {
+			if constexpr (I == sizeof...(Kernels)) {
+				return;
+			}
+			else if constexpr (sample_kernel<kernel_t<I>>) {
+				constexpr size_t end = sample_run_end<I>();
+				for (size_t i = 0; i < count; i++)
+					dst[i] = apply_sample_run<I, end>(src[i]);
+
+				apply_kernels<end>(dst, dst, count);
+			}
+			else {
+				if (src != dst)
+					memcpy(dst, src, count * sizeof(sample));
+
+				std::get<I>(m_kernels)(std::span<sample>(dst, count));
+				apply_kernels<I + 1>(dst, dst, count);
+			}
+		};
+
+		void process_samples(const sample* in, sample* out, size_t count) const noexcept {
+			for (size_t offset = 0; offset < count; offset += s_chunk_samples)
+				apply_kernels<0>(in + offset, out + offset, std::min(s_chunk_samples, count - offset));
+		};
+
+	public:
+		/// <param name="entry_block_state">the state of the blocks the chain consumes</param>
+		/// <param name="exit_block_state">the state the processed blocks are published in</param>
+		/// <param name="thread_count">the most pool workers running the chain at once, it is stateless so any number works</param>
+		/// <param name="kernels">the kernels in the order they are applied</param>
+		basic_fused_stage(uint8_t entry_block_state, sample_state exit_block_state, uint8_t thread_count, Kernels... kernels) :
+			base(entry_block_state, thread_count),
+			m_kernels(std::move(kernels)...),
+			m_exit_block_state(exit_block_state)
+		{};
+
+		sample_state process_block(
+			const pipeline_state& state,
+			const sample_block& in_block,
+			sample_block& out_block,
+			int block_count
+		) noexcept override
+		{
+			process_samples(in_block, out_block, sample_block_size);
+			return m_exit_block_state;
+		};
+
+		void process_blocks(
+			const pipeline_state& state,
+			std::span<const sample_block> in_blocks,
+			std::span<sample_block> out_blocks,
+			std::span<sample_state> out_states,
+			int block_count
+		) noexcept override
+		{
+			//the claimed run is contiguous in both buffers, every channel included, so treat it as one flat array of samples
+			//(init checks the buffers it reads and writes have the same channel count)
+			process_samples(in_blocks.front(), out_blocks.front(), in_blocks.size() * sample_block_size);
+			std::fill(out_states.begin(), out_states.end(), m_exit_block_state);
+		};
+
+		void init(std::vector<audio_ring_buffer>& buffers) override
+		{
+			if (buffers[this->m_in_buffer_idx].m_channel_count != buffers[this->m_out_buffer_idx].m_channel_count)
+				throw std::domain_error("fused_stage::init(buffers) : the input requires the channel_count of the output");
+		};
+		void cleanup() noexcept override {};
+	};
+
+	template <fused_kernel... Kernels>
+	using fused_stage = basic_fused_stage<sample_block_size, sample_rate, Kernels...>;
+
+};
+
+#endif
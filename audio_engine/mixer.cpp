@@ -0,0 +1,83 @@
+#include "mixer.h"
+
+#include <immintrin.h>
+#include <cstring>
+#include <algorithm>
+
+namespace audio_engine {
+
+	namespace {
+		//a tile of output samples kept in L1 while every input is added to it, a quarter of a typical 32KB L1
+		constexpr size_t s_tile_samples = 2048;
+
+		//the inputs accumulated per pass over a tile
+		constexpr size_t s_group_inputs = 8;
+	}
+
+	void mix(std::span<const sample* const> inputs, std::span<const float> gains, sample* out, size_t count) noexcept
+	{
+		if (inputs.empty()) {
+			memset(out, 0, count * sizeof(sample));
+			return;
+		}
+
+		size_t i = 0;
+
+#if defined(AUDIO_ENGINE_AVX2)
+		//the output is mixed a tile at a time, the tile stays in L1 while the inputs are accumulated into it a group at a time so
+		//no more than s_group_inputs + 1 streams are read at once however many inputs there are, the hardware prefetchers only
+		//follow a few dozen
+		for (; i + 32 <= count; i += 32 * (std::min(count - i, s_tile_samples) / 32)) {
+			size_t tile = std::min(count - i, s_tile_samples) / 32 * 32;
+
+			for (size_t first = 0; first < inputs.size(); first += s_group_inputs) {
+				size_t last = std::min(inputs.size(), first + s_group_inputs);
+
+				for (size_t t = i; t < i + tile; t += 32) {
+					//four independent accumulators hide the FMA latency, the group's inputs stream through them one after another
+					__m256 acc0, acc1, acc2, acc3;
+					if (first == 0) {
+						acc0 = acc1 = acc2 = acc3 = _mm256_setzero_ps();
+					}
+					else {
+						acc0 = _mm256_loadu_ps(out + t);
+						acc1 = _mm256_loadu_ps(out + t + 8);
+						acc2 = _mm256_loadu_ps(out + t + 16);
+						acc3 = _mm256_loadu_ps(out + t + 24);
+					}
+
+					for (size_t k = first; k < last; k++) {
+						const sample* in = inputs[k] + t;
+						__m256 gain = _mm256_set1_ps(gains[k]);
+						acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(in), gain, acc0);
+						acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(in + 8), gain, acc1);
+						acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(in + 16), gain, acc2);
+						acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(in + 24), gain, acc3);
+					}
+
+					_mm256_storeu_ps(out + t, acc0);
+					_mm256_storeu_ps(out + t + 8, acc1);
+					_mm256_storeu_ps(out + t + 16, acc2);
+					_mm256_storeu_ps(out + t + 24, acc3);
+				}
+			}
+		}
+
+		for (; i + 8 <= count; i += 8) {
+			__m256 acc = _mm256_setzero_ps();
+			for (size_t k = 0; k < inputs.size(); k++)
+				acc = _mm256_fmadd_ps(_mm256_loadu_ps(inputs[k] + i), _mm256_set1_ps(gains[k]), acc);
+			_mm256_storeu_ps(out + i, acc);
+		}
+#endif
+
+		//the tail of a count that isn't a multiple of 8 (or everything without AVX2)
+		for (; i < count; i++) {
+			float acc = 0.f;
+			for (size_t k = 0; k < inputs.size(); k++)
+				acc += gains[k] * inputs[k][i];
+			out[i] = acc;
+		}
+	}
+
+};
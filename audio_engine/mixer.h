@@ -0,0 +1,25 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include "audio_types.h"
+
+#include <span>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// sums any number of inputs, each scaled by its own gain, into out
+	///
+	///   out[i] = sum(gains[k] * inputs[k][i])
+	///
+	/// the output is mixed in tiles that stay in L1, each input is read once and accumulated in registers 32 samples at a time
+	/// with 8 inputs per pass over the tile, so a mix of many inputs never streams from more memory at once than a mix of 8.
+	/// AVX2/FMA with a scalar fallback
+	/// </summary>
+	/// <param name="inputs">the input samples, count of them each, none of them may overlap out</param>
+	/// <param name="gains">one per input</param>
+	void mix(std::span<const sample* const> inputs, std::span<const float> gains, sample* out, size_t count) noexcept;
+
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "oscillator_bank.h"
+
+#include <immintrin.h>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <numbers>
+
+namespace audio_engine {
+
+	namespace {
+		constexpr float two_pi = 2.f * std::numbers::pi_v<float>;
+
+		//taylor coefficients of sin(t) up to t^11, accurate to ~6e-8 over the reduced range [-pi/2, pi/2]
+		constexpr float sin_c3 = -1.f / 6.f;
+		constexpr float sin_c5 = 1.f / 120.f;
+		constexpr float sin_c7 = -1.f / 5040.f;
+		constexpr float sin_c9 = 1.f / 362880.f;
+		constexpr float sin_c11 = -1.f / 39916800.f;
+
+		//sin(2 pi x) for a phase x in [-0.5, 0.5)
+		inline float sin_cycles(float x) noexcept {
+			//fold into [-0.25, 0.25] using sin(pi - t) = sin(t)
+			if (x > 0.25f)
+				x = 0.5f - x;
+			else if (x < -0.25f)
+				x = -0.5f - x;
+
+			float t = x * two_pi;
+			float t2 = t * t;
+			return t * (1.f + t2 * (sin_c3 + t2 * (sin_c5 + t2 * (sin_c7 + t2 * (sin_c9 + t2 * sin_c11)))));
+		}
+
+		//a 32 bit phase read as signed is the phase in cycles scaled to [-0.5, 0.5)
+		constexpr float phase_scale = 1.f / 4294967296.f;
+
+		inline uint32_t phase_high_bits(uint64_t phase) noexcept {
+			return static_cast<uint32_t>(phase >> 32);
+		}
+
+		//rounded rather than truncated so the per-sample error of the 32 bit step is at most half an lsb
+		inline uint32_t rounded_phase_step(uint64_t increment) noexcept {
+			return static_cast<uint32_t>((increment + (uint64_t(1) << 31)) >> 32);
+		}
+
+#if defined(AUDIO_ENGINE_AVX2)
+		inline __m256 sin_cycles(__m256 x) noexcept {
+			const __m256 quarter = _mm256_set1_ps(0.25f);
+			const __m256 half = _mm256_set1_ps(0.5f);
+
+			__m256 upper = _mm256_sub_ps(half, x);
+			__m256 lower = _mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), half), x);
+			x = _mm256_blendv_ps(x, upper, _mm256_cmp_ps(x, quarter, _CMP_GT_OQ));
+			x = _mm256_blendv_ps(x, lower, _mm256_cmp_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), quarter), _CMP_LT_OQ));
+
+			__m256 t = _mm256_mul_ps(x, _mm256_set1_ps(two_pi));
+			__m256 t2 = _mm256_mul_ps(t, t);
+			__m256 p = _mm256_set1_ps(sin_c11);
+			p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(sin_c9));
+			p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(sin_c7));
+			p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(sin_c5));
+			p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(sin_c3));
+			p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(1.f));
+			return _mm256_mul_ps(p, t);
+		}
+#endif
+	}
+
+	void oscillator_bank::add_oscillator(float frequency, float amplitude)
+	{
+		if (!(frequency >= 0.f && frequency < m_sample_rate / 2.f))
+			throw std::domain_error("oscillator_bank::add_oscillator(frequency, amplitude) : frequency must be in [0, rate / 2)");
+
+		//cycles per sample as a fraction of 2^64, below 2^63 since the frequency is below nyquist
+		double cycles_per_sample = static_cast<double>(frequency) / m_sample_rate;
+		m_phase_increments.push_back(static_cast<uint64_t>(std::ldexp(cycles_per_sample, 64)));
+		m_amplitudes.push_back(amplitude);
+	}
+
+	void oscillator_bank::render(sample* out, size_t count, uint64_t first_sample) const noexcept
+	{
+		memset(out, 0, count * sizeof(sample));
+
+		for (size_t osc = 0; osc < m_phase_increments.size(); osc++) {
+			uint64_t increment = m_phase_increments[osc];
+			//exact, unsigned overflow is the mod 2^64 we want
+			uint64_t phase = increment * first_sample;
+			float amplitude = m_amplitudes[osc];
+			size_t i = 0;
+
+#if defined(AUDIO_ENGINE_AVX2)
+			//lane k starts at the exact phase of sample k, then every lane steps 8 samples at a time
+			alignas(32) uint32_t lane_phases[8];
+			for (int k = 0; k < 8; k++)
+				lane_phases[k] = phase_high_bits(phase + increment * k);
+
+			__m256i phases = _mm256_load_si256(reinterpret_cast<const __m256i*>(lane_phases));
+			const __m256i step = _mm256_set1_epi32(static_cast<int32_t>(rounded_phase_step(increment * 8)));
+			const __m256 scale = _mm256_set1_ps(phase_scale);
+			const __m256 gain = _mm256_set1_ps(amplitude);
+
+			for (; i + 8 <= count; i += 8) {
+				__m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(phases), scale);
+				__m256 acc = _mm256_loadu_ps(out + i);
+				_mm256_storeu_ps(out + i, _mm256_fmadd_ps(sin_cycles(x), gain, acc));
+				phases = _mm256_add_epi32(phases, step);
+			}
+#endif
+
+			//scalar tail (or the whole block without AVX2), restarts from the exact phase of sample i
+			uint32_t scalar_phase = phase_high_bits(phase + increment * i);
+			uint32_t scalar_step = rounded_phase_step(increment);
+			for (; i < count; i++) {
+				float x = static_cast<float>(static_cast<int32_t>(scalar_phase)) * phase_scale;
+				out[i] += sin_cycles(x) * amplitude;
+				scalar_phase += scalar_step;
+			}
+		}
+	}
+
+};
@@ -0,0 +1,49 @@
+#ifndef OSCILLATOR_BANK_H
+#define OSCILLATOR_BANK_H
+
+#include "audio_types.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// a bank of sine oscillators rendered (summed) straight into sample blocks
+	///
+	/// each oscillator is a 64 bit fixed point phase accumulator, one full cycle is 2^64, so the phase of any sample is exactly
+	/// phase_increment * sample_index (mod 2^64). Blocks can therefore be rendered in any order by any thread and still join up
+	/// with exact fractional phase continuity, and a frequency doesn't have to divide the sample rate.
+	///
+	/// within a block the phase is stepped in 32 bit precision (drift < 1e-7 cycles per block, reset at the next block) and the
+	/// sine is a polynomial evaluated 8 samples at a time with AVX2/FMA, with a scalar fallback when they aren't available
+	/// </summary>
+	class oscillator_bank {
+	private:
+		std::vector<uint64_t> m_phase_increments;
+		std::vector<float> m_amplitudes;
+		uint32_t m_sample_rate;
+
+	public:
+		//rate is the sample rate of the stream the bank renders, the frequencies are relative to it
+		explicit oscillator_bank(uint32_t rate = sample_rate) : m_sample_rate(rate) {};
+
+		//frequency in Hz, must be in [0, rate / 2)
+		void add_oscillator(float frequency, float amplitude = 1.f);
+
+		size_t size() const noexcept {
+			return m_phase_increments.size();
+		};
+
+		/// <summary>
+		/// renders the sum of every oscillator into out
+		/// </summary>
+		/// <param name="out">the samples to write</param>
+		/// <param name="count">the number of samples to write</param>
+		/// <param name="first_sample">the unwrapped index of out[0] in the stream, e.g block_count * sample_block_size</param>
+		void render(sample* out, size_t count, uint64_t first_sample) const noexcept;
+	};
+
+};
+
+#endif
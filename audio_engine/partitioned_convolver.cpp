@@ -0,0 +1,152 @@
+#include "partitioned_convolver.h"
+
+#include <immintrin.h>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+namespace audio_engine {
+
+	convolution_ir::convolution_ir(std::span<const sample> impulse_response, size_t partition_size)
+		: m_fft(std::bit_ceil(std::max<size_t>(2 * partition_size, 32))),
+		m_partition_size(partition_size),
+		m_partition_count(partition_size == 0 ? 0 : (impulse_response.size() + partition_size - 1) / partition_size),
+		m_spectrum_size(m_fft.size()),
+		m_spectra()
+	{
+		if (partition_size == 0)
+			throw std::domain_error("convolution_ir::convolution_ir(impulse_response, partition_size) : partition_size must be greater than 0");
+		if (impulse_response.empty())
+			throw std::domain_error("convolution_ir::convolution_ir(impulse_response, partition_size) : impulse_response must have at least 1 sample");
+
+		m_spectra = std::make_unique<float[]>(m_partition_count * m_spectrum_size);
+
+		//each partition goes in at the start of an otherwise silent FFT frame, the silence is what keeps the circular convolution
+		//from wrapping into the samples the convolver outputs
+		const float scale = 1.f / static_cast<float>(m_fft.size());
+		auto frame = std::make_unique<float[]>(m_fft.size());
+		auto work = std::make_unique<float[]>(m_fft.size());
+
+		for (size_t j = 0; j < m_partition_count; j++) {
+			size_t first = j * partition_size;
+			size_t count = std::min(partition_size, impulse_response.size() - first);
+
+			memset(frame.get(), 0, m_fft.size() * sizeof(float));
+			for (size_t i = 0; i < count; i++)
+				frame[i] = impulse_response[first + i] * scale;
+
+			float* spectrum = m_spectra.get() + j * m_spectrum_size;
+			m_fft.forward(frame.get(), spectrum, spectrum + m_fft.bins(), work.get());
+		}
+	}
+
+	partitioned_convolver::partitioned_convolver(std::shared_ptr<const convolution_ir> ir)
+		: m_ir(std::move(ir)),
+		m_input(),
+		m_delay_line(),
+		m_head(0),
+		m_sum(),
+		m_output(),
+		m_work()
+	{
+		if (!m_ir)
+			throw std::domain_error("partitioned_convolver::partitioned_convolver(ir) : requires an impulse response");
+
+		size_t fft_size = m_ir->fft().size();
+		m_input = std::make_unique<float[]>(fft_size);
+		m_delay_line = std::make_unique<float[]>(m_ir->partition_count() * m_ir->spectrum_size());
+		m_sum = std::make_unique<float[]>(m_ir->spectrum_size());
+		m_output = std::make_unique<float[]>(fft_size);
+		m_work = std::make_unique<float[]>(fft_size);
+	}
+
+	void partitioned_convolver::reset() noexcept
+	{
+		memset(m_input.get(), 0, m_ir->fft().size() * sizeof(float));
+		memset(m_delay_line.get(), 0, m_ir->partition_count() * m_ir->spectrum_size() * sizeof(float));
+		m_head = 0;
+	}
+
+	void partitioned_convolver::accumulate() noexcept
+	{
+		const size_t bins = m_ir->fft().bins();
+		const size_t partitions = m_ir->partition_count();
+		const size_t spectrum_size = m_ir->spectrum_size();
+		float* sum_re = m_sum.get();
+		float* sum_im = m_sum.get() + bins;
+
+		memset(sum_re, 0, spectrum_size * sizeof(float));
+
+		//bin 0 packs the real DC and Nyquist bins, each only multiplies by its own kind, so they are summed apart and written over
+		//whatever the complex multiply made of them
+		float dc = 0.f;
+		float nyquist = 0.f;
+
+		//one partition at a time so the input and response spectra both stream in order, the sum is one spectrum and stays in L1
+		size_t slot = m_head;
+		for (size_t j = 0; j < partitions; j++) {
+			const float* x_re = m_delay_line.get() + slot * spectrum_size;
+			const float* x_im = x_re + bins;
+			const float* h_re = m_ir->spectrum(j);
+			const float* h_im = h_re + bins;
+
+			dc += x_re[0] * h_re[0];
+			nyquist += x_im[0] * h_im[0];
+
+			size_t k = 0;
+#if defined(AUDIO_ENGINE_AVX2)
+			for (; k + 16 <= bins; k += 16) {
+				__m256 xr0 = _mm256_loadu_ps(x_re + k), xr1 = _mm256_loadu_ps(x_re + k + 8);
+				__m256 xi0 = _mm256_loadu_ps(x_im + k), xi1 = _mm256_loadu_ps(x_im + k + 8);
+				__m256 hr0 = _mm256_loadu_ps(h_re + k), hr1 = _mm256_loadu_ps(h_re + k + 8);
+				__m256 hi0 = _mm256_loadu_ps(h_im + k), hi1 = _mm256_loadu_ps(h_im + k + 8);
+
+				__m256 sr0 = _mm256_fmadd_ps(xr0, hr0, _mm256_loadu_ps(sum_re + k));
+				__m256 sr1 = _mm256_fmadd_ps(xr1, hr1, _mm256_loadu_ps(sum_re + k + 8));
+				__m256 si0 = _mm256_fmadd_ps(xr0, hi0, _mm256_loadu_ps(sum_im + k));
+				__m256 si1 = _mm256_fmadd_ps(xr1, hi1, _mm256_loadu_ps(sum_im + k + 8));
+				_mm256_storeu_ps(sum_re + k, _mm256_fnmadd_ps(xi0, hi0, sr0));
+				_mm256_storeu_ps(sum_re + k + 8, _mm256_fnmadd_ps(xi1, hi1, sr1));
+				_mm256_storeu_ps(sum_im + k, _mm256_fmadd_ps(xi0, hr0, si0));
+				_mm256_storeu_ps(sum_im + k + 8, _mm256_fmadd_ps(xi1, hr1, si1));
+			}
+#endif
+			for (; k < bins; k++) {
+				sum_re[k] += x_re[k] * h_re[k] - x_im[k] * h_im[k];
+				sum_im[k] += x_re[k] * h_im[k] + x_im[k] * h_re[k];
+			}
+
+			//the next older input spectrum meets the next later partition of the response
+			slot = slot == 0 ? partitions - 1 : slot - 1;
+		}
+
+		sum_re[0] = dc;
+		sum_im[0] = nyquist;
+	}
+
+	void partitioned_convolver::process(const sample* in, sample* out, size_t count) noexcept
+	{
+		const real_fft& fft = m_ir->fft();
+		const size_t fft_size = fft.size();
+		const size_t partition = m_ir->partition_size();
+		const size_t spectrum_size = m_ir->spectrum_size();
+
+		for (size_t offset = 0; offset < count; offset += partition) {
+			//the frame slides along by a partition, the new input is read before out is written so in and out can be the same
+			memmove(m_input.get(), m_input.get() + partition, (fft_size - partition) * sizeof(float));
+			memcpy(m_input.get() + fft_size - partition, in + offset, partition * sizeof(float));
+
+			m_head = m_head + 1 == m_ir->partition_count() ? 0 : m_head + 1;
+			float* spectrum = m_delay_line.get() + m_head * spectrum_size;
+			fft.forward(m_input.get(), spectrum, spectrum + fft.bins(), m_work.get());
+
+			accumulate();
+			fft.inverse(m_sum.get(), m_sum.get() + fft.bins(), m_output.get(), m_work.get());
+
+			//the start of the frame is wrapped by the circular convolution, only its last partition is the linear convolution
+			memcpy(out + offset, m_output.get() + fft_size - partition, partition * sizeof(float));
+		}
+	}
+
+};
@@ -0,0 +1,98 @@
+#ifndef PARTITIONED_CONVOLVER_H
+#define PARTITIONED_CONVOLVER_H
+
+#include "audio_types.h"
+#include "real_fft.h"
+
+#include <span>
+#include <memory>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// an impulse response cut into partitions of partition_size samples, each transformed once into the spectrum the convolver
+	/// multiplies by, const once built so every channel (and every convolver) running the same response shares one copy
+	///
+	/// the FFT is the power of two at or above 2 * partition_size, so a 480 sample block runs a 1024 point FFT. The spectra are
+	/// scaled by 1 / FFT size, the convolver's inverse FFT comes out at unit gain
+	/// </summary>
+	class convolution_ir {
+	private:
+		real_fft m_fft;
+		size_t m_partition_size;
+		size_t m_partition_count;
+		size_t m_spectrum_size; //floats per spectrum, the packed real parts then the packed imaginary parts
+		std::unique_ptr<float[]> m_spectra; //m_partition_count spectra, the one of the response's first partition first
+
+	public:
+		/// <param name="impulse_response">any length of at least 1 sample, the tail of the last partition is zero padded</param>
+		/// <param name="partition_size">the samples per partition, the length the convolver is run in multiples of</param>
+		convolution_ir(std::span<const sample> impulse_response, size_t partition_size);
+
+		const real_fft& fft() const noexcept {
+			return m_fft;
+		};
+
+		size_t partition_size() const noexcept {
+			return m_partition_size;
+		};
+
+		size_t partition_count() const noexcept {
+			return m_partition_count;
+		};
+
+		size_t spectrum_size() const noexcept {
+			return m_spectrum_size;
+		};
+
+		const float* spectrum(size_t partition) const noexcept {
+			return m_spectra.get() + partition * m_spectrum_size;
+		};
+	};
+
+	/// <summary>
+	/// uniformly partitioned overlap-save convolution with a convolution_ir, the output is the input convolved with the whole
+	/// response with no added latency
+	///
+	/// every partition of input is transformed once and pushed onto a frequency domain delay line holding the spectra of the last
+	/// partition_count partitions. The output partition is the inverse FFT of
+	///
+	///   sum(input_spectrum[now - j] * ir_spectrum[j]) for j < partition_count
+	///
+	/// so the cost of a partition is one forward and one inverse FFT plus one complex multiply-add per bin per partition of the
+	/// response, the same for every block however the response is spread. The delay line and the sum are ordered state, blocks must
+	/// be passed in stream order
+	/// </summary>
+	class partitioned_convolver {
+	private:
+		std::shared_ptr<const convolution_ir> m_ir;
+		std::unique_ptr<float[]> m_input;      //the last FFT size samples of input, the newest partition at the end
+		std::unique_ptr<float[]> m_delay_line; //partition_count input spectra, a ring with the newest at m_head
+		size_t m_head;
+		std::unique_ptr<float[]> m_sum;    //one spectrum, the sum of the products, transformed back in place
+		std::unique_ptr<float[]> m_output; //the FFT size samples of the inverse, the last partition_size are the output
+		std::unique_ptr<float[]> m_work;   //FFT scratch
+
+		void accumulate() noexcept;
+
+	public:
+		explicit partitioned_convolver(std::shared_ptr<const convolution_ir> ir);
+
+		const convolution_ir& get_ir() const noexcept {
+			return *m_ir;
+		};
+
+		//silences the input and the delay line, the only full pass over the convolver's memory
+		void reset() noexcept;
+
+		/// <summary>
+		/// convolves count consecutive samples, count must be a multiple of the partition size
+		/// </summary>
+		/// <param name="in">the input samples, may be the same as out</param>
+		/// <param name="out">the output samples</param>
+		void process(const sample* in, sample* out, size_t count) noexcept;
+	};
+
+};
+
+#endif
@@ -0,0 +1,422 @@
+#include "pcm_file_source.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace audio_engine {
+
+	namespace {
+		constexpr uint16_t wave_format_pcm = 1;
+		constexpr uint16_t wave_format_ieee_float = 3;
+		constexpr uint16_t wave_format_extensible = 0xFFFE;
+
+		uint16_t get_u16(const uint8_t* at) {
+			return static_cast<uint16_t>(at[0] | (at[1] << 8));
+		}
+
+		uint32_t get_u32(const uint8_t* at) {
+			return static_cast<uint32_t>(at[0]) | (static_cast<uint32_t>(at[1]) << 8) | (static_cast<uint32_t>(at[2]) << 16) | (static_cast<uint32_t>(at[3]) << 24);
+		}
+
+		uint64_t get_u64(const uint8_t* at) {
+			return get_u32(at) | (static_cast<uint64_t>(get_u32(at + 4)) << 32);
+		}
+
+		bool is_tag(const uint8_t* at, const char* tag) {
+			return memcmp(at, tag, 4) == 0;
+		}
+
+		//samples are loaded with memcpy, nothing guarantees the data chunk is aligned for the sample type
+		template <pcm_encoding E>
+		__forceinline float decode(const uint8_t* at) noexcept {
+			if constexpr (E == pcm_encoding::uint8) {
+				return (static_cast<float>(at[0]) - 128.f) * (1.f / 128.f);
+			}
+			else if constexpr (E == pcm_encoding::int16) {
+				int16_t v;
+				memcpy(&v, at, sizeof(v));
+				return static_cast<float>(v) * (1.f / 32768.f);
+			}
+			else if constexpr (E == pcm_encoding::int24) {
+				//into the top of an int32 so the sign comes along, then scale as a 32 bit sample
+				int32_t v = static_cast<int32_t>((static_cast<uint32_t>(at[0]) << 8) | (static_cast<uint32_t>(at[1]) << 16) | (static_cast<uint32_t>(at[2]) << 24));
+				return static_cast<float>(v) * (1.f / 2147483648.f);
+			}
+			else if constexpr (E == pcm_encoding::int32) {
+				int32_t v;
+				memcpy(&v, at, sizeof(v));
+				return static_cast<float>(v) * (1.f / 2147483648.f);
+			}
+			else if constexpr (E == pcm_encoding::float32) {
+				float v;
+				memcpy(&v, at, sizeof(v));
+				return v;
+			}
+			else {
+				double v;
+				memcpy(&v, at, sizeof(v));
+				return static_cast<float>(v);
+			}
+		}
+
+		template <pcm_encoding E, size_t Bytes>
+		void convert_frames(const uint8_t* src, sample* out, size_t frames, uint16_t channels) noexcept {
+			if (channels == 1) {
+				if constexpr (E == pcm_encoding::float32) {
+					memcpy(out, src, frames * sizeof(float));
+				}
+				else {
+					for (size_t i = 0; i < frames; i++)
+						out[i] = decode<E>(src + i * Bytes);
+				}
+				return;
+			}
+
+			//mix down to the engine's single channel
+			float scale = 1.f / channels;
+			size_t frame_bytes = Bytes * channels;
+			for (size_t i = 0; i < frames; i++) {
+				const uint8_t* frame = src + i * frame_bytes;
+				float sum = 0.f;
+				for (uint16_t c = 0; c < channels; c++)
+					sum += decode<E>(frame + c * Bytes);
+				out[i] = sum * scale;
+			}
+		}
+
+		//one file channel into one output channel, stepping over the others in each frame
+		template <pcm_encoding E, size_t Bytes>
+		void convert_channel(const uint8_t* src, sample* out, size_t frames, uint16_t channels, uint16_t channel) noexcept {
+			size_t frame_bytes = Bytes * channels;
+			src += channel * Bytes;
+			for (size_t i = 0; i < frames; i++)
+				out[i] = decode<E>(src + i * frame_bytes);
+		}
+
+		template <pcm_encoding E, size_t Bytes>
+		void convert_planar(const uint8_t* src, std::span<sample* const> out, size_t frames, uint16_t channels) noexcept {
+			for (size_t c = 0; c < out.size(); c++) {
+				if (channels == 1)
+					convert_frames<E, Bytes>(src, out[c], frames, 1);
+				else if (c < channels)
+					convert_channel<E, Bytes>(src, out[c], frames, channels, static_cast<uint16_t>(c));
+				else
+					std::fill(out[c], out[c] + frames, 0.f);
+			}
+		}
+	}
+
+	size_t pcm_bytes_per_sample(pcm_encoding encoding) noexcept
+	{
+		switch (encoding) {
+		case pcm_encoding::uint8: return 1;
+		case pcm_encoding::int16: return 2;
+		case pcm_encoding::int24: return 3;
+		case pcm_encoding::int32: return 4;
+		case pcm_encoding::float32: return 4;
+		case pcm_encoding::float64: return 8;
+		}
+		return 0;
+	}
+
+	pcm_file_source::pcm_file_source(const std::string& path) :
+#if defined(_WIN32)
+		m_file(INVALID_HANDLE_VALUE),
+		m_mapping(nullptr),
+#else
+		m_fd(-1),
+#endif
+		m_view(nullptr),
+		m_view_size(0),
+		m_format(),
+		m_sample_rate(sample_rate),
+		m_data_offset(0),
+		m_frame_count(0),
+		m_frame_bytes(0),
+		m_prefetched_window(0)
+	{
+		map(path);
+		try {
+			parse_wav(path);
+		}
+		catch (...) {
+			unmap();
+			throw;
+		}
+	}
+
+	pcm_file_source::pcm_file_source(const std::string& path, pcm_format format, uint64_t data_offset) :
+#if defined(_WIN32)
+		m_file(INVALID_HANDLE_VALUE),
+		m_mapping(nullptr),
+#else
+		m_fd(-1),
+#endif
+		m_view(nullptr),
+		m_view_size(0),
+		m_format(format),
+		m_sample_rate(sample_rate),
+		m_data_offset(data_offset),
+		m_frame_count(0),
+		m_frame_bytes(pcm_bytes_per_sample(format.encoding) * format.channels),
+		m_prefetched_window(0)
+	{
+		if (format.channels == 0)
+			throw std::domain_error("pcm_file_source::pcm_file_source(path, format, data_offset) : format must have at least one channel");
+
+		map(path);
+		m_data_offset = std::min(data_offset, m_view_size);
+		m_frame_count = (m_view_size - m_data_offset) / m_frame_bytes;
+	}
+
+	pcm_file_source::~pcm_file_source()
+	{
+		unmap();
+	}
+
+	void pcm_file_source::map(const std::string& path)
+	{
+#if defined(_WIN32)
+		m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("pcm_file_source::map(path) : failed to open " + path);
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size)) {
+			unmap();
+			throw std::runtime_error("pcm_file_source::map(path) : failed to get the size of " + path);
+		}
+		m_view_size = static_cast<uint64_t>(size.QuadPart);
+
+		//an empty file can't be mapped, it just has no frames
+		if (m_view_size == 0)
+			return;
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping)
+			m_view = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_view) {
+			unmap();
+			throw std::runtime_error("pcm_file_source::map(path) : failed to map " + path);
+		}
+#else
+		m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_fd == -1)
+			throw std::runtime_error("pcm_file_source::map(path) : failed to open " + path + " (" + std::strerror(errno) + ")");
+
+		struct stat info;
+		if (::fstat(m_fd, &info) == -1) {
+			unmap();
+			throw std::runtime_error("pcm_file_source::map(path) : failed to stat " + path);
+		}
+		m_view_size = static_cast<uint64_t>(info.st_size);
+
+		if (m_view_size == 0)
+			return;
+
+		void* view = ::mmap(nullptr, m_view_size, PROT_READ, MAP_SHARED, m_fd, 0);
+		if (view == MAP_FAILED) {
+			unmap();
+			throw std::runtime_error("pcm_file_source::map(path) : failed to map " + path + " (" + std::strerror(errno) + ")");
+		}
+		m_view = static_cast<const uint8_t*>(view);
+
+		//playback walks the file front to back, let the kernel read ahead aggressively and drop pages behind us
+		::madvise(view, m_view_size, MADV_SEQUENTIAL);
+#endif
+		//the first two windows, reads keep one window ahead from there
+		advise(0, 2 * s_prefetch_window_bytes);
+		m_prefetched_window.store(1, std::memory_order_relaxed);
+	}
+
+	void pcm_file_source::unmap() noexcept
+	{
+#if defined(_WIN32)
+		if (m_view)
+			UnmapViewOfFile(m_view);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if (m_view)
+			::munmap(const_cast<uint8_t*>(m_view), m_view_size);
+		if (m_fd != -1)
+			::close(m_fd);
+		m_fd = -1;
+#endif
+		m_view = nullptr;
+	}
+
+	void pcm_file_source::parse_wav(const std::string& path)
+	{
+		auto fail = [&](const char* why) {
+			throw std::runtime_error("pcm_file_source::parse_wav(path) : " + path + " " + why);
+		};
+
+		if (m_view_size < 12 || !(is_tag(m_view, "RIFF") || is_tag(m_view, "RF64")) || !is_tag(m_view + 8, "WAVE"))
+			fail("is not a WAV file");
+
+		bool rf64 = is_tag(m_view, "RF64");
+		uint64_t ds64_data_size = 0;
+		bool have_format = false;
+		uint16_t format_tag = 0;
+		uint16_t bits = 0;
+
+		uint64_t at = 12;
+		while (at + 8 <= m_view_size) {
+			const uint8_t* chunk = m_view + at;
+			uint64_t size = get_u32(chunk + 4);
+			uint64_t body = at + 8;
+
+			if (is_tag(chunk, "ds64") && size >= 24 && body + 24 <= m_view_size) {
+				ds64_data_size = get_u64(m_view + body + 8);
+			}
+			else if (is_tag(chunk, "fmt ") && size >= 16 && body + 16 <= m_view_size) {
+				const uint8_t* fmt = m_view + body;
+				format_tag = get_u16(fmt);
+				m_format.channels = get_u16(fmt + 2);
+				m_sample_rate = get_u32(fmt + 4);
+				bits = get_u16(fmt + 14);
+				//WAVE_FORMAT_EXTENSIBLE keeps the real format tag in the first two bytes of the sub format GUID
+				if (format_tag == wave_format_extensible && size >= 40 && body + 40 <= m_view_size)
+					format_tag = get_u16(fmt + 24);
+				have_format = true;
+			}
+			else if (is_tag(chunk, "data")) {
+				if (!have_format)
+					fail("has its data chunk before its fmt chunk");
+
+				//RF64 moves the real size into ds64, a streamed file that was never finalised has a placeholder size,
+				//either way the data can't run past the end of the file
+				if (rf64 && size == UINT32_MAX)
+					size = ds64_data_size;
+				m_data_offset = body;
+				uint64_t data_size = std::min(size, m_view_size - body);
+
+				if (format_tag == wave_format_pcm && bits == 8)
+					m_format.encoding = pcm_encoding::uint8;
+				else if (format_tag == wave_format_pcm && bits == 16)
+					m_format.encoding = pcm_encoding::int16;
+				else if (format_tag == wave_format_pcm && bits == 24)
+					m_format.encoding = pcm_encoding::int24;
+				else if (format_tag == wave_format_pcm && bits == 32)
+					m_format.encoding = pcm_encoding::int32;
+				else if (format_tag == wave_format_ieee_float && bits == 32)
+					m_format.encoding = pcm_encoding::float32;
+				else if (format_tag == wave_format_ieee_float && bits == 64)
+					m_format.encoding = pcm_encoding::float64;
+				else
+					fail("has a sample format other than 8/16/24/32 bit PCM or 32/64 bit float");
+
+				if (m_format.channels == 0)
+					fail("has no channels");
+				if (m_sample_rate != sample_rate)
+					throw std::domain_error("pcm_file_source::parse_wav(path) : " + path + " is at " + std::to_string(m_sample_rate) + "Hz, the engine runs at " + std::to_string(sample_rate) + "Hz");
+
+				m_frame_bytes = pcm_bytes_per_sample(m_format.encoding) * m_format.channels;
+				m_frame_count = data_size / m_frame_bytes;
+				return;
+			}
+
+			//chunks are padded to an even size
+			at = body + size + (size & 1);
+		}
+
+		fail("has no data chunk");
+	}
+
+	void pcm_file_source::advise(uint64_t begin, uint64_t length) const noexcept
+	{
+		if (begin >= m_view_size)
+			return;
+		length = std::min(length, m_view_size - begin);
+
+#if defined(_WIN32)
+		WIN32_MEMORY_RANGE_ENTRY range{ const_cast<uint8_t*>(m_view) + begin, static_cast<SIZE_T>(length) };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+		::madvise(const_cast<uint8_t*>(m_view) + begin, length, MADV_WILLNEED);
+#endif
+	}
+
+	void pcm_file_source::prefetch(uint64_t end_byte) const noexcept
+	{
+		//keep the window after the one being read advised, only the reader that moves the mark forward makes the call
+		uint64_t window = end_byte / s_prefetch_window_bytes + 1;
+		uint64_t advised = m_prefetched_window.load(std::memory_order_relaxed);
+		if (window <= advised || !m_prefetched_window.compare_exchange_strong(advised, window, std::memory_order_relaxed))
+			return;
+
+		advise(window * s_prefetch_window_bytes, s_prefetch_window_bytes);
+	}
+
+	void pcm_file_source::read(uint64_t first_frame, sample* out, size_t count) const noexcept
+	{
+		size_t available = first_frame < m_frame_count ? static_cast<size_t>(std::min<uint64_t>(count, m_frame_count - first_frame)) : 0;
+
+		if (available != 0) {
+			uint64_t offset = m_data_offset + first_frame * m_frame_bytes;
+			prefetch(offset + available * m_frame_bytes);
+
+			const uint8_t* src = m_view + offset;
+			uint16_t channels = m_format.channels;
+			switch (m_format.encoding) {
+			case pcm_encoding::uint8: convert_frames<pcm_encoding::uint8, 1>(src, out, available, channels); break;
+			case pcm_encoding::int16: convert_frames<pcm_encoding::int16, 2>(src, out, available, channels); break;
+			case pcm_encoding::int24: convert_frames<pcm_encoding::int24, 3>(src, out, available, channels); break;
+			case pcm_encoding::int32: convert_frames<pcm_encoding::int32, 4>(src, out, available, channels); break;
+			case pcm_encoding::float32: convert_frames<pcm_encoding::float32, 4>(src, out, available, channels); break;
+			case pcm_encoding::float64: convert_frames<pcm_encoding::float64, 8>(src, out, available, channels); break;
+			}
+		}
+
+		//past the end of the data is silence
+		std::fill(out + available, out + count, 0.f);
+	}
+
+	void pcm_file_source::read_planar(uint64_t first_frame, std::span<sample* const> out, size_t count) const noexcept
+	{
+		if (out.size() == 1) {
+			read(first_frame, out[0], count);
+			return;
+		}
+
+		size_t available = first_frame < m_frame_count ? static_cast<size_t>(std::min<uint64_t>(count, m_frame_count - first_frame)) : 0;
+
+		if (available != 0) {
+			uint64_t offset = m_data_offset + first_frame * m_frame_bytes;
+			prefetch(offset + available * m_frame_bytes);
+
+			const uint8_t* src = m_view + offset;
+			uint16_t channels = m_format.channels;
+			switch (m_format.encoding) {
+			case pcm_encoding::uint8: convert_planar<pcm_encoding::uint8, 1>(src, out, available, channels); break;
+			case pcm_encoding::int16: convert_planar<pcm_encoding::int16, 2>(src, out, available, channels); break;
+			case pcm_encoding::int24: convert_planar<pcm_encoding::int24, 3>(src, out, available, channels); break;
+			case pcm_encoding::int32: convert_planar<pcm_encoding::int32, 4>(src, out, available, channels); break;
+			case pcm_encoding::float32: convert_planar<pcm_encoding::float32, 4>(src, out, available, channels); break;
+			case pcm_encoding::float64: convert_planar<pcm_encoding::float64, 8>(src, out, available, channels); break;
+			}
+		}
+
+		for (auto* channel : out)
+			std::fill(channel + available, channel + count, 0.f);
+	}
+
+};
@@ -0,0 +1,109 @@
+#ifndef PCM_FILE_SOURCE_H
+#define PCM_FILE_SOURCE_H
+
+#include "audio_types.h"
+
+#include <string>
+#include <span>
+#include <atomic>
+#include <cstdint>
+
+namespace audio_engine {
+
+	enum class pcm_encoding : uint8_t {
+		uint8,   //unsigned, 128 is silence
+		int16,
+		int24,   //packed 3 byte little endian
+		int32,
+		float32,
+		float64
+	};
+
+	//the layout of interleaved little endian PCM frames
+	struct pcm_format {
+		pcm_encoding encoding = pcm_encoding::float32;
+		uint16_t channels = 1;
+	};
+
+	size_t pcm_bytes_per_sample(pcm_encoding encoding) noexcept;
+
+	/// <summary>
+	/// a read only memory mapping of a WAV (RIFF/RF64) or raw PCM file that converts any stretch of its frames to engine samples
+	///
+	/// samples are converted straight out of the mapping, there is no read syscall or intermediate copy per block and pages are
+	/// only faulted in as they are reached. The mapping is advised for sequential access and the window ahead of the furthest read
+	/// is prefetched so the kernel's readahead stays ahead of playback, a multi-GB file streams without being held in memory.
+	///
+	/// read mixes a multichannel file down to one channel by averaging, read_planar splits it into one output per channel.
+	/// frames past the end of the data read as silence.
+	/// read is const and touches no shared state besides the prefetch position, so any number of workers can read at once
+	/// </summary>
+	class pcm_file_source {
+	private:
+		//how far ahead of the furthest read the mapping is prefetched, one madvise per window rather than per block
+		static constexpr uint64_t s_prefetch_window_bytes = 4ull << 20;
+
+#if defined(_WIN32)
+		void* m_file;
+		void* m_mapping;
+#else
+		int m_fd;
+#endif
+		const uint8_t* m_view;
+		uint64_t m_view_size;
+
+		pcm_format m_format;
+		uint32_t m_sample_rate;
+		uint64_t m_data_offset;
+		uint64_t m_frame_count;
+		size_t m_frame_bytes;
+		mutable std::atomic<uint64_t> m_prefetched_window;
+
+		void map(const std::string& path);
+		void unmap() noexcept;
+		void parse_wav(const std::string& path);
+		void advise(uint64_t begin, uint64_t length) const noexcept;
+		void prefetch(uint64_t end_byte) const noexcept;
+
+	public:
+		//maps a WAV file and takes the format from its header, throws std::runtime_error if the file can't be mapped
+		//or isn't a WAV file this can read and std::domain_error if it's not at the engine sample rate
+		explicit pcm_file_source(const std::string& path);
+
+		//maps a headerless file of format frames starting data_offset bytes in, assumed to be at the engine sample rate
+		pcm_file_source(const std::string& path, pcm_format format, uint64_t data_offset = 0);
+
+		~pcm_file_source();
+
+		pcm_file_source(const pcm_file_source&) = delete;
+		pcm_file_source& operator=(const pcm_file_source&) = delete;
+
+		/// <summary>
+		/// converts count frames starting at first_frame into out
+		/// </summary>
+		/// <param name="first_frame">the frame number in the file, e.g block_count * sample_block_size</param>
+		void read(uint64_t first_frame, sample* out, size_t count) const noexcept;
+
+		/// <summary>
+		/// converts count frames starting at first_frame into one output per channel, file channel c goes to out[c]
+		/// a mono file is copied to every output, outputs past the file's channels are silent and file channels past the outputs are
+		/// dropped, a single output gets the mixdown read gives
+		/// </summary>
+		void read_planar(uint64_t first_frame, std::span<sample* const> out, size_t count) const noexcept;
+
+		const pcm_format& get_format() const noexcept {
+			return m_format;
+		};
+
+		uint32_t get_sample_rate() const noexcept {
+			return m_sample_rate;
+		};
+
+		uint64_t get_frame_count() const noexcept {
+			return m_frame_count;
+		};
+	};
+
+};
+
+#endif
@@ -0,0 +1,367 @@
+#include "pcm_file_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+namespace audio_engine {
+
+	namespace {
+		//RIFF "WAVE" + JUNK(28) reserved for ds64 + "fmt "(18) float + "fact"(4) + "data" header
+		constexpr size_t wav_header_size = 12 + 36 + 26 + 12 + 8;
+		constexpr uint32_t wave_format_ieee_float = 3;
+
+		void put_tag(uint8_t* at, const char* tag) {
+			memcpy(at, tag, 4);
+		}
+
+		void put_u16(uint8_t* at, uint16_t value) {
+			at[0] = static_cast<uint8_t>(value);
+			at[1] = static_cast<uint8_t>(value >> 8);
+		}
+
+		void put_u32(uint8_t* at, uint32_t value) {
+			for (int i = 0; i < 4; i++)
+				at[i] = static_cast<uint8_t>(value >> (8 * i));
+		}
+
+		void put_u64(uint8_t* at, uint64_t value) {
+			for (int i = 0; i < 8; i++)
+				at[i] = static_cast<uint8_t>(value >> (8 * i));
+		}
+
+		/// <summary>
+		/// builds the WAV header for data_bytes of float samples, as RF64 once a RIFF size no longer fits in 32 bits
+		/// streaming writes the "unknown length" 0xFFFFFFFF sizes used for output that is never finalised
+		/// </summary>
+		std::array<uint8_t, wav_header_size> make_wav_header(uint64_t data_bytes, uint16_t channels, bool streaming) {
+			std::array<uint8_t, wav_header_size> header{};
+			uint8_t* h = header.data();
+
+			uint32_t block_align = channels * sizeof(sample);
+			uint64_t frames = data_bytes / block_align;
+			uint64_t riff_size = wav_header_size - 8 + data_bytes;
+			bool rf64 = riff_size > UINT32_MAX;
+			bool unknown = rf64 || streaming;
+
+			put_tag(h + 0, rf64 ? "RF64" : "RIFF");
+			put_u32(h + 4, unknown ? UINT32_MAX : static_cast<uint32_t>(riff_size));
+			put_tag(h + 8, "WAVE");
+
+			//the ds64 chunk carries the 64 bit sizes of an RF64 file, a plain WAV keeps the space as a JUNK chunk readers skip
+			put_tag(h + 12, rf64 ? "ds64" : "JUNK");
+			put_u32(h + 16, 28);
+			if (rf64) {
+				put_u64(h + 20, riff_size);
+				put_u64(h + 28, data_bytes);
+				put_u64(h + 36, frames);
+				put_u32(h + 44, 0); //no table entries
+			}
+
+			put_tag(h + 48, "fmt ");
+			put_u32(h + 52, 18);
+			put_u16(h + 56, wave_format_ieee_float);
+			put_u16(h + 58, channels);
+			put_u32(h + 60, sample_rate);
+			put_u32(h + 64, sample_rate * block_align);
+			put_u16(h + 68, static_cast<uint16_t>(block_align));
+			put_u16(h + 70, sizeof(sample) * 8);
+			put_u16(h + 72, 0);
+
+			put_tag(h + 74, "fact");
+			put_u32(h + 78, 4);
+			put_u32(h + 82, unknown ? UINT32_MAX : static_cast<uint32_t>(frames));
+
+			put_tag(h + 86, "data");
+			put_u32(h + 90, unknown ? UINT32_MAX : static_cast<uint32_t>(data_bytes));
+
+			return header;
+		}
+	}
+
+	pcm_file_writer::pcm_file_writer(size_t staging_blocks) :
+		m_staging(staging_blocks),
+		m_wake(),
+		m_closing(false),
+		m_dropped_blocks(0),
+		m_written_blocks(0),
+		m_thread(),
+		m_path(),
+		m_channels(1),
+#if defined(_WIN32)
+		m_handle(INVALID_HANDLE_VALUE),
+#else
+		m_fd(-1),
+#endif
+		m_open(false),
+		m_sequential(false),
+		m_end_block(0),
+		m_sequential_offset(0),
+		m_run_buffer()
+	{
+	}
+
+	pcm_file_writer::~pcm_file_writer()
+	{
+		close();
+	}
+
+	void pcm_file_writer::open(const std::string& path, uint16_t channels)
+	{
+		close();
+
+#if defined(_WIN32)
+		m_handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_handle == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("pcm_file_writer::open(path) : failed to open " + path);
+		m_sequential = GetFileType(m_handle) != FILE_TYPE_DISK;
+#else
+		m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (m_fd == -1)
+			throw std::runtime_error("pcm_file_writer::open(path) : failed to open " + path + " (" + std::strerror(errno) + ")");
+		m_sequential = ::lseek(m_fd, 0, SEEK_CUR) == -1 && errno == ESPIPE;
+#endif
+
+		m_path = path;
+		m_channels = channels;
+		m_open = true;
+		m_end_block = 0;
+		m_sequential_offset = 0;
+		m_closing.store(false);
+		m_dropped_blocks.store(0);
+		m_written_blocks.store(0);
+
+		write_header(0, m_sequential);
+		m_thread = std::jthread([this] { writer_loop(); });
+	}
+
+	bool pcm_file_writer::submit(uint64_t block_index, const sample_block& block) noexcept
+	{
+		bool staged = m_staging.try_push_with([&](staged_block& slot) {
+			slot.index = block_index;
+			memcpy(slot.samples, block, sizeof(sample_block));
+		});
+
+		if (!staged) {
+			m_dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		m_wake.notify_one();
+		return true;
+	}
+
+	bool pcm_file_writer::submit(uint64_t block_index, std::span<const sample_block> channels) noexcept
+	{
+		size_t channel_count = channels.size();
+		if (channel_count == 1)
+			return submit(block_index, channels[0]);
+
+		//chunk k of the block holds interleaved samples [k * sample_block_size, (k + 1) * sample_block_size) of the block's frames
+		bool staged = true;
+		for (size_t chunk = 0; chunk < channel_count; chunk++) {
+			bool pushed = m_staging.try_push_with([&](staged_block& slot) {
+				slot.index = block_index * channel_count + chunk;
+				size_t first = chunk * sample_block_size;
+				for (size_t i = 0; i < sample_block_size; i++) {
+					size_t interleaved = first + i;
+					slot.samples[i] = channels[interleaved % channel_count][interleaved / channel_count];
+				}
+			});
+
+			if (!pushed) {
+				m_dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+				staged = false;
+			}
+		}
+
+		m_wake.notify_one();
+		return staged;
+	}
+
+	void pcm_file_writer::close() noexcept
+	{
+		if (!m_open)
+			return;
+
+		//the writer drains everything staged before it exits
+		m_closing.store(true);
+		m_wake.notify_all();
+		if (m_thread.joinable())
+			m_thread.join();
+
+		if (!m_sequential)
+			write_header(m_end_block * sizeof(sample_block), false);
+
+		close_file();
+		m_open = false;
+	}
+
+	void pcm_file_writer::close_file() noexcept
+	{
+#if defined(_WIN32)
+		if (m_handle != INVALID_HANDLE_VALUE)
+			CloseHandle(m_handle);
+		m_handle = INVALID_HANDLE_VALUE;
+#else
+		if (m_fd != -1)
+			::close(m_fd);
+		m_fd = -1;
+#endif
+	}
+
+	void pcm_file_writer::writer_loop()
+	{
+		std::vector<staged_block> batch(s_batch_blocks);
+
+		for (;;) {
+			size_t count = 0;
+			while (count < s_batch_blocks && m_staging.try_pop_with([&](staged_block& slot) {
+				batch[count].index = slot.index;
+				memcpy(batch[count].samples, slot.samples, sizeof(sample_block));
+			}))
+				count++;
+
+			if (count != 0) {
+				write_batch(batch.data(), count);
+				continue;
+			}
+
+			if (m_closing.load()) {
+				//a push that claimed its slot but hasn't published it yet shows up as not empty, wait for it
+				if (m_staging.empty())
+					return;
+				std::this_thread::yield();
+				continue;
+			}
+
+			auto key = m_wake.prepare_wait();
+			if (!m_staging.empty() || m_closing.load())
+				m_wake.cancel_wait();
+			else
+				m_wake.wait(key);
+		}
+	}
+
+	void pcm_file_writer::write_batch(staged_block* batch, size_t count)
+	{
+		//sort by block index so consecutive blocks coalesce into one write, sequential output keeps arrival order
+		std::array<const staged_block*, s_batch_blocks> order;
+		for (size_t i = 0; i < count; i++)
+			order[i] = &batch[i];
+		if (!m_sequential)
+			std::sort(order.begin(), order.begin() + count, [](const staged_block* a, const staged_block* b) { return a->index < b->index; });
+
+		size_t run_start = 0;
+		for (size_t i = 1; i <= count; i++) {
+			bool run_ends = i == count || (!m_sequential && order[i]->index != order[i - 1]->index + 1);
+			if (run_ends) {
+				write_run(order.data() + run_start, i - run_start);
+				run_start = i;
+			}
+		}
+
+		m_written_blocks.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void pcm_file_writer::write_run(const staged_block* const* run, size_t count)
+	{
+		uint64_t offset = m_sequential ? m_sequential_offset : wav_header_size + run[0]->index * sizeof(sample_block);
+		m_end_block = std::max(m_end_block, run[count - 1]->index + 1);
+
+#if defined(_WIN32)
+		m_run_buffer.resize(count * sample_block_size);
+		for (size_t i = 0; i < count; i++)
+			memcpy(m_run_buffer.data() + i * sample_block_size, run[i]->samples, sizeof(sample_block));
+		write_at(offset, m_run_buffer.data(), count * sizeof(sample_block));
+#else
+		//one scatter write straight out of the staged blocks
+		std::array<iovec, s_batch_blocks> iov;
+		for (size_t i = 0; i < count; i++)
+			iov[i] = iovec{ const_cast<sample*>(run[i]->samples), sizeof(sample_block) };
+
+		iovec* next = iov.data();
+		int remaining = static_cast<int>(count);
+		uint64_t position = offset;
+		while (remaining > 0) {
+			ssize_t written = m_sequential
+				? ::writev(m_fd, next, remaining)
+				: ::pwritev(m_fd, next, remaining, static_cast<off_t>(position));
+			if (written < 0) {
+				if (errno == EINTR)
+					continue;
+				//nothing sensible to do with an I/O error on the writer thread, the blocks count as dropped
+				m_dropped_blocks.fetch_add(count, std::memory_order_relaxed);
+				return;
+			}
+
+			//a short write, skip what went out and continue from the middle of an iovec if needed
+			position += written;
+			size_t left = static_cast<size_t>(written);
+			while (remaining > 0 && left >= next->iov_len) {
+				left -= next->iov_len;
+				next++;
+				remaining--;
+			}
+			if (remaining > 0) {
+				next->iov_base = static_cast<char*>(next->iov_base) + left;
+				next->iov_len -= left;
+			}
+		}
+#endif
+
+		if (m_sequential)
+			m_sequential_offset += count * sizeof(sample_block);
+	}
+
+	void pcm_file_writer::write_at(uint64_t offset, const void* data, size_t size)
+	{
+		const char* bytes = static_cast<const char*>(data);
+
+		while (size > 0) {
+#if defined(_WIN32)
+			OVERLAPPED position{};
+			position.Offset = static_cast<DWORD>(offset);
+			position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+			DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+			DWORD written = 0;
+			if (!WriteFile(m_handle, bytes, chunk, &written, m_sequential ? nullptr : &position)) {
+				m_dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+#else
+			ssize_t written = m_sequential ? ::write(m_fd, bytes, size) : ::pwrite(m_fd, bytes, size, static_cast<off_t>(offset));
+			if (written < 0) {
+				if (errno == EINTR)
+					continue;
+				m_dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+#endif
+			bytes += written;
+			offset += written;
+			size -= written;
+		}
+	}
+
+	void pcm_file_writer::write_header(uint64_t data_bytes, bool streaming)
+	{
+		auto header = make_wav_header(data_bytes, m_channels, streaming);
+		write_at(0, header.data(), header.size());
+		if (m_sequential)
+			m_sequential_offset = header.size();
+	}
+
+};
@@ -0,0 +1,111 @@
+#ifndef PCM_FILE_WRITER_H
+#define PCM_FILE_WRITER_H
+
+#include "audio_types.h"
+#include "bounded_queue.h"
+#include "event_count.h"
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <span>
+#include <cstdint>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// writes sample blocks to a 32 bit float WAV file from a background thread
+	///
+	/// submit copies the block into a lock-free staging queue and returns, it never touches the disk or takes a lock, so an output
+	/// stage worker can't be held up by I/O. If the writer falls behind far enough to fill the staging queue the block is dropped
+	/// and counted rather than blocking the pipeline.
+	///
+	/// the writer drains the queue in batches and writes every run of consecutive blocks with one positional scatter write
+	/// (pwritev, WriteFile on Windows) at the offset given by the block index, so blocks may be submitted out of order by
+	/// several workers. Output that can't seek (a pipe) falls back to plain sequential write() in arrival order.
+	///
+	/// close finalises the header with the real sizes, switching it to RF64 in place (the header reserves a JUNK chunk for the
+	/// ds64 chunk) when the file passes the 4GiB RIFF limit
+	/// </summary>
+	class pcm_file_writer {
+	private:
+		struct staged_block {
+			uint64_t index;
+			sample_block samples;
+		};
+
+		static constexpr size_t s_default_staging_blocks = 1024; //~2MB, 10s of mono audio
+		static constexpr size_t s_batch_blocks = 64; //blocks drained per batch, at most one iovec each
+
+		bounded_mpmc_queue<staged_block> m_staging;
+		event_count m_wake;
+		std::atomic<bool> m_closing;
+		std::atomic<uint64_t> m_dropped_blocks;
+		std::atomic<uint64_t> m_written_blocks;
+		std::jthread m_thread;
+		std::string m_path;
+		uint16_t m_channels;
+
+#if defined(_WIN32)
+		void* m_handle;
+#else
+		int m_fd;
+#endif
+		bool m_open;
+		bool m_sequential; //the output can't seek, blocks go out in arrival order and the header can't be finalised
+		uint64_t m_end_block; //one past the highest block index written, writer thread only
+		uint64_t m_sequential_offset;
+		std::vector<sample> m_run_buffer; //coalesces a run for platforms without scatter writes
+
+		void writer_loop();
+		void write_batch(staged_block* batch, size_t count);
+		void write_run(const staged_block* const* run, size_t count);
+		void write_at(uint64_t offset, const void* data, size_t size);
+		void write_header(uint64_t data_bytes, bool streaming);
+		void close_file() noexcept;
+
+	public:
+		explicit pcm_file_writer(size_t staging_blocks = s_default_staging_blocks);
+		~pcm_file_writer();
+
+		pcm_file_writer(const pcm_file_writer&) = delete;
+		pcm_file_writer& operator=(const pcm_file_writer&) = delete;
+
+		//creates (truncates) the file, writes a provisional header and starts the writer thread, throws std::runtime_error if the file can't be opened
+		void open(const std::string& path, uint16_t channels = 1);
+
+		/// <summary>
+		/// stages a block for writing, wait-free apart from the queue CAS
+		/// </summary>
+		/// <param name="block_index">the unwrapped block number, the block is written at header + block_index * sizeof(sample_block)</param>
+		/// <returns>false if the staging queue was full and the block was dropped</returns>
+		bool submit(uint64_t block_index, const sample_block& block) noexcept;
+
+		/// <summary>
+		/// stages one block of every channel (planar, as a multichannel ring buffer holds them), interleaved into the file's frame order
+		/// the interleaved block goes through the queue as channels.size() sample_block sized chunks, so dropped_blocks counts chunks
+		/// </summary>
+		/// <param name="channels">one sample_block per channel of the file, in channel order</param>
+		/// <returns>false if any chunk of the block was dropped</returns>
+		bool submit(uint64_t block_index, std::span<const sample_block> channels) noexcept;
+
+		//writes everything still staged, finalises the header and closes the file, safe to call more than once
+		void close() noexcept;
+
+		bool is_open() const noexcept {
+			return m_open;
+		};
+
+		uint64_t dropped_blocks() const noexcept {
+			return m_dropped_blocks.load(std::memory_order_relaxed);
+		};
+
+		uint64_t written_blocks() const noexcept {
+			return m_written_blocks.load(std::memory_order_relaxed);
+		};
+	};
+
+};
+
+#endif
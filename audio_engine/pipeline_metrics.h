@@ -0,0 +1,157 @@
+#ifndef PIPELINE_METRICS_H
+#define PIPELINE_METRICS_H
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+//build with AUDIO_ENGINE_METRICS=0 to compile the pipeline's instrumentation out, the snapshot API stays but reads all zeros
+#ifndef AUDIO_ENGINE_METRICS
+#define AUDIO_ENGINE_METRICS 1
+#endif
+
+namespace audio_engine {
+
+	constexpr bool metrics_enabled = AUDIO_ENGINE_METRICS != 0;
+
+	//bumps a counter only its owning thread writes, a plain load and store rather than a locked read-modify-write
+	inline void bump_counter(std::atomic<uint64_t>& counter, uint64_t amount = 1) noexcept {
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// HDR style log-linear histogram of nanosecond latencies
+	///
+	/// every power of two range is split into 8 linear sub-buckets so a recorded value is known to within 12.5% from 1ns up to
+	/// the full 64 bit range in 496 buckets, values below 8ns are exact. This is the copyable snapshot form, latency_recorder is
+	/// the live form a thread records into
+	/// </summary>
+	struct latency_histogram {
+		static constexpr unsigned s_sub_bucket_bits = 3;
+		static constexpr size_t s_sub_buckets = size_t(1) << s_sub_bucket_bits;
+		static constexpr size_t s_bucket_count = (64 - s_sub_bucket_bits + 1) * s_sub_buckets;
+
+		std::array<uint64_t, s_bucket_count> counts{};
+
+		static constexpr size_t bucket_of(uint64_t ns) noexcept {
+			if (ns < s_sub_buckets)
+				return static_cast<size_t>(ns);
+
+			unsigned exponent = std::bit_width(ns) - 1;
+			size_t sub_bucket = (ns >> (exponent - s_sub_bucket_bits)) & (s_sub_buckets - 1);
+			return (exponent - s_sub_bucket_bits + 1) * s_sub_buckets + sub_bucket;
+		}
+
+		//the largest value that lands in the bucket
+		static constexpr uint64_t bucket_upper_bound(size_t bucket) noexcept {
+			if (bucket < s_sub_buckets)
+				return bucket;
+
+			unsigned exponent = static_cast<unsigned>(bucket / s_sub_buckets) + s_sub_bucket_bits - 1;
+			uint64_t width = uint64_t(1) << (exponent - s_sub_bucket_bits);
+			uint64_t lower = (s_sub_buckets + bucket % s_sub_buckets) * width;
+			return lower + (width - 1);
+		}
+
+		uint64_t total() const noexcept {
+			uint64_t sum = 0;
+			for (auto count : counts)
+				sum += count;
+			return sum;
+		}
+
+		//the value at quantile q in [0, 1], as the upper bound of the bucket it falls in, 0 for an empty histogram
+		uint64_t percentile(double q) const noexcept {
+			uint64_t count = total();
+			if (count == 0)
+				return 0;
+
+			uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+			uint64_t seen = 0;
+			for (size_t i = 0; i < s_bucket_count; i++) {
+				seen += counts[i];
+				if (seen >= rank)
+					return bucket_upper_bound(i);
+			}
+			return bucket_upper_bound(s_bucket_count - 1);
+		}
+
+		latency_histogram& operator+=(const latency_histogram& other) noexcept {
+			for (size_t i = 0; i < s_bucket_count; i++)
+				counts[i] += other.counts[i];
+			return *this;
+		}
+	};
+
+	static_assert(latency_histogram::bucket_of(~uint64_t(0)) == latency_histogram::s_bucket_count - 1);
+	static_assert(latency_histogram::bucket_upper_bound(latency_histogram::bucket_of(1000)) >= 1000);
+
+	//the live histogram, written by one thread and read by any
+	class latency_recorder {
+	private:
+		std::array<std::atomic<uint64_t>, latency_histogram::s_bucket_count> m_counts{};
+
+	public:
+		void record(uint64_t ns, uint64_t weight = 1) noexcept {
+			bump_counter(m_counts[latency_histogram::bucket_of(ns)], weight);
+		}
+
+		void read_into(latency_histogram& histogram) const noexcept {
+			for (size_t i = 0; i < latency_histogram::s_bucket_count; i++)
+				histogram.counts[i] += m_counts[i].load(std::memory_order_relaxed);
+		}
+	};
+
+	//what one worker has done for one stage, only that worker writes it
+	struct stage_counters {
+		std::atomic<uint64_t> blocks{ 0 };
+		std::atomic<uint64_t> runs{ 0 };           //process_blocks calls, one per claimed run
+		std::atomic<uint64_t> claim_failures{ 0 }; //a block was found in the entry state but another worker claimed it first
+		std::atomic<uint64_t> turn_waits{ 0 };     //ordered stages: a channel of a run waited for the run before to finish it
+		std::atomic<uint64_t> busy_ns{ 0 };        //time spent inside the stage's process calls
+		latency_recorder block_latency;            //process time per block, each run recorded once per block it covered
+	};
+
+	struct worker_counters {
+		std::atomic<uint64_t> tasks{ 0 };
+		std::atomic<uint64_t> idle_spins{ 0 }; //pause-hint iterations spent looking for a task
+		std::atomic<uint64_t> parks{ 0 };      //times the worker went to sleep for lack of tasks
+	};
+
+	struct stage_metrics {
+		uint64_t blocks = 0;
+		uint64_t runs = 0;
+		uint64_t claim_failures = 0;
+		uint64_t turn_waits = 0;
+		uint64_t busy_ns = 0;
+		latency_histogram block_latency;
+	};
+
+	struct worker_metrics {
+		uint64_t tasks = 0;
+		uint64_t idle_spins = 0;
+		uint64_t parks = 0;
+		uint64_t blocks = 0;          //over every stage the worker ran
+		uint64_t claim_failures = 0;
+		uint64_t busy_ns = 0;
+	};
+
+	/// <summary>
+	/// a point in time copy of the pipeline's counters, see audio_pipeline::get_metrics
+	/// </summary>
+	struct pipeline_metrics {
+		//summed over the workers, node by node in the order the nodes were added and each node's stages in order
+		//(generator stages first, then processing, then output for a pipeline built from the three groups)
+		std::vector<stage_metrics> stages;
+		std::vector<worker_metrics> workers;
+		//how long each node (generator, processing, output group) was stalled by the run loop flushing it, one entry per flush
+		std::vector<latency_histogram> flush_latency;
+	};
+
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "real_fft.h"
+
+#include <immintrin.h>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+namespace audio_engine {
+
+	namespace {
+		//stages with a span below this vectorize across butterflies rather than along them
+		constexpr size_t s_vector_span = 8;
+
+#if defined(AUDIO_ENGINE_AVX2)
+		inline __m256 reverse_lanes(__m256 v) noexcept {
+			return _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+		}
+
+		//writes the sums and differences of 8 / span butterflies to their places 2 * span apart, runs of span from each in turn
+		template <size_t span>
+		inline void store_interleaved(float* out, __m256 sums, __m256 differences) noexcept {
+			__m256 lo, hi;
+			if constexpr (span == 1) {
+				lo = _mm256_unpacklo_ps(sums, differences);
+				hi = _mm256_unpackhi_ps(sums, differences);
+			}
+			else if constexpr (span == 2) {
+				lo = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(sums), _mm256_castps_pd(differences)));
+				hi = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(sums), _mm256_castps_pd(differences)));
+			}
+			else {
+				lo = sums;
+				hi = differences;
+			}
+			_mm256_storeu_ps(out, _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+
+		//a stage with a span below 8, the twiddles are expanded so element t of the first half always pairs with twiddle t
+		template <size_t span>
+		void narrow_stage(const float* xr, const float* xi, float* yr, float* yi, const float* wr, const float* wi, size_t half) noexcept {
+			for (size_t t = 0; t < half; t += 8) {
+				__m256 ar = _mm256_loadu_ps(xr + t);
+				__m256 ai = _mm256_loadu_ps(xi + t);
+				__m256 br = _mm256_loadu_ps(xr + t + half);
+				__m256 bi = _mm256_loadu_ps(xi + t + half);
+				__m256 twr = _mm256_loadu_ps(wr + t);
+				__m256 twi = _mm256_loadu_ps(wi + t);
+
+				__m256 dr = _mm256_sub_ps(ar, br);
+				__m256 di = _mm256_sub_ps(ai, bi);
+				store_interleaved<span>(yr + 2 * t, _mm256_add_ps(ar, br), _mm256_fmsub_ps(dr, twr, _mm256_mul_ps(di, twi)));
+				store_interleaved<span>(yi + 2 * t, _mm256_add_ps(ai, bi), _mm256_fmadd_ps(dr, twi, _mm256_mul_ps(di, twr)));
+			}
+		}
+#endif
+	}
+
+	real_fft::real_fft(size_t size)
+		: m_size(size),
+		m_half(size / 2),
+		m_stages(),
+		m_stage_re(),
+		m_stage_im(),
+		m_split_re(),
+		m_split_im()
+	{
+		if (size < 32 || (size & (size - 1)) != 0)
+			throw std::domain_error("real_fft::real_fft(size) : size must be a power of two of at least 32");
+
+		//twiddles are worked out in double so the tables carry no more than the float rounding
+		constexpr double two_pi = 2. * std::numbers::pi;
+
+		for (size_t n = m_half, span = 1; n >= 2; n /= 2, span *= 2) {
+			m_stages.push_back({ span, m_stage_re.size() });
+			size_t repeat = span < s_vector_span ? span : 1;
+			for (size_t p = 0; p < n / 2; p++) {
+				double angle = -two_pi * double(p) / double(n);
+				for (size_t q = 0; q < repeat; q++) {
+					m_stage_re.push_back(static_cast<float>(std::cos(angle)));
+					m_stage_im.push_back(static_cast<float>(std::sin(angle)));
+				}
+			}
+		}
+
+		for (size_t k = 0; k < m_half / 2; k++) {
+			double angle = -two_pi * double(k) / double(m_size);
+			m_split_re.push_back(static_cast<float>(std::cos(angle)));
+			m_split_im.push_back(static_cast<float>(std::sin(angle)));
+		}
+	}
+
+	void real_fft::complex_forward(float* re, float* im, float* work) const noexcept
+	{
+		//every stage reads one pair of arrays and writes the other, a stage of m butterflies with span s is
+		//  y[q + 2sp] = x[q + sp] + x[q + s(p + m)]
+		//  y[q + 2sp + s] = (x[q + sp] - x[q + s(p + m)]) * w_p
+		const size_t half = m_half / 2;
+		float* xr = re;
+		float* xi = im;
+		float* yr = work;
+		float* yi = work + m_half;
+
+		for (const stage& st : m_stages) {
+			const float* wr = m_stage_re.data() + st.offset;
+			const float* wi = m_stage_im.data() + st.offset;
+			const size_t span = st.span;
+			const size_t butterflies = half / span;
+
+#if defined(AUDIO_ENGINE_AVX2)
+			if (span == 1)
+				narrow_stage<1>(xr, xi, yr, yi, wr, wi, half);
+			else if (span == 2)
+				narrow_stage<2>(xr, xi, yr, yi, wr, wi, half);
+			else if (span == 4)
+				narrow_stage<4>(xr, xi, yr, yi, wr, wi, half);
+			else {
+				for (size_t p = 0; p < butterflies; p++) {
+					__m256 twr = _mm256_set1_ps(wr[p]);
+					__m256 twi = _mm256_set1_ps(wi[p]);
+					const size_t a = span * p;
+					const size_t y = 2 * span * p;
+					for (size_t q = 0; q < span; q += 8) {
+						__m256 ar = _mm256_loadu_ps(xr + a + q);
+						__m256 ai = _mm256_loadu_ps(xi + a + q);
+						__m256 br = _mm256_loadu_ps(xr + a + half + q);
+						__m256 bi = _mm256_loadu_ps(xi + a + half + q);
+
+						__m256 dr = _mm256_sub_ps(ar, br);
+						__m256 di = _mm256_sub_ps(ai, bi);
+						_mm256_storeu_ps(yr + y + q, _mm256_add_ps(ar, br));
+						_mm256_storeu_ps(yi + y + q, _mm256_add_ps(ai, bi));
+						_mm256_storeu_ps(yr + y + span + q, _mm256_fmsub_ps(dr, twr, _mm256_mul_ps(di, twi)));
+						_mm256_storeu_ps(yi + y + span + q, _mm256_fmadd_ps(dr, twi, _mm256_mul_ps(di, twr)));
+					}
+				}
+			}
+#else
+			for (size_t p = 0; p < butterflies; p++) {
+				//the narrow stages' twiddles are repeated per element
+				float twr = wr[span < s_vector_span ? span * p : p];
+				float twi = wi[span < s_vector_span ? span * p : p];
+				const size_t a = span * p;
+				const size_t y = 2 * span * p;
+				for (size_t q = 0; q < span; q++) {
+					float ar = xr[a + q], ai = xi[a + q];
+					float br = xr[a + half + q], bi = xi[a + half + q];
+					float dr = ar - br, di = ai - bi;
+					yr[y + q] = ar + br;
+					yi[y + q] = ai + bi;
+					yr[y + span + q] = dr * twr - di * twi;
+					yi[y + span + q] = dr * twi + di * twr;
+				}
+			}
+#endif
+			std::swap(xr, yr);
+			std::swap(xi, yi);
+		}
+
+		//an odd number of stages leaves the result in the work arrays
+		if (xr != re) {
+			memcpy(re, xr, m_half * sizeof(float));
+			memcpy(im, xi, m_half * sizeof(float));
+		}
+	}
+
+	void real_fft::forward(const sample* in, float* re, float* im, float* work) const noexcept
+	{
+		const size_t half = m_half;
+		size_t n = 0;
+
+		//the even samples are the real parts and the odd samples the imaginary parts of a half size complex signal
+#if defined(AUDIO_ENGINE_AVX2)
+		for (; n < half; n += 8) {
+			__m256 lo = _mm256_loadu_ps(in + 2 * n);
+			__m256 hi = _mm256_loadu_ps(in + 2 * n + 8);
+			__m256 even = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+			__m256 odd = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm256_storeu_ps(re + n, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(even), _MM_SHUFFLE(3, 1, 2, 0))));
+			_mm256_storeu_ps(im + n, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(odd), _MM_SHUFFLE(3, 1, 2, 0))));
+		}
+#endif
+		for (; n < half; n++) {
+			re[n] = in[2 * n];
+			im[n] = in[2 * n + 1];
+		}
+
+		complex_forward(re, im, work);
+
+		//Z is the complex FFT, bins k and half - k together give the FFTs of the even (F) and odd (G) samples
+		//  F = (Z[k] + conj(Z[half - k])) / 2, G = (Z[k] - conj(Z[half - k])) / 2i
+		//  X[k] = F + W^k G, X[half - k] = conj(F - W^k G)
+		float z0r = re[0], z0i = im[0];
+		re[0] = z0r + z0i;
+		im[0] = z0r - z0i;
+		im[half / 2] = -im[half / 2];
+
+		size_t k = 1;
+#if defined(AUDIO_ENGINE_AVX2)
+		const __m256 one_half = _mm256_set1_ps(0.5f);
+		for (; k + 8 <= half / 2; k += 8) {
+			size_t mirror = half - k - 7;
+			__m256 ar = _mm256_loadu_ps(re + k);
+			__m256 ai = _mm256_loadu_ps(im + k);
+			__m256 br = reverse_lanes(_mm256_loadu_ps(re + mirror));
+			__m256 bi = reverse_lanes(_mm256_loadu_ps(im + mirror));
+			__m256 wr = _mm256_loadu_ps(m_split_re.data() + k);
+			__m256 wi = _mm256_loadu_ps(m_split_im.data() + k);
+
+			__m256 fr = _mm256_mul_ps(_mm256_add_ps(ar, br), one_half);
+			__m256 fi = _mm256_mul_ps(_mm256_sub_ps(ai, bi), one_half);
+			__m256 gr = _mm256_mul_ps(_mm256_add_ps(ai, bi), one_half);
+			__m256 gi = _mm256_mul_ps(_mm256_sub_ps(br, ar), one_half);
+			__m256 tr = _mm256_fmsub_ps(wr, gr, _mm256_mul_ps(wi, gi));
+			__m256 ti = _mm256_fmadd_ps(wr, gi, _mm256_mul_ps(wi, gr));
+
+			_mm256_storeu_ps(re + k, _mm256_add_ps(fr, tr));
+			_mm256_storeu_ps(im + k, _mm256_add_ps(fi, ti));
+			_mm256_storeu_ps(re + mirror, reverse_lanes(_mm256_sub_ps(fr, tr)));
+			_mm256_storeu_ps(im + mirror, reverse_lanes(_mm256_sub_ps(ti, fi)));
+		}
+#endif
+		for (; k < half / 2; k++) {
+			float ar = re[k], ai = im[k];
+			float br = re[half - k], bi = im[half - k];
+			float wr = m_split_re[k], wi = m_split_im[k];
+
+			float fr = 0.5f * (ar + br), fi = 0.5f * (ai - bi);
+			float gr = 0.5f * (ai + bi), gi = 0.5f * (br - ar);
+			float tr = wr * gr - wi * gi, ti = wr * gi + wi * gr;
+
+			re[k] = fr + tr;
+			im[k] = fi + ti;
+			re[half - k] = fr - tr;
+			im[half - k] = ti - fi;
+		}
+	}
+
+	void real_fft::inverse(float* re, float* im, sample* out, float* work) const noexcept
+	{
+		const size_t half = m_half;
+
+		//rebuilds the half size complex spectrum, twice over as the halves are left out
+		//  F = X[k] + conj(X[half - k]), G = (X[k] - conj(X[half - k])) W^-k
+		//  Z[k] = F + iG, Z[half - k] = conj(F) + i conj(G)
+		float dc = re[0], nyquist = im[0];
+		re[0] = dc + nyquist;
+		im[0] = dc - nyquist;
+		re[half / 2] *= 2.f;
+		im[half / 2] *= -2.f;
+
+		size_t k = 1;
+#if defined(AUDIO_ENGINE_AVX2)
+		for (; k + 8 <= half / 2; k += 8) {
+			size_t mirror = half - k - 7;
+			__m256 ar = _mm256_loadu_ps(re + k);
+			__m256 ai = _mm256_loadu_ps(im + k);
+			__m256 br = reverse_lanes(_mm256_loadu_ps(re + mirror));
+			__m256 bi = reverse_lanes(_mm256_loadu_ps(im + mirror));
+			__m256 wr = _mm256_loadu_ps(m_split_re.data() + k);
+			__m256 wi = _mm256_loadu_ps(m_split_im.data() + k);
+
+			__m256 fr = _mm256_add_ps(ar, br);
+			__m256 fi = _mm256_sub_ps(ai, bi);
+			__m256 dr = _mm256_sub_ps(ar, br);
+			__m256 di = _mm256_add_ps(ai, bi);
+			__m256 gr = _mm256_fmadd_ps(dr, wr, _mm256_mul_ps(di, wi));
+			__m256 gi = _mm256_fmsub_ps(di, wr, _mm256_mul_ps(dr, wi));
+
+			_mm256_storeu_ps(re + k, _mm256_sub_ps(fr, gi));
+			_mm256_storeu_ps(im + k, _mm256_add_ps(fi, gr));
+			_mm256_storeu_ps(re + mirror, reverse_lanes(_mm256_add_ps(fr, gi)));
+			_mm256_storeu_ps(im + mirror, reverse_lanes(_mm256_sub_ps(gr, fi)));
+		}
+#endif
+		for (; k < half / 2; k++) {
+			float ar = re[k], ai = im[k];
+			float br = re[half - k], bi = im[half - k];
+			float wr = m_split_re[k], wi = m_split_im[k];
+
+			float fr = ar + br, fi = ai - bi;
+			float dr = ar - br, di = ai + bi;
+			float gr = dr * wr + di * wi, gi = di * wr - dr * wi;
+
+			re[k] = fr - gi;
+			im[k] = fi + gr;
+			re[half - k] = fr + gi;
+			im[half - k] = gr - fi;
+		}
+
+		//with the real and imaginary parts swapped the forward FFT is the unscaled inverse
+		complex_forward(im, re, work);
+
+		size_t n = 0;
+#if defined(AUDIO_ENGINE_AVX2)
+		for (; n < half; n += 8) {
+			__m256 zr = _mm256_loadu_ps(re + n);
+			__m256 zi = _mm256_loadu_ps(im + n);
+			__m256 lo = _mm256_unpacklo_ps(zr, zi);
+			__m256 hi = _mm256_unpackhi_ps(zr, zi);
+			_mm256_storeu_ps(out + 2 * n, _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_storeu_ps(out + 2 * n + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+#endif
+		for (; n < half; n++) {
+			out[2 * n] = re[n];
+			out[2 * n + 1] = im[n];
+		}
+	}
+
+};
@@ -0,0 +1,71 @@
+#ifndef REAL_FFT_H
+#define REAL_FFT_H
+
+#include "audio_types.h"
+
+#include <vector>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// a forward and inverse FFT of size real samples, size a power of two of at least 32
+	///
+	/// the real transform is a complex FFT of half the size over the even and odd samples as real and imaginary parts, untangled into
+	/// the real spectrum afterwards. The complex FFT is a radix-2 Stockham FFT over split real and imaginary arrays, it sorts itself
+	/// so there is no bit reversal pass and every stage is a straight pass over contiguous floats. AVX2/FMA with a scalar fallback
+	///
+	/// spectra are packed into size / 2 bins of split real and imaginary parts: bins 1 .. size / 2 - 1 as they are, the real DC bin
+	/// in re[0] and the real Nyquist bin in im[0]. Neither direction is scaled, inverse(forward(x)) is size * x.
+	/// the object only holds the twiddle tables, it is const once built and can be shared by any number of threads
+	/// </summary>
+	class real_fft {
+	private:
+		size_t m_size;
+		size_t m_half; //the complex FFT size, also the number of packed bins
+
+		struct stage {
+			size_t span;   //s, the distance between the elements of a butterfly's half, doubles every stage
+			size_t offset; //the stage's twiddles in m_stage_re/m_stage_im
+		};
+		std::vector<stage> m_stages;
+		//the twiddles of each stage in the order its butterflies run, repeated per element below a span of 8 so they load as vectors
+		std::vector<float> m_stage_re;
+		std::vector<float> m_stage_im;
+		//exp(-2 pi i k / size) for k < size / 4, untangles the half size FFT into the real spectrum
+		std::vector<float> m_split_re;
+		std::vector<float> m_split_im;
+
+		void complex_forward(float* re, float* im, float* work) const noexcept;
+
+	public:
+		explicit real_fft(size_t size);
+
+		size_t size() const noexcept {
+			return m_size;
+		};
+
+		//the number of packed bins, the length of each of the re and im arrays of a spectrum
+		size_t bins() const noexcept {
+			return m_half;
+		};
+
+		/// <summary>
+		/// the spectrum of size real samples
+		/// </summary>
+		/// <param name="in">size samples</param>
+		/// <param name="re">bins() floats, the packed real parts</param>
+		/// <param name="im">bins() floats, the packed imaginary parts</param>
+		/// <param name="work">size floats of scratch</param>
+		void forward(const sample* in, float* re, float* im, float* work) const noexcept;
+
+		/// <summary>
+		/// the size real samples of a packed spectrum, size times the samples it was transformed from
+		/// the spectrum is used as scratch and left overwritten
+		/// </summary>
+		/// <param name="out">size samples, may not overlap re, im or work</param>
+		void inverse(float* re, float* im, sample* out, float* work) const noexcept;
+	};
+
+};
+
+#endif
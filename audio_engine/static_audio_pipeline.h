@@ -0,0 +1,105 @@
+#ifndef STATIC_AUDIO_PIPELINE_H
+#define STATIC_AUDIO_PIPELINE_H
+
+#include "audio_pipeline.h"
+
+#include <tuple>
+#include <memory>
+#include <type_traits>
+
+namespace audio_engine {
+
+	template <typename T, size_t BlockSize, uint32_t SampleRate>
+	struct is_stage_tuple : std::false_type {};
+
+	template <typename... S, size_t BlockSize, uint32_t SampleRate>
+	struct is_stage_tuple<std::tuple<std::unique_ptr<S>...>, BlockSize, SampleRate> : std::bool_constant<(static_stage<S, BlockSize, SampleRate> && ...)> {};
+
+	//a group of stages known at compile time, e.g std::tuple<std::unique_ptr<sine_wave_generator>>
+	//stages hold atomics and can't move, so they're held by pointer, the pointer is only ever used with its static type
+	template <typename T, size_t BlockSize = sample_block_size, uint32_t SampleRate = sample_rate>
+	concept stage_tuple = is_stage_tuple<T, BlockSize, SampleRate>::value;
+
+	template <typename Generators, typename Processors, typename Outputs>
+	struct static_stage_storage {
+		Generators m_generators;
+		Processors m_processors;
+		Outputs m_outputs;
+	};
+
+	/// <summary>
+	/// an audio_pipeline over stages whose types are fixed at compile time
+	///
+	/// every task runs the run_stage instantiated for its stage's concrete type, so process_block / process_blocks are called
+	/// directly and can be inlined into the claim loop instead of going through the pipeline_stage vtable on every run.
+	/// stages only need to satisfy static_stage, pipeline_stage subclasses work as-is with their overrides bound statically
+	///
+	/// audio_engine::static_audio_pipeline pipeline(
+	///     std::make_tuple(std::make_unique<sine_wave_generator>(1000.f)),
+	///     std::make_tuple(std::make_unique<sample_gain_stage>(2.f)),
+	///     std::make_tuple(std::make_unique<logger_stage>()),
+	///     ... buffers as for audio_pipeline
+	/// );
+	///
+	/// the format is deduced from the buffers, every stage must be a stage of that format
+	/// </summary>
+	template <typename Generators, typename Processors, typename Outputs, size_t BlockSize = sample_block_size, uint32_t SampleRate = sample_rate>
+		requires stage_tuple<Generators, BlockSize, SampleRate> && stage_tuple<Processors, BlockSize, SampleRate> && stage_tuple<Outputs, BlockSize, SampleRate>
+	class static_audio_pipeline :
+		private static_stage_storage<Generators, Processors, Outputs>, //constructed first, the stages outlive the pipeline base
+		public basic_audio_pipeline<BlockSize, SampleRate>
+	{
+	private:
+		using storage = static_stage_storage<Generators, Processors, Outputs>;
+		using pipeline = basic_audio_pipeline<BlockSize, SampleRate>;
+		using typename pipeline::stage_group;
+		using pipeline::bind_stage;
+
+		template <typename Stages>
+		static stage_group bind_tuple(Stages& stages) {
+			return std::apply([](auto&... stage) {
+				return stage_group{ bind_stage(*stage)... };
+			}, stages);
+		};
+
+	public:
+		static_audio_pipeline(
+			Generators generator_stages,
+			Processors processing_stages,
+			Outputs output_stages,
+			std::vector<basic_audio_ring_buffer<BlockSize, SampleRate>> generator_buffers,
+			std::vector<basic_audio_ring_buffer<BlockSize, SampleRate>> processing_buffers,
+			std::vector<basic_audio_ring_buffer<BlockSize, SampleRate>> output_buffers
+		)
+			:
+			storage{ std::move(generator_stages), std::move(processing_stages), std::move(output_stages) },
+			pipeline(
+				bind_tuple(this->m_generators),
+				bind_tuple(this->m_processors),
+				bind_tuple(this->m_outputs),
+				std::move(generator_buffers),
+				std::move(processing_buffers),
+				std::move(output_buffers)
+			)
+		{};
+
+		//the stages themselves, e.g to change parameters between runs
+		template <size_t I>
+		auto& generator_stage() noexcept {
+			return *std::get<I>(this->m_generators);
+		};
+
+		template <size_t I>
+		auto& processing_stage() noexcept {
+			return *std::get<I>(this->m_processors);
+		};
+
+		template <size_t I>
+		auto& output_stage() noexcept {
+			return *std::get<I>(this->m_outputs);
+		};
+	};
+
+};
+
+#endif
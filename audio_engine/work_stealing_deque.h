@@ -0,0 +1,104 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <bit>
+#include <stdexcept>
+
+namespace audio_engine {
+
+	/// <summary>
+	/// fixed capacity Chase-Lev work stealing deque of T* (Le, Pop, Cohen, Zappa Nardelli 2013 memory orderings)
+	///
+	/// the owning worker pushes and pops at the bottom (LIFO, the task it just made ready is the one whose data is still in its cache),
+	/// any other thread steals from the top (FIFO, the oldest task). Only the owner may call push and pop.
+	/// the capacity doesn't grow, callers bound the number of tasks in flight and size the deque for it
+	/// </summary>
+	template <typename T>
+	class work_stealing_deque {
+	private:
+		//top and bottom on their own cache lines, thieves hammer top while the owner works on bottom
+		alignas(64) std::atomic<int64_t> m_top;
+		alignas(64) std::atomic<int64_t> m_bottom;
+		alignas(64) std::unique_ptr<std::atomic<T*>[]> m_tasks;
+		int64_t m_mask;
+
+	public:
+		explicit work_stealing_deque(size_t capacity) :
+			m_top(0),
+			m_bottom(0),
+			m_tasks(),
+			m_mask(0)
+		{
+			if (capacity == 0)
+				throw std::domain_error("work_stealing_deque::work_stealing_deque(capacity) : capacity must be at least 1");
+
+			capacity = std::bit_ceil(capacity);
+			m_tasks = std::make_unique<std::atomic<T*>[]>(capacity);
+			m_mask = static_cast<int64_t>(capacity) - 1;
+		}
+
+		work_stealing_deque(const work_stealing_deque&) = delete;
+		work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+		//owner only, returns false if the deque is full
+		bool push(T* task) noexcept {
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			int64_t top = m_top.load(std::memory_order_acquire);
+			if (bottom - top > m_mask)
+				return false;
+
+			m_tasks[bottom & m_mask].store(task, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return true;
+		};
+
+		//owner only, the most recently pushed task or nullptr
+		T* pop() noexcept {
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_top.load(std::memory_order_relaxed);
+
+			if (top > bottom) {
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			T* task = m_tasks[bottom & m_mask].load(std::memory_order_relaxed);
+			if (top == bottom) {
+				//the last task, race the thieves for it
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					task = nullptr;
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return task;
+		};
+
+		//any thread, the oldest task or nullptr if the deque was empty or another thread won the race for it
+		T* steal() noexcept {
+			int64_t top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+			if (top >= bottom)
+				return nullptr;
+
+			T* task = m_tasks[top & m_mask].load(std::memory_order_relaxed);
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return task;
+		};
+
+		//a racy hint, used to decide whether it's worth parking
+		bool empty() const noexcept {
+			return m_bottom.load(std::memory_order_seq_cst) <= m_top.load(std::memory_order_seq_cst);
+		};
+	};
+
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace benchmarks {
+
+	struct result {
+		std::string suite;
+		std::string name;
+		std::string params;
+		uint64_t iterations;
+		double seconds;
+		double items_per_iteration;
+		std::string unit; //what an item is, e.g samples
+	};
+
+	//keeps a value alive so the optimiser can't drop the work that produced it
+	template <typename T>
+	inline void do_not_optimize(const T& value) {
+#if defined(_MSC_VER)
+		_ReadWriteBarrier();
+		(void)const_cast<volatile T&>(value);
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+
+	//each measurement runs for at least this long after one warmup iteration
+	inline constexpr std::chrono::milliseconds s_min_measure_time(200);
+
+	/// <summary>
+	/// times fn in doubling batches until s_min_measure_time has passed, so the clock is read rarely for cheap kernels
+	/// </summary>
+	/// <param name="items_per_iteration">how many units of work (samples, blocks, bytes) one call of fn performs</param>
+	template <typename F>
+	result measure(std::string suite, std::string name, std::string params, double items_per_iteration, std::string unit, F&& fn) {
+		using clock = std::chrono::steady_clock;
+
+		fn();
+
+		uint64_t iterations = 0;
+		uint64_t batch = 1;
+		auto start = clock::now();
+		clock::duration elapsed;
+		do {
+			for (uint64_t i = 0; i < batch; i++)
+				fn();
+			iterations += batch;
+			batch = batch < (uint64_t(1) << 20) ? batch * 2 : batch;
+			elapsed = clock::now() - start;
+		} while (elapsed < s_min_measure_time);
+
+		return result{
+			std::move(suite),
+			std::move(name),
+			std::move(params),
+			iterations,
+			std::chrono::duration<double>(elapsed).count(),
+			items_per_iteration,
+			std::move(unit)
+		};
+	}
+
+	//prints a result as one csv row: suite,name,params,iterations,ns_per_iteration,items_per_second,unit
+	void report(const result& r);
+
+	using suite_fn = void(*)();
+
+	struct suite {
+		const char* name;
+		suite_fn run;
+	};
+
+	std::vector<suite>& registered_suites();
+
+	//registers a suite at static init, one per benchmark translation unit
+	struct registrar {
+		registrar(const char* name, suite_fn run) {
+			registered_suites().push_back(suite{ name, run });
+		}
+	};
+
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace benchmarks {
+
+	std::vector<suite>& registered_suites() {
+		static std::vector<suite> suites;
+		return suites;
+	}
+
+	void report(const result& r) {
+		double ns_per_iteration = r.seconds * 1e9 / r.iterations;
+		double items_per_second = r.items_per_iteration * r.iterations / r.seconds;
+
+		printf("%s,%s,%s,%llu,%.3f,%.1f,%s\n",
+			r.suite.c_str(),
+			r.name.c_str(),
+			r.params.c_str(),
+			static_cast<unsigned long long>(r.iterations),
+			ns_per_iteration,
+			items_per_second,
+			r.unit.c_str()
+		);
+		fflush(stdout);
+	}
+
+};
+
+//AudioBenchmarks [suite...] runs the named suites, or every suite when none are named
+int main(int argc, char** argv)
+{
+	printf("suite,name,params,iterations,ns_per_iteration,items_per_second,unit\n");
+
+	for (auto& suite : benchmarks::registered_suites()) {
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; i++)
+			selected |= strcmp(argv[i], suite.name) == 0;
+
+		if (selected)
+			suite.run();
+	}
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include "benchmark.h"
+#include "../audio_engine/biquad_bank.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+	//the per sample cascade one filter at a time, the latency bound form the bank is read against
+	class scalar_biquads {
+	private:
+		struct section {
+			audio_engine::biquad_coefficients c;
+			float s1 = 0.f;
+			float s2 = 0.f;
+		};
+		size_t m_section_count;
+		std::vector<section> m_sections; //the cascade of each filter in turn
+
+	public:
+		scalar_biquads(size_t filter_count, size_t section_count)
+			: m_section_count(section_count),
+			m_sections(filter_count * section_count)
+		{};
+
+		void set_section(size_t filter, size_t section, const audio_engine::biquad_coefficients& coefficients) {
+			m_sections[filter * m_section_count + section].c = coefficients;
+		}
+
+		void process(const std::vector<const audio_engine::sample*>& inputs, const std::vector<audio_engine::sample*>& outputs, size_t count) {
+			for (size_t f = 0; f < inputs.size(); f++) {
+				section* cascade = m_sections.data() + f * m_section_count;
+				for (size_t i = 0; i < count; i++) {
+					float x = inputs[f][i];
+					for (size_t k = 0; k < m_section_count; k++) {
+						section& s = cascade[k];
+						float y = s.c.b0 * x + s.s1;
+						s.s1 = s.c.b1 * x + s.s2 - s.c.a1 * y;
+						s.s2 = s.c.b2 * x - s.c.a2 * y;
+						x = y;
+					}
+					outputs[f][i] = x;
+				}
+			}
+		}
+	};
+
+	//a graphic EQ per filter, bands spread log spaced from 40Hz
+	template <typename Bank>
+	void design_eq(Bank& bank, size_t filter_count, size_t section_count) {
+		for (size_t f = 0; f < filter_count; f++)
+			for (size_t k = 0; k < section_count; k++) {
+				double frequency = 40.0 * std::pow(400.0, (k + 0.5) / section_count);
+				double gain = static_cast<double>((f + k) % 7) - 3.0;
+				bank.set_section(f, k, audio_engine::biquad_coefficients::peaking(frequency, 1.4, gain));
+			}
+	}
+
+	std::string bank_params(size_t filters, size_t sections) {
+		return "filters=" + std::to_string(filters) + ";sections=" + std::to_string(sections);
+	}
+
+	void run_biquad_benchmarks() {
+		//items are section-samples, a second's worth at 48kHz is one section running in real time
+		for (auto [filters, sections] : { std::pair<size_t, size_t>(1, 8), { 8, 8 }, { 32, 8 }, { 64, 16 }, { 256, 8 } }) {
+			std::vector<std::vector<audio_engine::sample>> channels(filters, std::vector<audio_engine::sample>(audio_engine::sample_block_size));
+			std::vector<const audio_engine::sample*> inputs(filters);
+			std::vector<audio_engine::sample*> outputs(filters);
+			uint32_t noise = 0x9e3779b9u;
+			for (size_t f = 0; f < filters; f++) {
+				for (auto& s : channels[f]) {
+					noise = noise * 1664525u + 1013904223u;
+					s = static_cast<float>(noise >> 8) / 8388608.f - 1.f;
+				}
+				inputs[f] = channels[f].data();
+				outputs[f] = channels[f].data();
+			}
+			double items = double(audio_engine::sample_block_size) * filters * sections;
+
+			//filtered in place, the signal stays the same level through an EQ so the blocks never decay to denormals
+			scalar_biquads reference(filters, sections);
+			design_eq(reference, filters, sections);
+			benchmarks::report(benchmarks::measure("biquad", "scalar_reference", bank_params(filters, sections), items, "section_samples", [&] {
+				reference.process(inputs, outputs, audio_engine::sample_block_size);
+				benchmarks::do_not_optimize(channels);
+			}));
+
+			audio_engine::biquad_bank bank(filters, sections);
+			design_eq(bank, filters, sections);
+			bank.publish();
+			benchmarks::report(benchmarks::measure("biquad", "biquad_bank", bank_params(filters, sections), items, "section_samples", [&] {
+				bank.process(inputs, outputs, audio_engine::sample_block_size);
+				benchmarks::do_not_optimize(channels);
+			}));
+		}
+	}
+
+	benchmarks::registrar s_biquad_suite("biquad", &run_biquad_benchmarks);
+
+}
@@ -0,0 +1,101 @@
+#include "benchmark.h"
+#include "../audio_engine/real_fft.h"
+#include "../audio_engine/partitioned_convolver.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+	//a decaying noise tail, the shape of a reverb's impulse response
+	std::vector<audio_engine::sample> make_impulse_response(size_t length) {
+		std::vector<audio_engine::sample> response(length);
+		uint32_t noise = 0x9e3779b9u;
+		for (size_t i = 0; i < length; i++) {
+			noise = noise * 1664525u + 1013904223u;
+			float white = static_cast<float>(noise >> 8) / 8388608.f - 1.f;
+			response[i] = white * std::exp(-6.9f * static_cast<float>(i) / static_cast<float>(length));
+		}
+		return response;
+	}
+
+	//time domain convolution, one multiply-add per sample per tap, the baseline the partitioned rows are read against
+	class direct_fir {
+	private:
+		std::vector<audio_engine::sample> m_taps;
+		std::vector<audio_engine::sample> m_history; //taps - 1 samples of past input then the block being filtered
+
+	public:
+		explicit direct_fir(std::vector<audio_engine::sample> taps)
+			: m_taps(std::move(taps)),
+			m_history(m_taps.size() - 1 + audio_engine::sample_block_size)
+		{};
+
+		void process(const audio_engine::sample_block& in, audio_engine::sample_block& out) {
+			size_t past = m_taps.size() - 1;
+			std::copy(m_history.end() - past, m_history.end(), m_history.begin());
+			std::copy(in, in + audio_engine::sample_block_size, m_history.begin() + past);
+
+			for (size_t i = 0; i < audio_engine::sample_block_size; i++) {
+				float acc = 0.f;
+				const audio_engine::sample* newest = m_history.data() + past + i;
+				for (size_t k = 0; k < m_taps.size(); k++)
+					acc += m_taps[k] * newest[-static_cast<ptrdiff_t>(k)];
+				out[i] = acc;
+			}
+		}
+	};
+
+	std::string ir_params(size_t length) {
+		return "ir_ms=" + std::to_string(length * 1000 / audio_engine::sample_rate) + ";ir_samples=" + std::to_string(length);
+	}
+
+	void run_convolution_benchmarks() {
+		alignas(64) audio_engine::sample_block in{};
+		alignas(64) audio_engine::sample_block out{};
+		for (size_t i = 0; i < audio_engine::sample_block_size; i++)
+			in[i] = static_cast<float>(i % 31) / 31.f - 0.5f;
+
+		//a forward and inverse transform of one frame, the fixed part of every partitioned block
+		{
+			audio_engine::partitioned_convolver convolver(std::make_shared<const audio_engine::convolution_ir>(make_impulse_response(1), audio_engine::sample_block_size));
+			const audio_engine::real_fft& fft = convolver.get_ir().fft();
+			std::vector<float> frame(fft.size()), spectrum(fft.size()), work(fft.size());
+			for (size_t i = 0; i < fft.size(); i++)
+				frame[i] = in[i % audio_engine::sample_block_size];
+
+			benchmarks::report(benchmarks::measure("convolution", "real_fft_roundtrip", "size=" + std::to_string(fft.size()), double(fft.size()), "samples", [&] {
+				fft.forward(frame.data(), spectrum.data(), spectrum.data() + fft.bins(), work.data());
+				fft.inverse(spectrum.data(), spectrum.data() + fft.bins(), frame.data(), work.data());
+				benchmarks::do_not_optimize(frame);
+			}));
+		}
+
+		//the direct form costs a multiply-add per tap per sample, only the short responses finish in a useful time
+		for (size_t length : { size_t(480), size_t(4800) }) {
+			direct_fir fir(make_impulse_response(length));
+			benchmarks::report(benchmarks::measure("convolution", "direct_fir", ir_params(length), audio_engine::sample_block_size, "samples", [&] {
+				fir.process(in, out);
+				benchmarks::do_not_optimize(out);
+			}));
+		}
+
+		//a block's cost is the two FFTs plus a multiply-add per bin per partition, it grows with the partition count and nothing
+		//else, a 10s response is 1000 partitions
+		for (size_t length : { size_t(480), size_t(4800), size_t(48000), size_t(96000), size_t(240000), size_t(480000) }) {
+			auto ir = std::make_shared<const audio_engine::convolution_ir>(make_impulse_response(length), audio_engine::sample_block_size);
+			audio_engine::partitioned_convolver convolver(ir);
+
+			std::string params = ir_params(length) + ";partitions=" + std::to_string(ir->partition_count());
+			benchmarks::report(benchmarks::measure("convolution", "partitioned", params, audio_engine::sample_block_size, "samples", [&] {
+				convolver.process(in, out, audio_engine::sample_block_size);
+				benchmarks::do_not_optimize(out);
+			}));
+		}
+	}
+
+	benchmarks::registrar s_convolution_suite("convolution", &run_convolution_benchmarks);
+
+}
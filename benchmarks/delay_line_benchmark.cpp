@@ -0,0 +1,55 @@
+#include "benchmark.h"
+#include "../audio_engine/delay_line.h"
+
+#include <memory>
+
+namespace {
+
+	void run_delay_line_benchmarks() {
+		alignas(64) audio_engine::sample_block in{};
+		alignas(64) audio_engine::sample_block out{};
+		for (size_t i = 0; i < audio_engine::sample_block_size; i++)
+			in[i] = static_cast<float>(i % 31) / 31.f;
+
+		//the per-block cost should be flat in the delay length, it only depends on the taps
+		for (float delay_ms : { 1.f, 100.f, 5000.f }) {
+			audio_engine::delay_line line(audio_engine::to_delay_samples(std::chrono::duration<float, std::milli>(delay_ms)));
+			line.add_tap(line.get_max_delay_samples());
+
+			benchmarks::report(benchmarks::measure("delay_line", "single_tap", "delay_ms=" + std::to_string(static_cast<int>(delay_ms)), audio_engine::sample_block_size, "samples", [&] {
+				line.process(in, out, audio_engine::sample_block_size);
+				benchmarks::do_not_optimize(out);
+			}));
+		}
+
+		//a multitap echo with feedback and a fractional delay on every tap
+		for (int taps : { 4, 16 }) {
+			audio_engine::delay_line line(audio_engine::to_delay_samples(std::chrono::seconds(2)));
+			for (int i = 0; i < taps; i++)
+				line.add_tap(1000.5f + 5000.25f * i, 1.f / taps, 0.25f / taps);
+			line.set_dry(1.f);
+
+			benchmarks::report(benchmarks::measure("delay_line", "feedback_taps", "taps=" + std::to_string(taps), audio_engine::sample_block_size, "samples", [&] {
+				line.process(in, out, audio_engine::sample_block_size);
+				benchmarks::do_not_optimize(out);
+			}));
+		}
+
+		//dozens of independent 2s lines, as many delay stages would, each block visits every line once
+		constexpr int instances = 48;
+		std::vector<audio_engine::delay_line> lines;
+		for (int i = 0; i < instances; i++) {
+			lines.emplace_back(audio_engine::to_delay_samples(std::chrono::seconds(2)));
+			lines.back().add_tap(4800.f + 997.5f * i, 0.7f, 0.3f);
+		}
+
+		benchmarks::report(benchmarks::measure("delay_line", "instances", "instances=" + std::to_string(instances), double(audio_engine::sample_block_size) * instances, "samples", [&] {
+			for (auto& line : lines)
+				line.process(in, out, audio_engine::sample_block_size);
+			benchmarks::do_not_optimize(out);
+		}));
+	}
+
+	benchmarks::registrar s_delay_line_suite("delay_line", &run_delay_line_benchmarks);
+
+}
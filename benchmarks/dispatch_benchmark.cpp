@@ -0,0 +1,92 @@
+#include "benchmark.h"
+#include "../audio_engine/audio.h"
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+	constexpr int s_block_count = 96;
+
+	//does almost nothing so the rows measure the cost of getting into the stage
+	class touch_stage : public audio_engine::pipeline_stage {
+	public:
+		touch_stage() : audio_engine::pipeline_stage(1) {};
+
+		audio_engine::sample_state process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept override {
+			out_block[0] = in_block[0];
+			return 2;
+		};
+
+		void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override {};
+		void cleanup() noexcept override {};
+	};
+
+	//a real per-sample kernel, with static dispatch the loop can be inlined and vectorised at the call site
+	class gain_stage : public audio_engine::pipeline_stage {
+	public:
+		gain_stage() : audio_engine::pipeline_stage(1) {};
+
+		audio_engine::sample_state process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept override {
+			for (size_t i = 0; i < audio_engine::sample_block_size; i++)
+				out_block[i] = in_block[i] * 0.5f;
+			return 2;
+		};
+
+		void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override {};
+		void cleanup() noexcept override {};
+	};
+
+	template <typename S>
+	void dispatch_rows(const char* stage_name, audio_engine::sample_block* in, audio_engine::sample_block* out) {
+		audio_engine::pipeline_state state(0, 0, 0, audio_engine::pipeline_execution_state::EXECUTING);
+
+		//held the way audio_pipeline holds runtime stages, so the compiler can't see the dynamic type at the call
+		std::vector<std::unique_ptr<audio_engine::pipeline_stage>> dynamic_stages;
+		dynamic_stages.push_back(std::make_unique<S>());
+		audio_engine::pipeline_stage& dynamic_stage = *dynamic_stages.front();
+		S static_stage;
+
+		std::string params = std::string("stage=") + stage_name;
+
+		benchmarks::report(benchmarks::measure("dispatch", "virtual_process_block", params, s_block_count, "blocks", [&] {
+			for (int b = 0; b < s_block_count; b++)
+				benchmarks::do_not_optimize(audio_engine::stage_dispatch<audio_engine::pipeline_stage>::process_block(dynamic_stage, state, in[b], out[b], b));
+		}));
+
+		benchmarks::report(benchmarks::measure("dispatch", "static_process_block", params, s_block_count, "blocks", [&] {
+			for (int b = 0; b < s_block_count; b++)
+				benchmarks::do_not_optimize(audio_engine::stage_dispatch<S>::process_block(static_stage, state, in[b], out[b], b));
+		}));
+
+		//the pipeline's actual call, one process_blocks per claimed run of 8
+		std::array<audio_engine::sample_state, 8> states;
+		benchmarks::report(benchmarks::measure("dispatch", "virtual_process_blocks", params, s_block_count, "blocks", [&] {
+			for (int b = 0; b < s_block_count; b += 8)
+				audio_engine::stage_dispatch<audio_engine::pipeline_stage>::process_blocks(
+					dynamic_stage, state, std::span<const audio_engine::sample_block>(in + b, 8), std::span<audio_engine::sample_block>(out + b, 8), states, b);
+			benchmarks::do_not_optimize(states);
+		}));
+
+		benchmarks::report(benchmarks::measure("dispatch", "static_process_blocks", params, s_block_count, "blocks", [&] {
+			for (int b = 0; b < s_block_count; b += 8)
+				audio_engine::stage_dispatch<S>::process_blocks(
+					static_stage, state, std::span<const audio_engine::sample_block>(in + b, 8), std::span<audio_engine::sample_block>(out + b, 8), states, b);
+			benchmarks::do_not_optimize(states);
+		}));
+	}
+
+	void run_dispatch_benchmarks() {
+		auto in = std::make_unique<audio_engine::sample_block[]>(s_block_count);
+		auto out = std::make_unique<audio_engine::sample_block[]>(s_block_count);
+		for (int b = 0; b < s_block_count; b++)
+			for (size_t i = 0; i < audio_engine::sample_block_size; i++)
+				in[b][i] = static_cast<float>(i);
+
+		dispatch_rows<touch_stage>("touch", in.get(), out.get());
+		dispatch_rows<gain_stage>("gain", in.get(), out.get());
+	}
+
+	benchmarks::registrar s_dispatch_suite("dispatch", &run_dispatch_benchmarks);
+
+}
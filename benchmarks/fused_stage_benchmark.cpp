@@ -0,0 +1,57 @@
+#include "benchmark.h"
+#include "../audio_engine/audio.h"
+#include "../audio_engine/fused_stage.h"
+
+#include <memory>
+
+namespace {
+
+	//a full claimed run, the most work the pipeline hands a stage per call
+	constexpr int s_run_blocks = 8;
+
+	void run_fused_stage_benchmarks() {
+		audio_engine::pipeline_state state(0, 0, 0, audio_engine::pipeline_execution_state::EXECUTING);
+
+		auto in = std::make_unique<audio_engine::sample_block[]>(s_run_blocks);
+		auto mid = std::make_unique<audio_engine::sample_block[]>(s_run_blocks);
+		auto out = std::make_unique<audio_engine::sample_block[]>(s_run_blocks);
+		for (int b = 0; b < s_run_blocks; b++)
+			for (size_t i = 0; i < audio_engine::sample_block_size; i++)
+				in[b][i] = static_cast<float>(i % 97) / 48.f - 1.f;
+
+		std::array<audio_engine::sample_state, s_run_blocks> states;
+		auto in_span = std::span<const audio_engine::sample_block>(in.get(), s_run_blocks);
+		auto mid_span = std::span<audio_engine::sample_block>(mid.get(), s_run_blocks);
+		auto out_span = std::span<audio_engine::sample_block>(out.get(), s_run_blocks);
+		double samples = double(s_run_blocks) * audio_engine::sample_block_size;
+
+		//the same gain then clip as two stages, each making its own pass over the run
+		audio_engine::fused_stage gain(1, 2, 1, audio_engine::gain_kernel{ 2.f });
+		audio_engine::fused_stage clip(2, 3, 1, audio_engine::clip_kernel{ -1.f, 1.f });
+		benchmarks::report(benchmarks::measure("fused_stage", "separate_stages", "kernels=2", samples, "samples", [&] {
+			gain.process_blocks(state, in_span, mid_span, states, 0);
+			clip.process_blocks(state, mid_span, out_span, states, 0);
+			benchmarks::do_not_optimize(out[0][0]);
+		}));
+
+		audio_engine::fused_stage fused(1, 3, 1, audio_engine::gain_kernel{ 2.f }, audio_engine::clip_kernel{ -1.f, 1.f });
+		benchmarks::report(benchmarks::measure("fused_stage", "fused_stage", "kernels=2", samples, "samples", [&] {
+			fused.process_blocks(state, in_span, out_span, states, 0);
+			benchmarks::do_not_optimize(out[0][0]);
+		}));
+
+		//a span kernel after the sample kernels runs on the chunk while it is still in L1
+		auto normalise = [](std::span<audio_engine::sample> samples) noexcept {
+			for (auto& s : samples)
+				s *= 0.5f;
+		};
+		audio_engine::fused_stage mixed(1, 3, 1, audio_engine::gain_kernel{ 2.f }, audio_engine::clip_kernel{ -1.f, 1.f }, normalise);
+		benchmarks::report(benchmarks::measure("fused_stage", "fused_stage_with_span_kernel", "kernels=3", samples, "samples", [&] {
+			mixed.process_blocks(state, in_span, out_span, states, 0);
+			benchmarks::do_not_optimize(out[0][0]);
+		}));
+	}
+
+	benchmarks::registrar s_fused_stage_suite("fused_stage", &run_fused_stage_benchmarks);
+
+}
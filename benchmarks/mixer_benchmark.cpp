@@ -0,0 +1,55 @@
+#include "benchmark.h"
+#include "../audio_engine/mixer.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+	//a full claimed run of mono blocks, what the mixer stage hands the kernel per call
+	constexpr size_t s_run_samples = 8 * audio_engine::sample_block_size;
+
+	//one input at a time into the output, the glue a mix took before the kernel, it reads and writes the output once per input
+	void reference_mix(const std::vector<const audio_engine::sample*>& inputs, const std::vector<float>& gains, audio_engine::sample* out, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			out[i] = gains[0] * inputs[0][i];
+
+		for (size_t k = 1; k < inputs.size(); k++)
+			for (size_t i = 0; i < count; i++)
+				out[i] += gains[k] * inputs[k][i];
+	}
+
+	void run_mixer_benchmarks() {
+		//items are input samples so the rows compare the cost per input across input counts
+		for (size_t input_count : { 2, 4, 8, 16, 32, 64 }) {
+			auto samples = std::make_unique<audio_engine::sample[]>(input_count * s_run_samples);
+			for (size_t i = 0; i < input_count * s_run_samples; i++)
+				samples[i] = static_cast<float>(i % 97) / 48.f - 1.f;
+
+			std::vector<const audio_engine::sample*> inputs;
+			std::vector<float> gains;
+			for (size_t k = 0; k < input_count; k++) {
+				inputs.push_back(samples.get() + k * s_run_samples);
+				gains.push_back(1.f / static_cast<float>(k + 1));
+			}
+
+			alignas(64) std::array<audio_engine::sample, s_run_samples> out{};
+			std::string params = "inputs=" + std::to_string(input_count);
+
+			benchmarks::report(benchmarks::measure("mixer", "reference_mix", params, double(input_count * s_run_samples), "input_samples", [&] {
+				reference_mix(inputs, gains, out.data(), s_run_samples);
+				benchmarks::do_not_optimize(out);
+			}));
+
+			benchmarks::report(benchmarks::measure("mixer", "mix", params, double(input_count * s_run_samples), "input_samples", [&] {
+				audio_engine::mix(inputs, gains, out.data(), s_run_samples);
+				benchmarks::do_not_optimize(out);
+			}));
+		}
+	}
+
+	benchmarks::registrar s_mixer_suite("mixer", &run_mixer_benchmarks);
+
+}
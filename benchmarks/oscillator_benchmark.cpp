@@ -0,0 +1,67 @@
+#include "benchmark.h"
+#include "../sine_wave_generator.h"
+#include "../audio_engine/oscillator_bank.h"
+
+#include <cmath>
+#include <numbers>
+
+namespace {
+
+	//the per-sample sinf generator sine_wave_generator shipped with before the oscillator bank, kept as the baseline
+	constexpr int cexpr_ceil(float in) {
+		int truncated = (int)in;
+		return (in - truncated >= 0.5) ? truncated + 1 : truncated;
+	}
+
+	void reference_sine_block(float freq, audio_engine::sample_block& out_block, int block_count) {
+		for (uint64_t i = 0; i < audio_engine::sample_block_size; i++)
+		{
+			uint64_t i_sample = audio_engine::sample_block_size * block_count + i;
+
+			auto ceil = cexpr_ceil(audio_engine::sample_rate / freq);
+
+			float time = (i_sample % ceil) / (float)audio_engine::sample_rate;
+
+			out_block[i] = std::sin(time * freq * 2 * std::numbers::pi_v<float>);
+		}
+	}
+
+	void run_oscillator_benchmarks() {
+		alignas(64) audio_engine::sample_block block{};
+		audio_engine::pipeline_state state(0, 0, 0, audio_engine::pipeline_execution_state::EXECUTING);
+		int block_count = 0;
+
+		benchmarks::report(benchmarks::measure("oscillator", "reference_sinf", "oscillators=1", audio_engine::sample_block_size, "samples", [&] {
+			reference_sine_block(1000.f, block, block_count++);
+			benchmarks::do_not_optimize(block);
+		}));
+
+		sine_wave_generator generator(1000.f);
+		benchmarks::report(benchmarks::measure("oscillator", "sine_wave_generator", "oscillators=1", audio_engine::sample_block_size, "samples", [&] {
+			generator.process_block(state, block, block, block_count++);
+			benchmarks::do_not_optimize(block);
+		}));
+
+		//items are oscillator-samples so the per-oscillator cost compares directly with the single sine rows above
+		for (int oscillators : { 1, 16, 128, 512 }) {
+			audio_engine::oscillator_bank bank;
+			for (int i = 0; i < oscillators; i++)
+				bank.add_oscillator(55.f + 37.3f * i, 1.f / oscillators);
+
+			benchmarks::report(benchmarks::measure(
+				"oscillator",
+				"oscillator_bank",
+				"oscillators=" + std::to_string(oscillators),
+				double(audio_engine::sample_block_size) * oscillators,
+				"oscillator_samples",
+				[&] {
+					bank.render(block, audio_engine::sample_block_size, uint64_t(block_count++) * audio_engine::sample_block_size);
+					benchmarks::do_not_optimize(block);
+				}
+			));
+		}
+	}
+
+	benchmarks::registrar s_oscillator_suite("oscillator", &run_oscillator_benchmarks);
+
+}
@@ -0,0 +1,274 @@
+#include "benchmark.h"
+#include "../audio_engine/audio.h"
+#include "../audio_engine/fused_stage.h"
+#include "../oscillator_bank_generator.h"
+#include "../delay_stage.h"
+#include "../mixer_stage.h"
+#include "../convolution_stage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+
+namespace {
+
+	//~8s of audio per render, long enough that starting and stopping the pool is noise
+	constexpr uint64_t s_render_blocks = 96 * 8;
+
+	constexpr size_t s_buffer_blocks = 96;
+
+	//the same audio rendered at every block size, so the format rows compare the per block overhead rather than the work
+	constexpr uint64_t s_render_samples = uint64_t(audio_engine::sample_rate) * 8;
+
+	template <size_t BlockSize>
+	using format_stage = audio_engine::basic_pipeline_stage<BlockSize, audio_engine::sample_rate>;
+
+	//consumes the output without doing anything with it so the rows measure the pipeline rather than a sink
+	template <size_t BlockSize = audio_engine::sample_block_size>
+	class null_sink_stage : public format_stage<BlockSize> {
+	public:
+		using typename format_stage<BlockSize>::sample_block;
+		using typename format_stage<BlockSize>::audio_ring_buffer;
+
+		null_sink_stage(uint8_t thread_count) : format_stage<BlockSize>(3, thread_count) {};
+
+		audio_engine::sample_state process_block(const audio_engine::pipeline_state& state, const sample_block& in_block, sample_block& out_block, int block_count) noexcept override {
+			benchmarks::do_not_optimize(in_block[0]);
+			return audio_engine::sample_block_state_default; //hands the block back to be refilled, as the shipped output stages do
+		};
+
+		void init(std::vector<audio_ring_buffer>& buffers) override {};
+		void cleanup() noexcept override {};
+	};
+
+	//oscillator_bank_generator at any block size, the bank itself renders any number of samples
+	template <size_t BlockSize>
+	class bank_generator_stage : public format_stage<BlockSize> {
+	private:
+		audio_engine::oscillator_bank m_bank;
+
+	public:
+		using typename format_stage<BlockSize>::sample_block;
+		using typename format_stage<BlockSize>::audio_ring_buffer;
+
+		bank_generator_stage(audio_engine::oscillator_bank bank, uint8_t thread_count) :
+			format_stage<BlockSize>(audio_engine::sample_block_state_default, thread_count),
+			m_bank(std::move(bank))
+		{};
+
+		audio_engine::sample_state process_block(const audio_engine::pipeline_state& state, const sample_block& in_block, sample_block& out_block, int block_count) noexcept override {
+			m_bank.render(out_block, BlockSize, uint64_t(block_count) * BlockSize);
+			return audio_engine::sample_block_state_processed;
+		};
+
+		void process_blocks(
+			const audio_engine::pipeline_state& state,
+			std::span<const sample_block> in_blocks,
+			std::span<sample_block> out_blocks,
+			std::span<audio_engine::sample_state> out_states,
+			int block_count
+		) noexcept override {
+			m_bank.render(out_blocks.front(), out_blocks.size() * BlockSize, uint64_t(block_count) * BlockSize);
+			std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+		};
+
+		void init(std::vector<audio_ring_buffer>& buffers) override {};
+		void cleanup() noexcept override {};
+	};
+
+	//enough oscillators that generating is the bulk of the work and has something to spread over the workers
+	audio_engine::oscillator_bank make_bank() {
+		audio_engine::oscillator_bank bank;
+		for (int i = 0; i < 32; i++)
+			bank.add_oscillator(55.f * (i + 1), 1.f / 32);
+		return bank;
+	}
+
+	std::unique_ptr<audio_engine::pipeline_stage> make_generator(uint8_t thread_count) {
+		return std::unique_ptr<audio_engine::pipeline_stage>(new oscillator_bank_generator(make_bank(), thread_count));
+	}
+
+	//every stage stateless and allowed on every worker
+	audio_engine::audio_pipeline make_parallel_pipeline(uint8_t workers) {
+		return audio_engine::audio_pipeline(
+			audio_engine::make_vector(make_generator(workers)),
+			audio_engine::make_vector(
+				std::unique_ptr<audio_engine::pipeline_stage>(new audio_engine::fused_stage(
+					1, audio_engine::sample_block_state_processed, workers,
+					audio_engine::gain_kernel{ 2.f },
+					audio_engine::clip_kernel{ -1.f, 1.f }
+				))
+			),
+			audio_engine::make_vector(std::unique_ptr<audio_engine::pipeline_stage>(new null_sink_stage<>(workers))),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks)),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks)),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks))
+		);
+	}
+
+	//main's layout, the ordered delay stage runs on one worker at a time and bounds how far the rest can scale
+	audio_engine::audio_pipeline make_delay_pipeline(uint8_t workers) {
+		return audio_engine::audio_pipeline(
+			audio_engine::make_vector(make_generator(workers)),
+			audio_engine::make_vector(
+				std::unique_ptr<audio_engine::pipeline_stage>(new audio_engine::fused_stage(
+					1, 2, workers,
+					audio_engine::gain_kernel{ 2.f },
+					audio_engine::clip_kernel{ -1.f, 1.f }
+				)),
+				std::unique_ptr<audio_engine::pipeline_stage>(new delay_stage(std::chrono::milliseconds(100)))
+			),
+			audio_engine::make_vector(std::unique_ptr<audio_engine::pipeline_stage>(new null_sink_stage<>(workers))),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks)),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks), audio_engine::audio_ring_buffer(s_buffer_blocks)),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks))
+		);
+	}
+
+	//the delay topology as a graph with the delay fanned out over independent branches mixed back down, each branch's ordered
+	//delay can run on its own worker so this scales where the single delay chain can't
+	audio_engine::audio_pipeline make_branch_pipeline(uint8_t workers) {
+		constexpr uint8_t branches = 4;
+
+		audio_engine::pipeline_graph graph;
+		auto source = graph.add_node(make_generator(workers), audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks)));
+
+		//a buffer per branch and one for the mix
+		std::vector<audio_engine::audio_ring_buffer> mix_buffers;
+		for (uint8_t b = 0; b <= branches; b++)
+			mix_buffers.emplace_back(s_buffer_blocks);
+		auto mix = graph.add_node(std::unique_ptr<audio_engine::pipeline_stage>(new mixer_stage(std::vector<float>(branches, 1.f / branches), workers)), std::move(mix_buffers));
+
+		auto sink = graph.add_node(std::unique_ptr<audio_engine::pipeline_stage>(new null_sink_stage<>(workers)), audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks)));
+		graph.connect(mix, sink);
+
+		for (uint8_t b = 0; b < branches; b++) {
+			auto branch = graph.add_node(
+				audio_engine::make_vector(
+					std::unique_ptr<audio_engine::pipeline_stage>(new audio_engine::fused_stage(
+						1, 2, workers,
+						audio_engine::gain_kernel{ 2.f },
+						audio_engine::clip_kernel{ -1.f, 1.f }
+					)),
+					std::unique_ptr<audio_engine::pipeline_stage>(new delay_stage(std::chrono::milliseconds(100 + 10 * b)))
+				),
+				audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks), audio_engine::audio_ring_buffer(s_buffer_blocks))
+			);
+			graph.connect(source, branch);
+			graph.connect(branch, mix, b);
+		}
+
+		return audio_engine::audio_pipeline(std::move(graph));
+	}
+
+	//main's layout over 8 channels with a 1s convolution reverb in the delay's place, the reverb is ordered but runs its channels
+	//on up to workers workers at once, each channel still in block order
+	audio_engine::audio_pipeline make_reverb_pipeline(uint8_t workers) {
+		constexpr size_t channels = 8;
+
+		std::vector<audio_engine::sample> response(audio_engine::sample_rate);
+		for (size_t i = 0; i < response.size(); i++)
+			response[i] = std::exp(-6.9f * static_cast<float>(i) / static_cast<float>(response.size())) * ((i * 7919) % 13 < 6 ? 0.01f : -0.01f);
+
+		return audio_engine::audio_pipeline(
+			audio_engine::make_vector(make_generator(workers)),
+			audio_engine::make_vector(
+				std::unique_ptr<audio_engine::pipeline_stage>(new audio_engine::fused_stage(
+					1, 2, workers,
+					audio_engine::gain_kernel{ 2.f },
+					audio_engine::clip_kernel{ -1.f, 1.f }
+				)),
+				std::unique_ptr<audio_engine::pipeline_stage>(new convolution_stage(std::move(response), 1.f, workers))
+			),
+			audio_engine::make_vector(std::unique_ptr<audio_engine::pipeline_stage>(new null_sink_stage<>(workers))),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks, channels)),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks, channels), audio_engine::audio_ring_buffer(s_buffer_blocks, channels)),
+			audio_engine::make_vector(audio_engine::audio_ring_buffer(s_buffer_blocks, channels))
+		);
+	}
+
+	//the parallel topology at another block size, a pipeline type of its own alongside the default format ones
+	template <size_t BlockSize>
+	audio_engine::basic_audio_pipeline<BlockSize, audio_engine::sample_rate> make_format_pipeline(uint8_t workers) {
+		using pipeline_t = audio_engine::basic_audio_pipeline<BlockSize, audio_engine::sample_rate>;
+		using stage_ptr = std::unique_ptr<typename pipeline_t::pipeline_stage>;
+		using buffer_t = typename pipeline_t::audio_ring_buffer;
+
+		return pipeline_t(
+			audio_engine::make_vector(stage_ptr(new bank_generator_stage<BlockSize>(make_bank(), workers))),
+			audio_engine::make_vector(
+				stage_ptr(new audio_engine::basic_fused_stage<BlockSize, audio_engine::sample_rate, audio_engine::gain_kernel, audio_engine::clip_kernel>(
+					1, audio_engine::sample_block_state_processed, workers,
+					audio_engine::gain_kernel{ 2.f },
+					audio_engine::clip_kernel{ -1.f, 1.f }
+				))
+			),
+			audio_engine::make_vector(stage_ptr(new null_sink_stage<BlockSize>(workers))),
+			audio_engine::make_vector(buffer_t()),
+			audio_engine::make_vector(buffer_t()),
+			audio_engine::make_vector(buffer_t())
+		);
+	}
+
+	/// <summary>
+	/// renders the pipeline make_pipeline builds at 1 to 8 workers
+	/// </summary>
+	/// <param name="render_blocks">the blocks each render produces</param>
+	/// <param name="block_size">the samples per block for the block size rows, which are reported in samples so they compare, 0 for blocks</param>
+	template <typename F>
+	void render_rows(const char* topology, F&& make_pipeline, uint64_t render_blocks = s_render_blocks, size_t block_size = 0) {
+		bool per_sample = block_size != 0;
+		for (uint8_t workers : { 1, 2, 4, 8 }) {
+			std::string params = std::string("topology=") + topology + ";workers=" + std::to_string(workers) + ";hardware_threads=" + std::to_string(std::thread::hardware_concurrency());
+			if (per_sample)
+				params += ";block_size=" + std::to_string(block_size);
+
+			//each render is a full run so the pipeline is rebuilt for every iteration, outside of what the render is timed over
+			uint64_t iterations = 0;
+			std::chrono::nanoseconds elapsed(0);
+			uint64_t blocks = 0;
+			while (elapsed < benchmarks::s_min_measure_time) {
+				auto pipeline = make_pipeline(workers);
+				pipeline.set_worker_count(workers);
+				auto stats = pipeline.render_offline(render_blocks);
+				elapsed += stats.elapsed;
+				blocks = stats.blocks;
+				iterations++;
+			}
+
+			benchmarks::report(benchmarks::result{
+				"pipeline",
+				"render_offline",
+				std::move(params),
+				iterations,
+				std::chrono::duration<double>(elapsed).count(),
+				per_sample ? double(blocks * block_size) : double(blocks),
+				per_sample ? "samples" : "blocks"
+			});
+		}
+	}
+
+	template <size_t BlockSize>
+	void format_rows() {
+		render_rows("parallel", &make_format_pipeline<BlockSize>, s_render_samples / BlockSize, BlockSize);
+	}
+
+	void run_pipeline_benchmarks() {
+		render_rows("parallel", &make_parallel_pipeline);
+		render_rows("delay", &make_delay_pipeline);
+		render_rows("branches4", &make_branch_pipeline);
+		render_rows("reverb8ch", &make_reverb_pipeline);
+
+		//low latency and batch block sizes, each its own instantiation of the engine in this one binary
+		format_rows<64>();
+		format_rows<audio_engine::sample_block_size>();
+		format_rows<4096>();
+	}
+
+	benchmarks::registrar s_pipeline_suite("pipeline", &run_pipeline_benchmarks);
+
+}
@@ -0,0 +1,176 @@
+#include "benchmark.h"
+#include "../audio_engine/audio_ring_buffer.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+	void fill_samples(audio_engine::audio_ring_buffer& buffer) {
+		for (size_t b = 0; b < buffer.m_block_count; b++)
+			for (size_t i = 0; i < audio_engine::sample_block_size; i++)
+				buffer.get_block(static_cast<int>(b))[i] = static_cast<float>((b + i) % 113) / 113.f;
+	}
+
+	void copy_rows() {
+		//96 blocks is the 1s buffer main uses, 4096 blocks (~7.5MB) is past the streaming store threshold and the last level cache
+		for (size_t block_count : { 16, 96, 4096 }) {
+			audio_engine::audio_ring_buffer from(block_count);
+			audio_engine::audio_ring_buffer to(block_count);
+			fill_samples(from);
+
+			std::string params = "blocks=" + std::to_string(block_count);
+			double bytes = double(block_count) * sizeof(audio_engine::sample_block);
+
+			benchmarks::report(benchmarks::measure("ring_buffer", "copy_to", params, bytes, "bytes", [&] {
+				from.copy_to(to);
+				benchmarks::do_not_optimize(to.get_block(0)[0]);
+			}));
+
+			//a whole buffer's worth starting mid-block, so both the samples and the states wrap
+			uint32_t samples = static_cast<uint32_t>(block_count * audio_engine::sample_block_size);
+			uint32_t start = static_cast<uint32_t>(audio_engine::sample_block_size * block_count / 2 + 7);
+			benchmarks::report(benchmarks::measure("ring_buffer", "copy_slice_to_wrapped", params, bytes, "bytes", [&] {
+				from.copy_slice_to(to, start, start, samples);
+				benchmarks::do_not_optimize(to.get_block(0)[0]);
+			}));
+
+			//the single block a delay-style stage moves at a time
+			benchmarks::report(benchmarks::measure("ring_buffer", "copy_slice_to_block", params, double(sizeof(audio_engine::sample_block)), "bytes", [&] {
+				from.copy_slice_to(to, 0, audio_engine::sample_block_size, audio_engine::sample_block_size);
+				benchmarks::do_not_optimize(to.get_block(1)[0]);
+			}));
+		}
+	}
+
+	//the same large copy out of buffers backed by each page size, huge pages take the TLB misses of a 7.5MB stream out of the copy
+	void page_rows() {
+		constexpr size_t block_count = 4096;
+		double bytes = double(block_count) * sizeof(audio_engine::sample_block);
+
+		for (auto [mode, name] : { std::pair{ audio_engine::huge_page_mode::none, "none" }, std::pair{ audio_engine::huge_page_mode::transparent, "transparent" }, std::pair{ audio_engine::huge_page_mode::reserved, "reserved" } }) {
+			audio_engine::buffer_memory_policy policy;
+			policy.huge_pages = mode;
+			audio_engine::audio_ring_buffer from(block_count, 1, policy);
+			audio_engine::audio_ring_buffer to(block_count, 1, policy);
+			fill_samples(from);
+
+			std::string params = "blocks=" + std::to_string(block_count) + ";huge_pages=" + name;
+			benchmarks::report(benchmarks::measure("ring_buffer", "copy_to", params, bytes, "bytes", [&] {
+				from.copy_to(to);
+				benchmarks::do_not_optimize(to.get_block(0)[0]);
+			}));
+		}
+	}
+
+	void scan_rows() {
+		for (size_t block_count : { 96, 1024, 16384 }) {
+			audio_engine::audio_ring_buffer buffer(block_count);
+			std::string params = "blocks=" + std::to_string(block_count);
+
+			//worst case for the byte scans, the only block that differs is the last one
+			buffer.fill_states(audio_engine::sample_block_state_default);
+			buffer.store_state(static_cast<int>(block_count - 1), 1);
+
+			benchmarks::report(benchmarks::measure("ring_buffer", "get_first_match_idx", params, double(block_count), "blocks", [&] {
+				benchmarks::do_not_optimize(buffer.get_first_match_idx(1));
+			}));
+
+			benchmarks::report(benchmarks::measure("ring_buffer", "get_first_nonmatch_idx", params, double(block_count), "blocks", [&] {
+				benchmarks::do_not_optimize(buffer.get_first_nonmatch_idx(audio_engine::sample_block_state_default));
+			}));
+
+			//the occupancy bitmap search the workers use, for comparison
+			benchmarks::report(benchmarks::measure("ring_buffer", "find_state", params, double(block_count), "blocks", [&] {
+				benchmarks::do_not_optimize(buffer.find_state(1));
+			}));
+		}
+	}
+
+	/// <summary>
+	/// the claim and publish traffic of one stage run by every thread at once: find a run in the entry state from the stage's
+	/// shared cursor, claim it, publish it back into the entry state so there is always more. The samples aren't touched so the
+	/// rows are the cost of the state table alone, per layout and thread count
+	/// </summary>
+	void state_scaling_rows() {
+		constexpr size_t block_count = 256;
+		constexpr uint64_t claims_per_thread = 1 << 16;
+		constexpr audio_engine::sample_state entry_state = 1;
+
+		unsigned max_threads = std::max(8u, std::thread::hardware_concurrency());
+		for (auto [layout, name] : { std::pair{ audio_engine::state_layout::packed, "packed" }, std::pair{ audio_engine::state_layout::strided, "strided" } }) {
+			for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+				audio_engine::audio_ring_buffer buffer(block_count, 1, audio_engine::ring_buffer_allocator_t(), layout);
+				buffer.fill_states(entry_state);
+
+				std::atomic<size_t> cursor{ 0 };
+				std::atomic<uint64_t> blocks{ 0 };
+				std::atomic<bool> go{ false };
+
+				auto worker = [&] {
+					std::array<audio_engine::sample_state, 8> published;
+					published.fill(entry_state);
+					uint64_t claimed_blocks = 0;
+
+					while (!go.load(std::memory_order_acquire)) {}
+					for (uint64_t i = 0; i < claims_per_thread; i++) {
+						int idx = buffer.find_state(entry_state, cursor.load(std::memory_order_relaxed));
+						if (idx == -1)
+							continue;
+
+						int claimed = buffer.claim_run(idx, entry_state, audio_engine::sample_block_state_processing, static_cast<int>(published.size()));
+						if (claimed == 0)
+							continue;
+
+						cursor.store((idx + claimed) % block_count, std::memory_order_relaxed);
+						buffer.store_run(idx, std::span<const audio_engine::sample_state>(published.data(), claimed));
+						claimed_blocks += claimed;
+					}
+					blocks.fetch_add(claimed_blocks);
+				};
+
+				//a round is one batch of claims per thread, repeated until it adds up to the usual measuring time
+				uint64_t iterations = 0;
+				std::chrono::nanoseconds elapsed(0);
+				while (elapsed < benchmarks::s_min_measure_time) {
+					std::vector<std::jthread> pool;
+					for (unsigned t = 0; t < threads; t++)
+						pool.emplace_back(worker);
+
+					auto start = std::chrono::steady_clock::now();
+					go.store(true, std::memory_order_release);
+					pool.clear();
+					elapsed += std::chrono::steady_clock::now() - start;
+					go.store(false);
+					iterations++;
+				}
+
+				std::string params = std::string("layout=") + name + ";threads=" + std::to_string(threads) + ";hardware_threads=" + std::to_string(std::thread::hardware_concurrency());
+				benchmarks::report(benchmarks::result{
+					"ring_buffer",
+					"claim_publish",
+					std::move(params),
+					iterations,
+					std::chrono::duration<double>(elapsed).count(),
+					double(blocks.load()) / iterations,
+					"blocks"
+				});
+			}
+		}
+	}
+
+	void run_ring_buffer_benchmarks() {
+		copy_rows();
+		page_rows();
+		scan_rows();
+		state_scaling_rows();
+	}
+
+	benchmarks::registrar s_ring_buffer_suite("ring_buffer", &run_ring_buffer_benchmarks);
+
+}
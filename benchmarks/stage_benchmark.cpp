@@ -0,0 +1,169 @@
+#include "benchmark.h"
+#include "../audio_engine/audio.h"
+#include "../audio_engine/fused_stage.h"
+#include "../audio_engine/pcm_file_writer.h"
+#include "../sine_wave_generator.h"
+#include "../oscillator_bank_generator.h"
+#include "../sample_gain_stage.h"
+#include "../delay_stage.h"
+#include "../logger_stage.h"
+#include "../dumpPCM_stage.h"
+#include "../pcm_file_generator.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <ostream>
+#include <memory>
+#include <string>
+#include <cstdio>
+#include <type_traits>
+
+namespace {
+
+	//a full claimed run, the most work the pipeline hands a stage per call
+	constexpr int s_run_blocks = 8;
+
+	//enough distinct blocks that the input isn't one run sitting in L1 the whole time
+	constexpr int s_input_blocks = 96;
+
+	//the widest rows, every stage is also run on a block of this many channels
+	constexpr size_t s_max_channels = 8;
+
+	//the length of the file the file generator reads, ~4MB so it streams from the mapping rather than cache
+	constexpr int s_file_blocks = 2048;
+
+#if defined(_WIN32)
+	constexpr const char* s_null_device = "NUL";
+#else
+	constexpr const char* s_null_device = "/dev/null";
+#endif
+
+	//swallows everything written to it so the logger rows measure formatting rather than the terminal
+	class null_buffer : public std::streambuf {
+	protected:
+		int overflow(int c) override {
+			return c;
+		};
+		std::streamsize xsputn(const char*, std::streamsize count) override {
+			return count;
+		};
+	};
+
+	//the work the rows count as lost, none for every stage but the output ones
+	struct no_drops {
+		uint64_t operator()() const noexcept {
+			return 0;
+		};
+	};
+
+	/// <summary>
+	/// times one stage the way a pool worker calls it, a run of s_run_blocks through static dispatch with the block number advancing
+	/// so temporal stages (oscillators, the delay line, the file reader) see a continuous stream
+	/// </summary>
+	/// <param name="channels">the channels of every block, the stage is initialised with buffers of this many channels</param>
+	/// <param name="block_period">wraps the block number, keeps the file reader inside the file rather than reading silence past its end</param>
+	/// <param name="dropped">the blocks the stage has dropped since init, for a stage that hands blocks off and drops them when full</param>
+	template <typename S, typename Dropped = no_drops>
+	void stage_row(const char* name, std::string params, S& stage, audio_engine::sample_block* in, audio_engine::sample_block* out, size_t channels = 1, int block_period = 1 << 30, Dropped dropped = {}) {
+		audio_engine::pipeline_state state(0, 0, 0, audio_engine::pipeline_execution_state::EXECUTING);
+		auto buffers = audio_engine::make_vector(audio_engine::audio_ring_buffer(16, channels), audio_engine::audio_ring_buffer(16, channels));
+		audio_engine::stage_dispatch<S>::init(stage, buffers);
+
+		params += (params.empty() ? "" : ";") + std::string("channels=") + std::to_string(channels);
+		size_t planes = s_run_blocks * channels;
+
+		std::array<audio_engine::sample_state, s_run_blocks> states;
+		int block_count = 0;
+		benchmarks::result r = benchmarks::measure("stages", name, std::move(params), double(planes) * audio_engine::sample_block_size, "samples", [&] {
+			size_t first = (block_count % s_input_blocks) * channels;
+			audio_engine::stage_dispatch<S>::process_blocks(
+				stage,
+				state,
+				std::span<const audio_engine::sample_block>(in + first, planes),
+				std::span<audio_engine::sample_block>(out + first, planes),
+				states,
+				block_count
+			);
+			block_count = (block_count + s_run_blocks) % block_period;
+			benchmarks::do_not_optimize(out[first][0]);
+		});
+
+		//only the blocks that made it through the hand off count, the time spent turning the rest away is still in the row.
+		//measure runs one warmup call before the timed ones and the drop count covers it too
+		if constexpr (!std::is_same_v<Dropped, no_drops>) {
+			double submitted = double(r.iterations + 1) * double(planes);
+			double lost = std::min(double(dropped()), submitted);
+			char percent[32];
+			std::snprintf(percent, sizeof(percent), "%.2f", 100.0 * lost / submitted);
+			r.params += ";dropped_pct=" + std::string(percent);
+			r.items_per_iteration *= (submitted - lost) / submitted;
+		}
+		benchmarks::report(r);
+
+		audio_engine::stage_dispatch<S>::cleanup(stage);
+	}
+
+	std::string make_source_file(const audio_engine::sample_block* blocks) {
+		std::string path = (std::filesystem::temp_directory_path() / "audio_benchmarks_source.wav").string();
+		audio_engine::pcm_file_writer writer;
+		writer.open(path);
+		for (int b = 0; b < s_file_blocks; b++)
+			while (!writer.submit(b, blocks[b % s_input_blocks])) {}
+		writer.close();
+		return path;
+	}
+
+	void run_stage_benchmarks() {
+		size_t planes = s_input_blocks * s_max_channels;
+		auto in = std::make_unique<audio_engine::sample_block[]>(planes);
+		auto out = std::make_unique<audio_engine::sample_block[]>(planes);
+		for (size_t b = 0; b < planes; b++)
+			for (size_t i = 0; i < audio_engine::sample_block_size; i++)
+				in[b][i] = static_cast<float>((b * audio_engine::sample_block_size + i) % 97) / 48.f - 1.f;
+
+		for (size_t channels : { size_t(1), s_max_channels }) {
+			sine_wave_generator sine(1000.f);
+			stage_row("sine_wave_generator", "oscillators=1", sine, in.get(), out.get(), channels);
+
+			audio_engine::oscillator_bank bank;
+			for (int i = 0; i < 16; i++)
+				bank.add_oscillator(110.f * (i + 1), 1.f / 16);
+			oscillator_bank_generator oscillators(std::move(bank));
+			stage_row("oscillator_bank_generator", "oscillators=16", oscillators, in.get(), out.get(), channels);
+
+			sample_gain_stage gain(2.f);
+			stage_row("sample_gain_stage", "", gain, in.get(), out.get(), channels);
+
+			audio_engine::fused_stage fused(1, 2, 1, audio_engine::gain_kernel{ 2.f }, audio_engine::clip_kernel{ -2.f, 2.f });
+			stage_row("fused_stage", "kernels=gain+clip", fused, in.get(), out.get(), channels);
+
+			delay_stage delay(std::chrono::milliseconds(100));
+			stage_row("delay_stage", "delay_ms=100", delay, in.get(), out.get(), channels);
+		}
+
+		//the output stages hand their blocks to a background thread and drop what it can't keep up with rather than wait. Run flat
+		//out the stage outpaces that thread and most blocks are turned away, so these rows count the accepted blocks only and give
+		//the share dropped: the rate is what the stage and its thread together get out, not the cost of a rejection
+		null_buffer discard;
+		std::ostream null_stream(&discard);
+		logger_stage sample_logger(audio_engine::block_log_mode::samples, 1, null_stream);
+		stage_row("logger_stage", "mode=samples", sample_logger, in.get(), out.get(), 1, 1 << 30, [&] { return sample_logger.dropped_records(); });
+
+		logger_stage summary_logger(audio_engine::block_log_mode::summary, 1, null_stream);
+		stage_row("logger_stage", "mode=summary", summary_logger, in.get(), out.get(), 1, 1 << 30, [&] { return summary_logger.dropped_records(); });
+
+		dumpPCM_stage dump(s_null_device);
+		stage_row("dumpPCM_stage", "file=null_device", dump, in.get(), out.get(), 1, 1 << 30, [&] { return dump.dropped_blocks(); });
+
+		std::string source_path = make_source_file(in.get());
+		{
+			pcm_file_generator file(source_path);
+			stage_row("pcm_file_generator", "encoding=float32", file, in.get(), out.get(), 1, s_file_blocks);
+		}
+		std::error_code ignored;
+		std::filesystem::remove(source_path, ignored);
+	}
+
+	benchmarks::registrar s_stage_suite("stages", &run_stage_benchmarks);
+
+}
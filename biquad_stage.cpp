@@ -0,0 +1,81 @@
+#include "biquad_stage.h"
+#include "audio_engine/audio_types.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+biquad_stage::biquad_stage(size_t channel_count, const std::vector<audio_engine::biquad_coefficients>& cascade)
+    : audio_engine::pipeline_stage(2, 1, 0, 1, 0, true), //filters the processed blocks of buffer 0 into buffer 1 (a channel per filter), in block order as the filters carry state over
+    m_bank(channel_count, cascade.size()),
+    m_inputs(channel_count),
+    m_outputs(channel_count),
+    m_block_channel(0)
+{
+    for (size_t c = 0; c < channel_count; c++)
+        for (size_t k = 0; k < cascade.size(); k++)
+            m_bank.set_section(c, k, cascade[k]);
+    m_bank.publish();
+}
+
+void biquad_stage::set_section(size_t channel, size_t section, const audio_engine::biquad_coefficients& coefficients)
+{
+    m_bank.set_section(channel, section, coefficients);
+}
+
+void biquad_stage::publish() noexcept
+{
+    m_bank.publish();
+}
+
+audio_engine::sample_state biquad_stage::process_block(
+    const audio_engine::pipeline_state& state,
+    const audio_engine::sample_block& in_block,
+    audio_engine::sample_block& out_block,
+    int block_count
+)
+noexcept
+{
+    //the channels of a block come through one after another (see process_run_by_block), the bank runs the block once it has every
+    //filter's channel so each filter only ever hears its own
+    m_inputs[m_block_channel] = in_block;
+    m_outputs[m_block_channel] = out_block;
+    if (++m_block_channel == m_bank.filter_count()) {
+        m_bank.process(m_inputs, m_outputs, audio_engine::sample_block_size);
+        m_block_channel = 0;
+    }
+    return audio_engine::sample_block_state_processed;
+}
+
+void biquad_stage::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    size_t in_channels = in_blocks.size() / out_states.size();
+    size_t out_channels = out_blocks.size() / out_states.size();
+    for (size_t i = 0; i < out_states.size(); i++) {
+        for (size_t c = 0; c < out_channels; c++) {
+            m_inputs[c] = in_blocks[i * in_channels + std::min(c, in_channels - 1)];
+            m_outputs[c] = out_blocks[i * out_channels + c];
+        }
+        m_bank.process(m_inputs, m_outputs, audio_engine::sample_block_size);
+    }
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
+
+void biquad_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
+{
+    if (buffers[m_out_buffer_idx].m_channel_count != m_bank.filter_count())
+        throw std::domain_error("biquad_stage::init(buffers) : the output buffer requires a channel per filter");
+
+    //the filters start silent, a restarted pipeline doesn't hear the ringing of the last run
+    m_bank.reset();
+    m_block_channel = 0;
+}
+
+void biquad_stage::cleanup() noexcept
+{
+}
@@ -0,0 +1,50 @@
+#ifndef BIQUAD_STAGE_H
+#define BIQUAD_STAGE_H
+
+#include "audio_engine/audio.h"
+#include "audio_engine/biquad_bank.h"
+
+#include <vector>
+
+//filters each output channel through its own cascade of biquads on a biquad_bank, e.g an EQ per channel or the bands of a crossover
+//fed from one input channel (a channel past the input's last reads the last). The filters carry state from block to block so
+//the stage is ordered, and the bank runs the channels side by side in the lanes of one worker, so unlike the other ordered stages
+//it doesn't spread its channels over several
+//the coefficients can be changed while the pipeline runs: set_section and publish from the control thread, the next run hears them
+class biquad_stage : public audio_engine::pipeline_stage
+{
+private:
+    audio_engine::biquad_bank m_bank;
+    std::vector<const audio_engine::sample*> m_inputs;
+    std::vector<audio_engine::sample*> m_outputs;
+    size_t m_block_channel; //the filter the next process_block call feeds
+public:
+    //channel_count filters, one per channel of the output buffer, each starting on cascade
+    biquad_stage(size_t channel_count, const std::vector<audio_engine::biquad_coefficients>& cascade);
+
+    //stages one section of one channel's cascade, for the control thread
+    void set_section(size_t channel, size_t section, const audio_engine::biquad_coefficients& coefficients);
+
+    //hands the staged sections to the audio thread, for the control thread
+    void publish() noexcept;
+
+    audio_engine::sample_state process_block(
+        const audio_engine::pipeline_state& state,
+        const audio_engine::sample_block& in_block,
+        audio_engine::sample_block& out_block,
+        int block_count
+    ) noexcept override;
+
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
+    void cleanup() noexcept override;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "convolution_stage.h"
+#include "audio_engine/audio_types.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+convolution_stage::convolution_stage(std::vector<audio_engine::sample> impulse_response, float dry, uint8_t thread_count)
+    : audio_engine::pipeline_stage(2, thread_count, 0, 1, 0, true), //convolves the processed blocks of buffer 0 into buffer 1, in block order as the convolvers carry the tail over
+    m_impulse_response(std::move(impulse_response)),
+    m_dry(dry),
+    m_ir(),
+    m_channel_convolvers(),
+    m_block_channel(0)
+{
+    if (m_impulse_response.empty())
+        throw std::domain_error("convolution_stage::convolution_stage(impulse_response, dry, thread_count) : impulse_response must have at least 1 sample");
+}
+
+void convolution_stage::add_dry(const audio_engine::sample* in, audio_engine::sample* out, size_t count) const noexcept
+{
+    if (m_dry == 0.f)
+        return;
+    for (size_t i = 0; i < count; i++)
+        out[i] += m_dry * in[i];
+}
+
+audio_engine::sample_state convolution_stage::process_block(
+    const audio_engine::pipeline_state& state,
+    const audio_engine::sample_block& in_block,
+    audio_engine::sample_block& out_block,
+    int block_count
+)
+noexcept
+{
+    //the channels of a block come through one after another (see process_run_by_block), so the calls take the convolvers in turn
+    m_channel_convolvers[m_block_channel].process(in_block, out_block, audio_engine::sample_block_size);
+    add_dry(in_block, out_block, audio_engine::sample_block_size);
+    m_block_channel = (m_block_channel + 1) % m_channel_convolvers.size();
+    return audio_engine::sample_block_state_processed;
+}
+
+void convolution_stage::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    size_t in_channels = in_blocks.size() / out_states.size();
+    size_t out_channels = out_blocks.size() / out_states.size();
+    if (in_channels == 1 && out_channels == 1) {
+        //the claimed run is contiguous and in order, so it goes through the convolver in one call
+        size_t count = in_blocks.size() * audio_engine::sample_block_size;
+        m_channel_convolvers.front().process(in_blocks.front(), out_blocks.front(), count);
+        add_dry(in_blocks.front(), out_blocks.front(), count);
+    }
+    else {
+        for (size_t c = 0; c < out_channels; c++)
+            process_channel(state, c, in_blocks, out_blocks, out_states, block_count);
+    }
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
+
+void convolution_stage::process_channel(
+    const audio_engine::pipeline_state& state,
+    size_t channel,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    assert(channel < m_channel_convolvers.size());
+
+    //a channel past the input's last reads the last, as in process_run_by_block
+    size_t in_channels = in_blocks.size() / out_states.size();
+    size_t out_channels = out_blocks.size() / out_states.size();
+    size_t in_channel = std::min(channel, in_channels - 1);
+    for (size_t i = 0; i < out_states.size(); i++) {
+        const audio_engine::sample_block& in_block = in_blocks[i * in_channels + in_channel];
+        audio_engine::sample_block& out_block = out_blocks[i * out_channels + channel];
+        m_channel_convolvers[channel].process(in_block, out_block, audio_engine::sample_block_size);
+        add_dry(in_block, out_block, audio_engine::sample_block_size);
+    }
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
+
+void convolution_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
+{
+    //one partition per block, so a block costs two FFTs and a multiply-add per partition whatever the length of the response
+    if (!m_ir)
+        m_ir = std::make_shared<const audio_engine::convolution_ir>(m_impulse_response, audio_engine::sample_block_size);
+
+    //the convolvers start silent, a restarted pipeline doesn't hear the tail of the last run
+    m_channel_convolvers.clear();
+    for (size_t c = 0; c < buffers[m_out_buffer_idx].m_channel_count; c++)
+        m_channel_convolvers.emplace_back(m_ir);
+    m_block_channel = 0;
+}
+
+void convolution_stage::cleanup() noexcept
+{
+}
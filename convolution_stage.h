@@ -0,0 +1,61 @@
+#ifndef CONVOLUTION_STAGE_H
+#define CONVOLUTION_STAGE_H
+
+#include "audio_engine/audio.h"
+#include "audio_engine/partitioned_convolver.h"
+
+#include <memory>
+#include <vector>
+
+//convolves the blocks with an impulse response, e.g a reverb several seconds long, through a partitioned_convolver
+//the response is cut into block sized partitions and transformed at init, each output channel gets its own convolver over the one set
+//of spectra, an output channel past the input's last reads the last. The convolvers carry the input from block to block so the stage is ordered, with a thread_count above 1 the channels
+//are convolved on that many workers at once
+class convolution_stage : public audio_engine::pipeline_stage
+{
+private:
+    std::vector<audio_engine::sample> m_impulse_response;
+    float m_dry;
+    std::shared_ptr<const audio_engine::convolution_ir> m_ir;
+    std::vector<audio_engine::partitioned_convolver> m_channel_convolvers;
+    size_t m_block_channel; //the convolver the next process_block call goes through
+public:
+    //the output is dry * input + the input convolved with impulse_response, a wet level is the scale of the response
+    convolution_stage(std::vector<audio_engine::sample> impulse_response, float dry = 0.f, uint8_t thread_count = 1);
+
+    audio_engine::sample_state process_block(
+        const audio_engine::pipeline_state& state,
+        const audio_engine::sample_block& in_block,
+        audio_engine::sample_block& out_block,
+        int block_count
+    ) noexcept override;
+
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    void process_channel(
+        const audio_engine::pipeline_state& state,
+        size_t channel,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    bool processes_channels() const noexcept override {
+        return true;
+    };
+
+    void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
+    void cleanup() noexcept override;
+
+private:
+    void add_dry(const audio_engine::sample* in, audio_engine::sample* out, size_t count) const noexcept;
+};
+
+#endif
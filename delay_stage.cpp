@@ -1,16 +1,25 @@
 #include "delay_stage.h"
 #include "audio_engine/audio_types.h"
 
-#include <chrono>
-#include <cmath>
+#include <algorithm>
+#include <cassert>
 
-delay_stage::delay_stage(std::chrono::milliseconds delay_ms)
-    : audio_engine::pipeline_stage(2, 1, 0, 1, std::chrono::duration_cast<audio_engine::sample_duration_t>(delay_ms).count()),
-    m_delay_ms(std::move(delay_ms))
+delay_stage::delay_stage(audio_engine::delay_line line)
+    : audio_engine::pipeline_stage(2, 1, 0, 1, 0, true), //reads the gain output in buffer 0, writes buffer 1 in block order
+    m_line(std::move(line)),
+    m_channel_lines(),
+    m_block_channel(0)
 {
 
 }
 
+audio_engine::delay_line delay_stage::make_single_tap(float delay_samples)
+{
+    audio_engine::delay_line line(delay_samples);
+    line.add_tap(delay_samples);
+    return line;
+}
+
 audio_engine::sample_state delay_stage::process_block(
     const audio_engine::pipeline_state& state, 
     const audio_engine::sample_block& in_block, 
@@ -19,27 +28,62 @@ audio_engine::sample_state delay_stage::process_block(
 )
 noexcept
 {
-    memcpy(out_block, in_block, sizeof(audio_engine::sample_block));
+    //the channels of a block come through one after another (see process_run_by_block), so the calls take the lines in turn
+    m_channel_lines[m_block_channel].process(in_block, out_block, audio_engine::sample_block_size);
+    m_block_channel = (m_block_channel + 1) % m_channel_lines.size();
     return audio_engine::sample_block_state_processed;
 }
 
-void delay_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
+void delay_stage::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
 {
-    auto samples_duration = std::chrono::duration_cast<audio_engine::sample_duration_t>(m_delay_ms).count();
-
-    //write 0 (silence) into the delay quantity samples, NaN into the rest
-    for (int i = 0; i < buffers.front().m_block_count; i++) {
-        for (int j = 0; j < audio_engine::sample_block_size; j++) {
-            buffers.front().get_block(i)[j] = std::nanf("1");
-        }
+    size_t in_channels = in_blocks.size() / out_states.size();
+    size_t out_channels = out_blocks.size() / out_states.size();
+    if (in_channels == 1 && out_channels == 1) {
+        //the claimed run is contiguous and in order, so it goes through the line in one call
+        m_channel_lines.front().process(in_blocks.front(), out_blocks.front(), in_blocks.size() * audio_engine::sample_block_size);
     }
-    memset(buffers.front().get_blocks(), 0, samples_duration * sizeof(audio_engine::sample));
+    else {
+        for (size_t c = 0; c < out_channels; c++)
+            process_channel(state, c, in_blocks, out_blocks, out_states, block_count);
+    }
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
 
-    //mark the blocks as post delay state
-    memset(buffers.front().get_block_states(), 2, buffers.front().m_block_count);
+void delay_stage::process_channel(
+    const audio_engine::pipeline_state& state,
+    size_t channel,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    assert(channel < m_channel_lines.size());
+
+    //each output channel has its own line, so the channels of a run are independent of each other
+    //a channel past the input's last reads the last, as in process_run_by_block
+    size_t in_channels = in_blocks.size() / out_states.size();
+    size_t out_channels = out_blocks.size() / out_states.size();
+    size_t in_channel = std::min(channel, in_channels - 1);
+    for (size_t i = 0; i < out_states.size(); i++)
+        m_channel_lines[channel].process(in_blocks[i * in_channels + in_channel], out_blocks[i * out_channels + channel], audio_engine::sample_block_size);
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
 }
 
-void delay_stage::cleanup() noexcept
+void delay_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
 {
+    //the lines start silent, the first delay's worth of output is silence
+    m_line.reset();
+    m_channel_lines.assign(buffers[m_out_buffer_idx].m_channel_count, m_line);
+    m_block_channel = 0;
 }
 
+void delay_stage::cleanup() noexcept
+{
+}
@@ -2,13 +2,26 @@
 #define DELAY_STAGE_H
 
 #include "audio_engine/audio.h"
+#include "audio_engine/delay_line.h"
 
+//runs the blocks through a delay_line, the line carries samples from block to block so the stage is ordered
+//each output channel gets its own copy of the line, made at init for the channel count of the buffer it writes, an output channel
+//past the input's last reads the last
 class delay_stage : public audio_engine::pipeline_stage
 {
 private:
-	std::chrono::milliseconds m_delay_ms;
+	audio_engine::delay_line m_line;
+	std::vector<audio_engine::delay_line> m_channel_lines;
+	size_t m_block_channel; //the line the next process_block call goes through
 public:
-	delay_stage(std::chrono::milliseconds delay_ms);
+	//a plain delay, the output is the input delayed by delay (any length, including fractions of a sample)
+	template <typename Rep, typename Period>
+	delay_stage(std::chrono::duration<Rep, Period> delay)
+		: delay_stage(make_single_tap(audio_engine::to_delay_samples(delay)))
+	{};
+
+	//taps, feedback and dry level as configured on the line
+	delay_stage(audio_engine::delay_line line);
 
     audio_engine::sample_state process_block(
         const audio_engine::pipeline_state& state,
@@ -17,8 +30,32 @@ public:
         int block_count
     ) noexcept override;
 
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    void process_channel(
+        const audio_engine::pipeline_state& state,
+        size_t channel,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    bool processes_channels() const noexcept override {
+        return true;
+    };
+
     void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
     void cleanup() noexcept override;
+
+private:
+    static audio_engine::delay_line make_single_tap(float delay_samples);
 };
 
-#endif
\ No newline at end of file
+#endif
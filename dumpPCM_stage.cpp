@@ -1,29 +1,43 @@
 #include "dumpPCM_stage.h"
 
-char* dumpPCM_stage::get_out_buffer()
-{
-	static char buf[s_out_buf_size];
-	return buf;
-}
+#include <algorithm>
+#include <iostream>
 
 audio_engine::sample_state dumpPCM_stage::process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept
 {
-	for (uint64_t i = 0; i < audio_engine::sample_block_size; i++) {
-		if (!std::isnan(in_block[i]))
-			m_file.write((const char*)&in_block[i], sizeof(audio_engine::sample));
-	}
+	//a full staging queue drops the block (counted by the writer) rather than stalling the output
+	m_writer.submit(block_count, in_block);
 
 	return audio_engine::sample_block_state_default;
 }
 
+void dumpPCM_stage::process_blocks(
+	const audio_engine::pipeline_state& state,
+	std::span<const audio_engine::sample_block> in_blocks,
+	std::span<audio_engine::sample_block> out_blocks,
+	std::span<audio_engine::sample_state> out_states,
+	int block_count
+) noexcept
+{
+	//every channel of a block goes in together, the writer interleaves them into the file's frames
+	size_t channels = in_blocks.size() / out_states.size();
+	for (size_t i = 0; i < out_states.size(); i++)
+		m_writer.submit(block_count + i, in_blocks.subspan(i * channels, channels));
+
+	std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_default);
+}
+
 void dumpPCM_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
 {
-	m_file = std::ofstream(m_filename, std::ios::binary);
-	m_file.rdbuf()->pubsetbuf(get_out_buffer(), s_out_buf_size);
+	m_writer.open(m_filename, static_cast<uint16_t>(buffers[m_in_buffer_idx].m_channel_count));
 }
 
 void dumpPCM_stage::cleanup() noexcept
 {
-	m_file.flush();
-	m_file.close();
+	if (!m_writer.is_open())
+		return;
+
+	m_writer.close();
+	if (m_writer.dropped_blocks() != 0)
+		std::cerr << "dumpPCM_stage: " << m_writer.dropped_blocks() << " blocks dropped writing " << m_filename << "\n";
 }
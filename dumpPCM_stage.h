@@ -2,20 +2,21 @@
 #define DUMPPCM_STAGE_H
 
 #include "audio_engine/audio.h"
-#include <fstream>
+#include "audio_engine/pcm_file_writer.h"
 
+//writes the output to a 32 bit float WAV file, the blocks are handed to a background writer thread so the stage never waits on the disk
 class dumpPCM_stage : public audio_engine::pipeline_stage
 {
 private:
-    static constexpr size_t s_out_buf_size = 32;
     std::string m_filename;
-    std::ofstream m_file;
-    static char* get_out_buffer();
+    audio_engine::pcm_file_writer m_writer;
 
 public:
-    dumpPCM_stage(std::string filename = "dumpPCM_default")
-        : pipeline_stage(3, 1),
-        m_filename(std::move(filename))
+    //blocks are written at their own offset in the file, so any number of workers can run the stage
+    dumpPCM_stage(std::string filename = "dumpPCM_default.wav", uint8_t thread_count = 1)
+        : pipeline_stage(3, thread_count),
+        m_filename(std::move(filename)),
+        m_writer()
     {}
 
     audio_engine::sample_state process_block(
@@ -25,8 +26,21 @@ public:
         int block_count
     ) noexcept override;
 
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    //the blocks (one per channel) the writer thread couldn't keep up with since init
+    uint64_t dropped_blocks() const noexcept {
+        return m_writer.dropped_blocks();
+    };
+
     void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
     void cleanup() noexcept override;
 };
 
-#endif
\ No newline at end of file
+#endif
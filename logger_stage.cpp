@@ -1,31 +1,42 @@
 #include "logger_stage.h"
 #include <iostream>
-#include <mutex>
-#include <memory>
+#include <algorithm>
 
-char* logger_stage::get_out_buffer() {
-    static char buf[1024]{ 0 }; //threadsafe since C++11 will zero initialize a buffer in some memory that is bound to app lifetime without crash at exit (global static destructor antipattern)
+audio_engine::sample_state logger_stage::process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept
+{
+    //a full staging queue drops the record (counted by the logger) rather than stalling the output
+    m_logger.submit(block_count, in_block);
 
-    return buf;
+    return audio_engine::sample_block_state_default;
 }
 
-audio_engine::sample_state logger_stage::process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept
+void logger_stage::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
 {
-    for (int i = 0; i < audio_engine::sample_block_size; i++)
-    {
-        if (!std::isnan(in_block[i]))
-            std::cout << in_block[i] << "\n";
-    }
+    size_t channels = in_blocks.size() / out_states.size();
+    for (size_t i = 0; i < out_states.size(); i++)
+        for (size_t c = 0; c < channels; c++)
+            m_logger.submit(block_count + i, in_blocks[i * channels + c], static_cast<uint16_t>(c));
 
-    return audio_engine::sample_block_state_default;
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_default);
 }
 
 void logger_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
 {
-    //std::cout.rdbuf()->pubsetbuf(get_out_buffer(), 8);
+    m_logger.open(m_out, static_cast<uint16_t>(buffers[m_in_buffer_idx].m_channel_count));
 }
 
 void logger_stage::cleanup() noexcept
 {
-    std::cout.flush();
+    if (!m_logger.is_open())
+        return;
+
+    m_logger.close();
+    if (m_logger.dropped_records() != 0)
+        std::cerr << "logger_stage: " << m_logger.dropped_records() << " records dropped\n";
 }
@@ -2,18 +2,32 @@
 #define LOGGER_STAGE_H
 
 #include "audio_engine/audio.h"
-#include <mutex>
+#include "audio_engine/block_logger.h"
 
+#include <iostream>
+
+//logs the output to a stream (std::cout by default), either every sample or a min/max/RMS/NaN summary per block
+//the stage only records blocks, the formatting and the stream writes happen on the logger's own thread
 class logger_stage : public audio_engine::pipeline_stage
 {
 private:
-    static char* get_out_buffer();
+    audio_engine::block_logger m_logger;
+    std::ostream& m_out;
 
 public:
-    //only 1 thread I didn't make this threadsafe around logging, generally file operations aren't threadsafe - but buffered ones are, writing something to switch between
-    //atomic and locking cout buffer read/writes depending on buffer state was overkill for the prompt
-	logger_stage() : audio_engine::pipeline_stage(3, 1)
-	{};
+    //single threaded so the log comes out in stream order, records are formatted in the order they are submitted
+    //decimation logs one block in every decimation blocks, overflow wait holds the output up rather than lose records when the
+    //stream can't keep up
+    logger_stage(
+        audio_engine::block_log_mode mode = audio_engine::block_log_mode::samples,
+        uint32_t decimation = 1,
+        std::ostream& out = std::cout,
+        audio_engine::block_log_overflow overflow = audio_engine::block_log_overflow::drop
+    )
+        : audio_engine::pipeline_stage(3, 1),
+        m_logger(mode, decimation, audio_engine::block_logger::s_default_staging_records, overflow),
+        m_out(out)
+    {};
 
     audio_engine::sample_state process_block(
         const audio_engine::pipeline_state& state,
@@ -22,10 +36,22 @@ public:
         int block_count
     ) noexcept override;
 
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    //the records the logger thread couldn't keep up with since init
+    uint64_t dropped_records() const noexcept {
+        return m_logger.dropped_records();
+    };
+
     void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
     void cleanup() noexcept override;
 };
 
 
 #endif
-
@@ -1,6 +1,7 @@
 #include "audio_engine/audio.h"
 #include "sine_wave_generator.h"
 #include "sample_gain_stage.h"
+#include "audio_engine/fused_stage.h"
 #include "delay_stage.h"
 #include "logger_stage.h"
 #include "dumpPCM_stage.h"
@@ -22,12 +23,24 @@ int main()
             std::unique_ptr<audio_engine::pipeline_stage>(new sine_wave_generator(1000.f))
         ), //GENERATOR_STAGES
         audio_engine::make_vector(
-            std::unique_ptr<audio_engine::pipeline_stage>(new sample_gain_stage(2.f)),
+            //gain and a clip fused into one pass over each block, the same as a sample_gain_stage(2.f) followed by a separate clip stage
+            std::unique_ptr<audio_engine::pipeline_stage>(new audio_engine::fused_stage(
+                1, 2, 1,
+                audio_engine::gain_kernel{ 2.f },
+                audio_engine::clip_kernel{ -2.f, 2.f }
+            )),
+            //std::unique_ptr<audio_engine::pipeline_stage>(new sample_gain_stage(2.f)),
             std::unique_ptr<audio_engine::pipeline_stage>(new delay_stage(std::chrono::milliseconds(100)))
         ), //PROCESSING STAGES
         audio_engine::make_vector(
-            std::unique_ptr<audio_engine::pipeline_stage>(new logger_stage())
-            //std::unique_ptr<audio_engine::pipeline_stage>(new dumpPCM_stage("PCM_dump"))
+            //every sample is printed, the output waits on the terminal rather than drop what it can't keep up with
+            std::unique_ptr<audio_engine::pipeline_stage>(new logger_stage(
+                audio_engine::block_log_mode::samples,
+                1,
+                std::cout,
+                audio_engine::block_log_overflow::wait
+            ))
+            //std::unique_ptr<audio_engine::pipeline_stage>(new dumpPCM_stage("PCM_dump.wav"))
         ), //OUTPUT STAGES
         audio_engine::make_vector(
             audio_engine::audio_ring_buffer(96) 
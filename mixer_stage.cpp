@@ -0,0 +1,68 @@
+#include "mixer_stage.h"
+#include "audio_engine/mixer.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+mixer_stage::mixer_stage(std::vector<float> gains, uint8_t thread_count)
+    : audio_engine::pipeline_stage(
+        1, //passes arrive in the first input in this state
+        thread_count,
+        0,
+        static_cast<uint8_t>(gains.size()),
+        0,
+        false,
+        static_cast<uint8_t>(gains.size())
+    ),
+    m_gains(std::move(gains))
+{
+    if (m_gains.size() != m_input_count)
+        throw std::domain_error("mixer_stage::mixer_stage(gains, thread_count) : requires between 1 and max_stage_inputs gains");
+}
+
+//a single input mixer is just a gain
+audio_engine::sample_state mixer_stage::process_block(
+    const audio_engine::pipeline_state& state,
+    const audio_engine::sample_block& in_block,
+    audio_engine::sample_block& out_block,
+    int block_count
+) noexcept
+{
+    const audio_engine::sample* inputs[] = { in_block };
+    audio_engine::mix(inputs, m_gains, out_block, audio_engine::sample_block_size);
+    return audio_engine::sample_block_state_processed;
+}
+
+void mixer_stage::process_inputs(
+    const audio_engine::pipeline_state& state,
+    std::span<const std::span<const audio_engine::sample_block>> inputs,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    //the run is contiguous in every buffer and every input has the output's channel count, so each is one flat array of samples
+    std::array<const audio_engine::sample*, audio_engine::max_stage_inputs> samples;
+    for (size_t k = 0; k < inputs.size(); k++)
+        samples[k] = inputs[k].front();
+
+    audio_engine::mix(
+        std::span<const audio_engine::sample* const>(samples.data(), inputs.size()),
+        m_gains,
+        out_blocks.front(),
+        out_blocks.size() * audio_engine::sample_block_size
+    );
+
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
+
+void mixer_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
+{
+    auto& out = buffers[m_out_buffer_idx];
+    for (size_t k = 0; k < m_input_count; k++)
+        if (buffers[m_in_buffer_idx + k].m_channel_count != out.m_channel_count)
+            throw std::domain_error("mixer_stage::init(buffers) : every input requires the channel_count of the output");
+}
+
+void mixer_stage::cleanup() noexcept {}
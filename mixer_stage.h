@@ -0,0 +1,37 @@
+#ifndef MIXER_STAGE_H
+#define MIXER_STAGE_H
+
+#include "audio_engine/audio.h"
+
+#include <vector>
+
+//sums its inputs, each with its own gain, into one output: a mix bus for the branches of a graph
+//the inputs are buffers 0 .. gains.size() - 1 of the node, each fed by an edge, and the mix goes to the next buffer
+//(buffer gains.size(), the node's last), so a node mixing N branches has N + 1 buffers of the same channel count
+class mixer_stage : public audio_engine::pipeline_stage
+{
+private:
+    std::vector<float> m_gains;
+public:
+    mixer_stage(std::vector<float> gains, uint8_t thread_count = 1);
+
+    audio_engine::sample_state process_block(
+        const audio_engine::pipeline_state& state,
+        const audio_engine::sample_block& in_block,
+        audio_engine::sample_block& out_block,
+        int block_count
+    ) noexcept override;
+
+    void process_inputs(
+        const audio_engine::pipeline_state& state,
+        std::span<const std::span<const audio_engine::sample_block>> inputs,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
+    void cleanup() noexcept override;
+};
+
+#endif
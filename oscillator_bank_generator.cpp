@@ -0,0 +1,39 @@
+#include "oscillator_bank_generator.h"
+
+#include <algorithm>
+
+audio_engine::sample_state oscillator_bank_generator::process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept
+{
+    m_bank.render(out_block, audio_engine::sample_block_size, uint64_t(block_count) * audio_engine::sample_block_size);
+
+    return audio_engine::sample_block_state_processed;
+}
+
+void oscillator_bank_generator::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    size_t channels = out_blocks.size() / out_states.size();
+    if (channels == 1) {
+        m_bank.render(out_blocks.front(), out_blocks.size() * audio_engine::sample_block_size, uint64_t(block_count) * audio_engine::sample_block_size);
+    }
+    else {
+        //the bank is the expensive part, render it once per block and copy it to the other channels
+        for (size_t i = 0; i < out_states.size(); i++) {
+            auto& first = out_blocks[i * channels];
+            m_bank.render(first, audio_engine::sample_block_size, uint64_t(block_count + i) * audio_engine::sample_block_size);
+            for (size_t c = 1; c < channels; c++)
+                std::copy(std::begin(first), std::end(first), out_blocks[i * channels + c]);
+        }
+    }
+
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
+
+void oscillator_bank_generator::init(std::vector<audio_engine::audio_ring_buffer>& buffers) {}
+
+void oscillator_bank_generator::cleanup() noexcept {}
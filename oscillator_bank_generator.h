@@ -0,0 +1,37 @@
+#ifndef OSCILLATOR_BANK_GENERATOR_H
+#define OSCILLATOR_BANK_GENERATOR_H
+
+#include "audio_engine/audio.h"
+#include "audio_engine/oscillator_bank.h"
+
+//generates the sum of a bank of sine oscillators, rendering is stateless per block so it scales with thread_count
+class oscillator_bank_generator : public audio_engine::pipeline_stage
+{
+private:
+    audio_engine::oscillator_bank m_bank;
+public:
+    oscillator_bank_generator(audio_engine::oscillator_bank bank, uint8_t thread_count = 1) :
+        audio_engine::pipeline_stage(audio_engine::sample_block_state_default, thread_count),
+        m_bank(std::move(bank))
+    {};
+
+    audio_engine::sample_state process_block(
+        const audio_engine::pipeline_state& state,
+        const audio_engine::sample_block& in_block,
+        audio_engine::sample_block& out_block,
+        int block_count
+    ) noexcept override;
+
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
+    void cleanup() noexcept override;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#include "pcm_file_generator.h"
+
+#include <algorithm>
+#include <array>
+
+audio_engine::sample_state pcm_file_generator::process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept
+{
+    m_source.read(uint64_t(block_count) * audio_engine::sample_block_size, out_block, audio_engine::sample_block_size);
+
+    return audio_engine::sample_block_state_processed;
+}
+
+void pcm_file_generator::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    size_t channels = out_blocks.size() / out_states.size();
+    if (channels == 1) {
+        //the run is contiguous in the file and in the buffer, so it converts in one pass
+        m_source.read(uint64_t(block_count) * audio_engine::sample_block_size, out_blocks.front(), out_blocks.size() * audio_engine::sample_block_size);
+    }
+    else {
+        //a channel is only contiguous within a block, so the file is split into the block's channels one block at a time
+        std::array<audio_engine::sample*, audio_engine::max_channel_count> planes;
+        for (size_t i = 0; i < out_states.size(); i++) {
+            for (size_t c = 0; c < channels; c++)
+                planes[c] = out_blocks[i * channels + c];
+            m_source.read_planar(uint64_t(block_count + i) * audio_engine::sample_block_size, std::span<audio_engine::sample* const>(planes.data(), channels), audio_engine::sample_block_size);
+        }
+    }
+
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
+
+void pcm_file_generator::init(std::vector<audio_engine::audio_ring_buffer>& buffers) {}
+
+void pcm_file_generator::cleanup() noexcept {}
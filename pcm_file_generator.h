@@ -0,0 +1,45 @@
+#ifndef PCM_FILE_GENERATOR_H
+#define PCM_FILE_GENERATOR_H
+
+#include "audio_engine/audio.h"
+#include "audio_engine/pcm_file_source.h"
+
+//plays a WAV or raw PCM file, each block is converted straight out of a memory mapping of the file at block_count * sample_block_size
+//reading is stateless per block so it scales with thread_count, the stream is silent once the file runs out
+class pcm_file_generator : public audio_engine::pipeline_stage
+{
+private:
+    audio_engine::pcm_file_source m_source;
+public:
+    //a WAV file, the format comes from its header
+    pcm_file_generator(const std::string& path, uint8_t thread_count = 1) :
+        audio_engine::pipeline_stage(audio_engine::sample_block_state_default, thread_count),
+        m_source(path)
+    {};
+
+    //a headerless file of format frames starting data_offset bytes in
+    pcm_file_generator(const std::string& path, audio_engine::pcm_format format, uint64_t data_offset = 0, uint8_t thread_count = 1) :
+        audio_engine::pipeline_stage(audio_engine::sample_block_state_default, thread_count),
+        m_source(path, format, data_offset)
+    {};
+
+    audio_engine::sample_state process_block(
+        const audio_engine::pipeline_state& state,
+        const audio_engine::sample_block& in_block,
+        audio_engine::sample_block& out_block,
+        int block_count
+    ) noexcept override;
+
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
+    void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
+    void cleanup() noexcept override;
+};
+
+#endif
@@ -1,18 +1,43 @@
 #include "sample_gain_stage.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 audio_engine::sample_state sample_gain_stage::process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept
 {
 
     for (uint64_t i = 0; i < audio_engine::sample_block_size; i++)
     {
-        uint64_t i_sample = audio_engine::sample_block_size * block_count + i;
-
         out_block[i] = in_block[i] * m_multiplier;
     }
 
     return 2;
 };
 
-void sample_gain_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers) {};
+void sample_gain_stage::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    //the claimed run is contiguous in both buffers, every channel included, so treat it as one flat array of samples
+    //(init checks the buffers it reads and writes have the same channel count)
+    const audio_engine::sample* in_samples = in_blocks.front();
+    audio_engine::sample* out_samples = out_blocks.front();
+    size_t sample_count = in_blocks.size() * audio_engine::sample_block_size;
+
+    for (size_t i = 0; i < sample_count; i++)
+        out_samples[i] = in_samples[i] * m_multiplier;
+
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_state(2));
+}
+
+void sample_gain_stage::init(std::vector<audio_engine::audio_ring_buffer>& buffers)
+{
+    if (buffers[m_in_buffer_idx].m_channel_count != buffers[m_out_buffer_idx].m_channel_count)
+        throw std::domain_error("sample_gain_stage::init(buffers) : the input requires the channel_count of the output");
+};
 
 void sample_gain_stage::cleanup() noexcept {};
@@ -19,6 +19,14 @@ public:
         int block_count
     ) noexcept override;
 
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
     void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
     void cleanup() noexcept override;
 };
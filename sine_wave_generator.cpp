@@ -1,29 +1,40 @@
 #include "sine_wave_generator.h"
-#include <numbers>
 
-constexpr int cexpr_ceil(float in) {
-    int truncated = (int)in;
-    return (in - truncated >= 0.5) ? truncated + 1 : truncated;
-}
+#include <algorithm>
 
 audio_engine::sample_state sine_wave_generator::process_block(const audio_engine::pipeline_state& state, const audio_engine::sample_block& in_block, audio_engine::sample_block& out_block, int block_count) noexcept
 {
+    m_oscillator.render(out_block, audio_engine::sample_block_size, uint64_t(block_count) * audio_engine::sample_block_size);
 
-    for (uint64_t i = 0; i < audio_engine::sample_block_size; i++)
-    {
-        uint64_t i_sample = audio_engine::sample_block_size * block_count + i;
-
-        auto ceil = cexpr_ceil(audio_engine::sample_rate / m_freq);
-
-        float time = (i_sample % ceil) / (float)audio_engine::sample_rate;
-        //modulo to stay near the origin to avoid float imprecision
+    return audio_engine::sample_block_state_processed;
+};
 
-        out_block[i] = std::sinf(time * m_freq * 2 * std::numbers::pi);//custom_sine(time, m_freq, 1.f);
+void sine_wave_generator::process_blocks(
+    const audio_engine::pipeline_state& state,
+    std::span<const audio_engine::sample_block> in_blocks,
+    std::span<audio_engine::sample_block> out_blocks,
+    std::span<audio_engine::sample_state> out_states,
+    int block_count
+) noexcept
+{
+    size_t channels = out_blocks.size() / out_states.size();
+    if (channels == 1) {
+        //the run is contiguous so it renders as one stretch of samples
+        m_oscillator.render(out_blocks.front(), out_blocks.size() * audio_engine::sample_block_size, uint64_t(block_count) * audio_engine::sample_block_size);
+    }
+    else {
+        //every channel gets the same tone, rendered once per block and copied to the other channels
+        for (size_t i = 0; i < out_states.size(); i++) {
+            auto& first = out_blocks[i * channels];
+            m_oscillator.render(first, audio_engine::sample_block_size, uint64_t(block_count + i) * audio_engine::sample_block_size);
+            for (size_t c = 1; c < channels; c++)
+                std::copy(std::begin(first), std::end(first), out_blocks[i * channels + c]);
+        }
     }
 
-    return audio_engine::sample_block_state_processed;
-};
+    std::fill(out_states.begin(), out_states.end(), audio_engine::sample_block_state_processed);
+}
 
 void sine_wave_generator::init(std::vector<audio_engine::audio_ring_buffer>& buffers) {};
 
-void sine_wave_generator::cleanup() noexcept {};
\ No newline at end of file
+void sine_wave_generator::cleanup() noexcept {};
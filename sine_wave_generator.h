@@ -1,15 +1,21 @@
+#ifndef SINE_WAVE_GENERATOR_H
+#define SINE_WAVE_GENERATOR_H
 
 #include "audio_engine/audio.h"
+#include "audio_engine/oscillator_bank.h"
 
 class sine_wave_generator : public audio_engine::pipeline_stage
 {
 private:
     float m_freq;
+    audio_engine::oscillator_bank m_oscillator; //a bank of one, gives exact fractional phase for any frequency
 public:
 	sine_wave_generator(float freq) : 
         audio_engine::pipeline_stage(audio_engine::sample_block_state_default),
         m_freq(freq)
-	{};
+	{
+        m_oscillator.add_oscillator(freq);
+    };
 
     audio_engine::sample_state process_block(
         const audio_engine::pipeline_state& state,
@@ -18,8 +24,17 @@ public:
         int block_count
     ) noexcept override;
 
+    void process_blocks(
+        const audio_engine::pipeline_state& state,
+        std::span<const audio_engine::sample_block> in_blocks,
+        std::span<audio_engine::sample_block> out_blocks,
+        std::span<audio_engine::sample_state> out_states,
+        int block_count
+    ) noexcept override;
+
     void init(std::vector<audio_engine::audio_ring_buffer>& buffers) override;
 
     void cleanup() noexcept override;
 };
 
+#endif